@@ -0,0 +1,75 @@
+/*==========================================================================================
+** alloccount.h
+
+** Description:
+   Hook for checking that a decoder's frame loop does no heap
+   allocation. When a decoder is built with -D countAllocations, the
+   global operator new is replaced by one that counts allocations per
+   thread. Each worker ends every frame with allocation_probe::endFrame(),
+   and reportAllocations() prints everything allocated after the
+   workers' first frames, which should be zero. Without the flag the
+   probe and the report compile to nothing.
+
+   The replacement operators are defined here, so include this header
+   from the decoder's main source file only.
+==============================================================================================*/
+
+#ifndef ALLOCCOUNT_H
+#define ALLOCCOUNT_H
+
+#include <atomic>
+#include <iostream>
+
+#ifdef countAllocations
+#include <cstdlib>
+#include <new>
+
+thread_local long  threadAllocations = 0;
+std::atomic<long>  steadyStateAllocations(0);
+std::atomic<long>  probedFrames(0);
+
+void * operator new(std::size_t n)
+{
+  threadAllocations++;
+  void * p = std::malloc(n ? n : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+void * operator new[](std::size_t n)                 { return operator new(n); }
+void   operator delete(void * p) noexcept              { std::free(p); }
+void   operator delete[](void * p) noexcept            { std::free(p); }
+void   operator delete(void * p, std::size_t) noexcept   { std::free(p); }
+void   operator delete[](void * p, std::size_t) noexcept { std::free(p); }
+#endif
+
+
+struct allocation_probe
+{
+  long mark;   // Thread's allocation count after its previous frame, -1 before the first
+
+  allocation_probe() : mark(-1) {}
+
+  void endFrame()
+  {
+    #ifdef countAllocations
+    if (mark >= 0)
+      {
+	steadyStateAllocations += threadAllocations - mark;
+	probedFrames++;
+      }
+    mark = threadAllocations;
+    #endif
+  }
+};
+
+
+inline void reportAllocations()
+{
+  #ifdef countAllocations
+  std::cout << "Steady-state heap allocations: " << steadyStateAllocations.load()
+	    << " in " << probedFrames.load() << " frames" << std::endl;
+  #endif
+}
+
+#endif
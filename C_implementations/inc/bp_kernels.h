@@ -0,0 +1,98 @@
+/*==========================================================================================
+** bp_kernels.h
+
+** Description:
+   Node updates of the belief-propagation decoder (decodeBP.cpp),
+   kept here so that benchKernels can time them on their own.
+
+   bpCheckNodeUpdates() sends each edge the leave-one-out product of
+   tanh(msg/2) over the check's other edges, as an LLR. One backward
+   pass stores the suffix products, and one forward pass combines
+   them with the running prefix product, so tanh is evaluated once
+   per edge and the cost is O(dc) per check. Inputs are clipped at
+   maxLLR, so the true product never exceeds tanh(maxLLR/2) in
+   magnitude; clamping the product there keeps rounding from driving
+   it to +-1 and the log to infinity. suffix needs room for
+   biggest_dc+1 products.
+
+   bpSymNodeUpdates() sums each symbol's inputs, sends each edge the
+   sum less its own input, clipped at maxLLR, and makes the
+   decisions, accumulating the parity of each check as it goes.
+==============================================================================================*/
+
+#ifndef BP_KERNELS_H
+#define BP_KERNELS_H
+
+#include <vector>
+#include <cmath>
+#include "tanner.h"
+
+static inline void bpCheckNodeUpdates(tanner_struct &G, double maxLLR, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym, std::vector<double> & suffix)
+{
+  double pmax = tanh(maxLLR/2.0);
+  for (int i=0; i<G.M; i++)
+    {
+      int first = G.check_start[i];
+      int dc = G.check_start[i+1] - first;
+
+      // Store tanh(msg/2) in place of the outputs, then build the suffix products:
+      for (int f=0; f<dc; f++)
+	check_to_sym[first+f] = tanh(sym_to_check[G.check_edge[first+f]]/2.0);
+      suffix[dc] = 1.0;
+      for (int f=dc-1; f>=0; f--)
+	suffix[f] = suffix[f+1]*check_to_sym[first+f];
+
+      double prefix = 1.0;
+      for (int f=0; f<dc; f++)
+	{
+	  double t = check_to_sym[first+f];
+	  double prod = prefix*suffix[f+1];
+	  if (prod > pmax)
+	    prod = pmax;
+	  if (prod < -pmax)
+	    prod = -pmax;
+	  check_to_sym[first+f] = log((1.0+prod)/(1.0-prod));
+	  prefix *= t;
+	}
+    }
+}
+
+
+static inline void bpSymNodeUpdates(tanner_struct &G, double maxLLR, std::vector<double> & y, std::vector<int> & d, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym, std::vector<int> & syndrome, bool & satisfied)
+{
+  double msg, outmsg, sum;
+
+  int unsatisfied = 0;
+  for (int j=0; j<G.M; j++)
+    syndrome[j] = 0;
+
+  for (int i=0; i<G.N; i++)
+    {
+      sum = y[i];
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	sum += check_to_sym[G.sym_edge[k]];
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	{
+	  msg = check_to_sym[G.sym_edge[k]];
+	  outmsg = sum - msg;
+	  if (std::fabs(outmsg) > maxLLR)
+	    outmsg = (outmsg >= 0.0) ? maxLLR : -maxLLR;
+	  sym_to_check[k] = outmsg;
+	}
+      if (sum > 0)
+	d[i] = 1;
+      else
+	{
+	  d[i] = -1;
+	  for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	    {
+	      int j = G.sym_check[k];
+	      unsatisfied += 1 - 2*syndrome[j];
+	      syndrome[j] ^= 1;
+	    }
+	}
+    }
+  satisfied = (unsatisfied == 0);
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*==========================================================================================
+** codekernel.h
+
+** Description:
+   Min-sum node kernels specialized for one code. genCodeKernel reads
+   an alist file and writes a source file (see codekernel_minsum.h)
+   whose edge connectivity is held in constant tables, and whose node
+   updates are unrolled for the code's degrees. The generated file
+   defines a code_kernel and registers it when the program starts, so
+   linking its object is enough: the Makefile generates and compiles
+   the kernels of CODE_KERNELS into obj/, which every binary links.
+
+   A kernel is tied to a graph by its signature, a hash of the
+   check-major edge order. findCodeKernel() returns the linked kernel
+   whose signature matches a graph, or NULL. A kernel built as a
+   shared object (compiled with -D CODE_KERNEL_SHARED -shared -fPIC)
+   is loaded with loadCodeKernel(), which fails unless it matches.
+
+   The kernels compute exactly what the generic flooding min-sum
+   updates do, in the same order, so decoding is unchanged:
+     checkNodes()  check_to_sym from sym_to_check, before any
+                   normalization or offset;
+     symNodes()    the posteriors, sym_to_check and the decisions
+                   d (+1 or -1), with the parity of the decisions at
+                   each check in syndrome; returns the number of
+                   unsatisfied checks.
+   Both message buffers are indexed by edge as in tanner.h.
+==============================================================================================*/
+
+#ifndef CODEKERNEL_H
+#define CODEKERNEL_H
+
+#include <stdint.h>
+#include "tanner.h"
+
+#define CODE_KERNEL_USAGE " [--code-kernel auto|off|FILE.so]"
+
+typedef void (*code_check_nodes)(const double * sym_to_check, double * check_to_sym);
+typedef int  (*code_sym_nodes)(const double * y, int * d, double * sym_to_check, const double * check_to_sym, int * syndrome);
+
+typedef struct {
+  const char *     name;        // Name of the code the kernel was generated from
+  int              N, M, E;
+  uint64_t         signature;   // tannerSignature() of its graph
+  code_check_nodes checkNodes;
+  code_sym_nodes   symNodes;
+} code_kernel;
+
+uint64_t tannerSignature(const tanner_struct & G);
+
+void                registerCodeKernel(const code_kernel * K);
+const code_kernel * findCodeKernel(const tanner_struct & G);
+const code_kernel * loadCodeKernel(const char * fileName, const tanner_struct & G);
+
+// The kernel chosen by --code-kernel: "auto" (the default) for the
+// linked kernel of G if there is one, "off" for none, or a shared
+// object to load. Returns NULL when the generic kernels are to be used.
+const code_kernel * selectCodeKernel(const char * choice, const tanner_struct & G);
+
+// Registers a linked kernel before main() runs:
+struct code_kernel_registrar {
+  code_kernel_registrar(const code_kernel * K) { registerCodeKernel(K); }
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*==========================================================================================
+** codekernel_minsum.h
+
+** Description:
+   Node updates for the code-specialized min-sum kernels (see
+   codekernel.h), included by the source files genCodeKernel writes.
+   A generated file holds its code's edge tables as constant arrays,
+   with the narrowest index type that fits, and splits the checks and
+   the symbols into runs of consecutive nodes of equal degree. The
+   runs of each degree are handled by one of the functions below,
+   with the degree as a template parameter so that the loops over a
+   node's edges are unrolled. The nodes of a flooding iteration are
+   independent, so the runs are taken degree by degree.
+
+   The arithmetic is that of minsumCheckNodeUpdates() and
+   minsumSymNodeUpdates() in minsum_kernels.h, operation for
+   operation, so the messages and decisions are bit-identical to the
+   generic kernels'.
+==============================================================================================*/
+
+#ifndef CODEKERNEL_MINSUM_H
+#define CODEKERNEL_MINSUM_H
+
+#include <cmath>
+#include "codekernel.h"
+
+static inline double codeSgn(double x)
+{
+  return (x >= 0.0) ? 1.0 : -1.0;
+}
+
+
+// count checks of degree DC, whose edges are the check-major edges
+// from e0 on; edge[] holds their symbol-major indices.
+template <int DC, class I>
+static inline void minsumCheckRun(int count, int e0, const I * edge, const double * sym_to_check,
+				  double * check_to_sym)
+{
+  for (int j=0; j<count; j++)
+    {
+      const I * x = edge + j*DC;
+      double * out = check_to_sym + e0 + j*DC;
+      double msg[DC];
+      double minMag = INFINITY;
+      double minMag2 = INFINITY;
+      int minIdx = -1;
+      double prod = 1.0;
+      #pragma GCC unroll 32
+      for (int t=0; t<DC; t++)
+	{
+	  msg[t] = sym_to_check[x[t]];
+	  prod *= codeSgn(msg[t]);
+	  double mag = std::fabs(msg[t]);
+	  if (mag <= minMag)
+	    {
+	      minMag2 = minMag;
+	      minMag = mag;
+	      minIdx = t;
+	    }
+	  else if (mag < minMag2)
+	    minMag2 = mag;
+	}
+      #pragma GCC unroll 32
+      for (int t=0; t<DC; t++)
+	{
+	  if (t == minIdx)
+	    out[t] = prod*minMag2*codeSgn(msg[t]);
+	  else
+	    out[t] = prod*minMag*codeSgn(msg[t]);
+	}
+    }
+}
+
+
+// Symbols [first, first+count) of degree DV, whose edges are the
+// symbol-major edges from k0 on; edge[] holds their check-major
+// indices and check[] their checks. Returns the change in the number
+// of unsatisfied checks.
+template <int DV, class I>
+static inline int minsumSymRun(int count, int first, int k0, const I * edge, const I * check,
+			       const double * y, int * d, double * sym_to_check, const double * check_to_sym,
+			       int * syndrome)
+{
+  int unsatisfied = 0;
+  for (int s=0; s<count; s++)
+    {
+      int i = first + s;
+      const I * x = edge + s*DV;
+      double * out = sym_to_check + k0 + s*DV;
+      double in[DV];
+      double sum = y[i];
+      #pragma GCC unroll 32
+      for (int t=0; t<DV; t++)
+	{
+	  in[t] = check_to_sym[x[t]];
+	  sum += in[t];
+	}
+      #pragma GCC unroll 32
+      for (int t=0; t<DV; t++)
+	out[t] = sum - in[t];
+      if (sum > 0)
+	d[i] = 1;
+      else
+	{
+	  d[i] = -1;
+	  const I * c = check + s*DV;
+	  #pragma GCC unroll 32
+	  for (int t=0; t<DV; t++)
+	    {
+	      unsatisfied += 1 - 2*syndrome[c[t]];
+	      syndrome[c[t]] ^= 1;
+	    }
+	}
+    }
+  return unsatisfied;
+}
+
+#endif
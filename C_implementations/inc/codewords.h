@@ -0,0 +1,74 @@
+/*==========================================================================================
+** codewords.h
+
+** Description:
+   Codeword streams for the simulators. A stream holds its codewords
+   bit-packed, one bit per code bit (bit i of a codeword is bit i%8
+   of byte i/8), so 8 times smaller than the text .enc files.
+
+   openCodewords() accepts either format:
+     - a packed file written by packCodewords, which is mmap'ed;
+       the kernel is asked to read it ahead so frames are resident
+       before the decoders reach them,
+     - a text file with one codeword of '0'/'1' characters per line,
+       which is checked and packed into memory once when opened.
+
+   Workers take frames with nextCodeword(), which claims the next
+   index with an atomic counter and wraps around at the end of the
+   stream, so reading a codeword never takes a lock or blocks on I/O.
+   codewordRow() gives frame f directly, for replaying a frame.
+
+   Packed file layout (native byte order):
+     codeword_file_header, then frames rows of (N+7)/8 bytes
+==============================================================================================*/
+
+#ifndef CODEWORDS_H
+#define CODEWORDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <vector>
+
+#define CODEWORD_MAGIC  "CWPACK1"
+
+typedef struct {
+  char      magic[8];
+  int       N;
+  int       rowBytes;
+  long long frames;
+} codeword_file_header;
+
+struct codeword_stream {
+  int               N = 0;           // Code length
+  long              frames = 0;      // Codewords in the stream (0: no stream open)
+  int               rowBytes = 0;    // Bytes per packed codeword
+  const uint8_t *   rows = NULL;     // The packed codewords, back to back
+  void *            map_base = NULL; // mmap'ed packed file, or NULL
+  size_t            map_len = 0;
+  std::vector<uint8_t> owned;        // Rows packed from a text file
+  std::atomic<long> next {0};        // Index of the next frame to hand out
+};
+
+void openCodewords(codeword_stream & S, const char * fileName, int N);
+void rewindCodewords(codeword_stream & S);
+void closeCodewords(codeword_stream & S);
+long packTextCodewords(const char * fileName, int & N, std::vector<uint8_t> & rows);
+void writePackedCodewords(const char * fileName, int N, long frames, const std::vector<uint8_t> & rows);
+
+inline const uint8_t * codewordRow(const codeword_stream & S, long frame)
+{
+  return S.rows + (size_t)(frame % S.frames)*S.rowBytes;
+}
+
+inline const uint8_t * nextCodeword(codeword_stream & S)
+{
+  return codewordRow(S, S.next.fetch_add(1, std::memory_order_relaxed));
+}
+
+inline int codewordBit(const uint8_t * row, int i)
+{
+  return (row[i >> 3] >> (i & 7)) & 1;
+}
+
+#endif
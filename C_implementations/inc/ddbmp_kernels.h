@@ -0,0 +1,71 @@
+/*==========================================================================================
+** ddbmp_kernels.h
+
+** Description:
+   Node updates of the DD-BMP decoder (decodeDDBMP.cpp), kept here so
+   that benchKernels can time them on their own.
+
+   The messages are signs. ddbmpCheckNodeUpdates() sends each edge
+   the product of the signs on the check's other edges.
+   ddbmpSymNodeUpdates() adds each edge's extrinsic sum to a
+   per-edge memory, sends the sign of the memory, and decides each
+   symbol by a majority of the sign of its channel sample and its
+   outgoing messages.
+==============================================================================================*/
+
+#ifndef DDBMP_KERNELS_H
+#define DDBMP_KERNELS_H
+
+#include <vector>
+#include "tanner.h"
+
+static inline double ddbmpSgn(double x)
+{
+  return (x >= 0.0) ? 1.0 : -1.0;
+}
+
+
+static inline void ddbmpCheckNodeUpdates(tanner_struct &G, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym)
+{
+  double msg;
+  double prod;
+  for (int i=0; i<G.M; i++)
+    {
+      prod = 1.0;
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
+	{
+	  msg = sym_to_check[G.check_edge[e]];
+	  prod *= ddbmpSgn(msg);
+	}
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
+	{
+	  msg = sym_to_check[G.check_edge[e]];
+	  check_to_sym[e] = prod*ddbmpSgn(msg);
+	}
+    }
+}
+
+
+static inline void ddbmpSymNodeUpdates(tanner_struct &G, std::vector<double> & y, std::vector<int> & d, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym, std::vector<double> & sym_memories)
+{
+  for (int i=0; i<G.N; i++)
+    {
+      double sum = y[i];
+      double dsum = ddbmpSgn(y[i]);
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	sum += check_to_sym[G.sym_edge[k]];
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	{
+	  double msg = check_to_sym[G.sym_edge[k]];
+	  sym_memories[k] += sum - msg;
+	  sym_to_check[k] = ddbmpSgn(sym_memories[k]);
+	  dsum += sym_to_check[k];
+	}
+      if (dsum > 0)
+	d[i] = 1;
+      else
+	d[i] = -1;
+    }
+}
+
+#endif
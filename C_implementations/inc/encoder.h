@@ -0,0 +1,49 @@
+/*==========================================================================================
+** encoder.h
+
+** Description:
+   Systematic encoder for drawing fresh random codewords in memory,
+   in place of cycling through a codeword file.
+
+   The code bits are split, as in Neal's make-gen, into check
+   positions cols[0..R-1] and information positions cols[R..N-1]. A
+   codeword is made from K = N-R random information bits: each one
+   that is set XORs its bit-packed parity column (R bits in 64-bit
+   words) into an accumulator, which then holds the check bits.
+
+   openEncoder() takes the name given in a decoder's codeword slot:
+     "random"   derives the generator from H by Gaussian elimination
+                over GF(2) on bit-packed rows. The cost grows as
+                M^2 N/64 word operations, about a second for the
+                4000-bit codes but impractical for DVB-S2 lengths.
+     "x.gen"    loads a generator written by Neal's make-gen, dense,
+                mixed or sparse, such as the PEGReg504x1008.gen and
+                Reg8_4_N4k.gen (for 4000.2000.4.244) of SystemC/NGDBF.
+   Either way, one codeword is checked against H before use.
+==============================================================================================*/
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdint.h>
+#include <vector>
+#include "tanner.h"
+#include "rand_xoshiro.h"
+
+typedef struct {
+  int N, K, R;                    // Code length, information bits and check bits (K = N-R)
+  int words;                      // 64-bit words per parity column
+  std::vector<int>      cols;     // Check positions cols[0..R-1], information positions cols[R..N-1]
+  std::vector<uint64_t> parity;   // Column k (words words) holds the check bits set by information bit k
+} encoder_struct;
+
+bool           isEncoderSource(const char * name);
+encoder_struct openEncoder(const char * name, tanner_struct & G);
+encoder_struct deriveEncoder(tanner_struct & G);
+encoder_struct loadGenerator(const char * fileName, tanner_struct & G);
+
+// Draw a random codeword into c in bipolar form (+1 for a 0 bit, -1
+// for a 1 bit). acc must hold E.words words.
+void randomCodeword(const encoder_struct & E, xoshiro_state & rng, uint64_t * acc, std::vector<int> & c);
+
+#endif
@@ -0,0 +1,235 @@
+/*==========================================================================================
+** gdbf_kernels.h
+
+** Description:
+   Node updates of the GDBF decoders (decodeGDBF.cpp), kept here so
+   that benchKernels can time them on their own.
+
+   gdbfCheckNodeUpdates() computes every check's parity from the
+   bipolar decisions. initFlipState() then sets up the incremental
+   state: the sum S of each symbol's check products, the number of
+   unsatisfied checks, and the list of candidate symbols whose energy
+   has changed. gdbfSymNodeUpdates() makes the flip decisions, and
+   gdbfUpdateSyndromes() propagates the flips to the checks and to
+   the sums, falling back to a full recomputation when so many
+   symbols flipped that it is cheaper.
+
+   The algorithm options are the members of a gdbf_variant policy,
+   given to gdbfSymNodeUpdates() as a template parameter, so that
+   each variant is compiled without the branches it does not use.
+==============================================================================================*/
+
+#ifndef GDBF_KERNELS_H
+#define GDBF_KERNELS_H
+
+#include <vector>
+#include <cmath>
+#include "tanner.h"
+#include "rand_xoshiro.h"
+
+typedef struct {
+  std::vector<int>  S;            // Sum of check_to_sym over each symbol's checks
+  std::vector<int>  flips;        // Symbols flipped in the current iteration
+  std::vector<int>  candidates;   // Symbols whose energy changed since they were last examined
+  std::vector<char> listed;       // Marks the symbols already in candidates
+  int               unsatisfied;  // Number of checks with odd parity
+} flip_state;
+
+template <bool Sequential, bool ModeSwitching, bool Noise, bool Adaptation, bool Weighted,
+	  bool Smoothing, bool Saturate, bool QuantizeSamples, bool QuantizeProbabilities>
+struct gdbf_variant {
+  static const bool sequentialmode        = Sequential;
+  static const bool modeswitching         = ModeSwitching;
+  static const bool addNoise              = Noise;
+  static const bool thresholdAdaptation   = Adaptation;
+  static const bool weightSyndromes       = Weighted;
+  static const bool outputSmoothing       = Smoothing;
+  static const bool saturateSamples       = Saturate;
+  static const bool quantizeSamples       = QuantizeSamples;
+  static const bool quantizeProbabilities = QuantizeProbabilities;
+};
+
+static inline double normalCDF(double value)
+{
+  return 0.5 * erfc(-value * M_SQRT1_2);
+}
+
+
+static inline void gdbfCheckNodeUpdates(tanner_struct &G, std::vector<int> & sym_to_check, std::vector<int> & check_to_sym, bool & satisfied)
+{
+  int msg;
+  satisfied = true;
+  for (int i=0; i<G.M; i++)
+    {
+      int prod = 1;
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
+	{
+	  msg = sym_to_check[G.check_sym[e]];
+	  prod *= msg;
+	}
+      if (prod < 0)
+	satisfied = false;
+      check_to_sym[i] = prod;
+    }
+}
+
+
+// Initialize the syndrome sums and the unsatisfied count from a full
+// set of check products, and make every symbol a candidate:
+static inline void initFlipState(tanner_struct &G, std::vector<int> & check_to_sym, flip_state & F)
+{
+  F.unsatisfied = 0;
+  for (int j=0; j<G.M; j++)
+    if (check_to_sym[j] < 0)
+      F.unsatisfied++;
+
+  F.candidates.clear();
+  for (int i=0; i<G.N; i++)
+    {
+      F.S[i] = 0;
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	F.S[i] += check_to_sym[G.sym_check[k]];
+      F.candidates.push_back(i);
+      F.listed[i] = 1;
+    }
+}
+
+
+// alpha weighs the syndrome sums when P::weightSyndromes is set.
+template <class P>
+void gdbfSymNodeUpdates(tanner_struct &G, std::vector<double> & thetas, double & lambda, double alpha, int & mu, std::vector<double> & y, std::vector<int> & d, flip_state & F, double & sigma, std::vector<double> & perturbation)
+{
+  double Emin = INFINITY;
+  int mindx = -1;
+  double w = 1;
+
+  if (P::weightSyndromes)
+    w = alpha;//*Ymax/dv;
+
+  // Sequential flipping, noise and threshold adaptation need every
+  // symbol; otherwise only those whose energy has changed can flip:
+  bool scanAll = P::addNoise || P::thresholdAdaptation || P::quantizeProbabilities || (mu == 0);
+  int count = scanAll ? G.N : F.candidates.size();
+
+  F.flips.clear();
+  for (int n=0; n<count; n++)
+    {
+      int i = scanAll ? n : F.candidates[n];
+      bool flip = false;
+      double E = d[i]*y[i] + w*F.S[i];
+
+      if (P::addNoise)
+	E += perturbation[i]; //sigma*rann();
+      if (P::quantizeProbabilities)
+	{
+	  double pcdf = normalCDF((-E+thetas[i])/(sigma));
+	  const int num_pr_levels = 8;
+	  double pr_levels[num_pr_levels] =
+	    {
+		 0,
+		 0.0625,
+		 0.125,
+		 0.25,
+		 0.34375,
+		 0.4106,
+		 0.68359,
+		 1
+	     };
+	  double min_dist=1;
+	  int min_idx=0;
+	  for (int j=0; j<num_pr_levels; j++)
+	    {
+	      double tmp_dist = (pr_levels[j]-pcdf);
+	      tmp_dist = tmp_dist*tmp_dist;
+	      if (tmp_dist<min_dist)
+		{
+		   min_dist = tmp_dist;
+		   min_idx = j;
+		}
+	    }
+	  double rnum = ranu();
+	  //printf("%d\t%f->%f\t%f\t",min_idx,pcdf,pr_levels[min_idx],rnum);
+	  if (rnum < pr_levels[min_idx])
+	    {
+	       flip = true;
+	       d[i] = -d[i];
+	       F.flips.push_back(i);
+	       //printf("flip.\n");
+	    }
+	  //else
+		  //printf("no flip.\n");
+	}
+      else
+	{
+	  if ((mu == 1) && (E < thetas[i]))
+	    {
+	      flip = true;
+	      d[i] = -d[i];
+	      F.flips.push_back(i);
+	    }
+	  if (mu == 0)
+	    if (E < Emin)
+	      {
+		flip = true;
+		Emin = E;
+		mindx = i;
+	      }
+	}
+      if (P::thresholdAdaptation)
+	{
+	  if (flip)
+	    thetas[i] = thetas[i]; // /= lambda;
+	  else
+	    thetas[i] *= lambda;
+	}
+    }
+  if ((mu == 0)&&(mindx>=0))
+    {
+      d[mindx] = -d[mindx];
+      F.flips.push_back(mindx);
+    }
+
+  // Every candidate has now been examined:
+  for (int n=0; n<F.candidates.size(); n++)
+    F.listed[F.candidates[n]] = 0;
+  F.candidates.clear();
+}
+
+
+// Toggle the checks adjacent to each flipped symbol, and adjust the
+// syndrome sums of every symbol on those checks:
+static inline void gdbfUpdateSyndromes(tanner_struct &G, std::vector<int> & d, std::vector<int> & check_to_sym, flip_state & F)
+{
+  if ((long) F.flips.size()*G.biggest_dv*G.biggest_dc > 2*(long) G.E)
+    {
+      bool satisfied;
+      gdbfCheckNodeUpdates(G,d,check_to_sym,satisfied);
+      for (int n=0; n<F.candidates.size(); n++)
+	F.listed[F.candidates[n]] = 0;
+      initFlipState(G,check_to_sym,F);
+      return;
+    }
+
+  for (int n=0; n<F.flips.size(); n++)
+    {
+      int i = F.flips[n];
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	{
+	  int j = G.sym_check[k];
+	  check_to_sym[j] = -check_to_sym[j];
+	  F.unsatisfied += (check_to_sym[j] < 0) ? 1 : -1;
+	  for (int e=G.check_start[j]; e<G.check_start[j+1]; e++)
+	    {
+	      int s = G.check_sym[e];
+	      F.S[s] += 2*check_to_sym[j];
+	      if (!F.listed[s])
+		{
+		  F.listed[s] = 1;
+		  F.candidates.push_back(s);
+		}
+	    }
+	}
+    }
+}
+
+#endif
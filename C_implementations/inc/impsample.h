@@ -0,0 +1,51 @@
+/*==========================================================================================
+** impsample.h
+
+** Description:
+   Importance-sampling AWGN channel for estimating low error rates.
+   The channel noise, in units of the signal amplitude, is drawn from
+   a biased density q = N(-shift, (scale*sigma)^2) in place of the
+   true p = N(0, sigma^2): a positive shift moves the samples toward
+   the decision boundary, and a scale above 1 widens the noise, so
+   that frame errors become frequent. Each frame carries the weight
+   w = prod_i p(n_i)/q(n_i), and the weighted error counts are
+   unbiased estimates of the true BER and FER (see montecarlo.h).
+
+   Biasing every one of N symbols makes the weights spread out as N
+   grows: the log-weight of a frame has a standard deviation of about
+   sqrt(N)*shift/sigma. Once that is much above 1 a few frames carry
+   all the weight, and the estimate and its printed variance both
+   come out low, so keep the bias near that limit.
+==============================================================================================*/
+
+#ifndef IMPSAMPLE_H
+#define IMPSAMPLE_H
+
+#include <math.h>
+
+typedef struct {
+  double shift;   // Noise mean toward the decision boundary, in units of the signal amplitude
+  double scale;   // Noise standard deviation multiplier
+} is_channel;
+
+inline bool isActive(const is_channel & ch)
+{
+  return (ch.shift != 0.0) || (ch.scale != 1.0);
+}
+
+// Biased noise sample made from the standard normal deviate g. The
+// log of the density ratio p/q, apart from the constant log(scale)
+// that isFrameWeight() adds once per frame, accumulates in logWeight:
+inline double isNoise(const is_channel & ch, double sigma, double g, double & logWeight)
+{
+  double z = ch.scale*g - ch.shift/sigma;
+  logWeight += 0.5*(g*g - z*z);
+  return sigma*z;
+}
+
+inline double isFrameWeight(const is_channel & ch, double logWeight, int N)
+{
+  return exp(logWeight + N*log(ch.scale));
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*==========================================================================================
+** instrument.h
+
+** Description:
+   Stage timing for the decoders, compiled in and switched on at run
+   time with --profile 1.
+
+   Each worker keeps a stage_clock for the life of its frame loop.
+   lap(s) charges the time since the previous lap (or since the clock
+   was made) to stage s, so the stages of a frame add up to the
+   worker's whole time. The seconds go into per-thread counters that
+   only their owner writes, read once the workers are joined. With
+   profiling off a lap is one test of a null pointer.
+
+   The stages are:
+     channel    codeword, noise, quantization and message setup
+                (with --producers, the wait for a ready frame)
+     check      check node updates
+     symbol     symbol node updates, with the flip perturbation of
+                the GDBF decoders
+     syndrome   stopping-rule syndrome checks
+     io         error counting, mcRecordFrame() and console output
+   A decoder that fuses two stages into one kernel (such as the
+   min-sum symbol update, which also evaluates the syndrome) charges
+   both to the stage it laps.
+
+   profileReport() prints frames/s, iterations/s and edge updates/s
+   (iterations times the number of edges of the graph), and each
+   stage's share of the workers' time. recordProfile() adds the same
+   to a result record (records.h).
+==============================================================================================*/
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <vector>
+#include <chrono>
+#include "montecarlo.h"
+#include "records.h"
+
+#define PROFILE_USAGE " [--profile 0|1]"
+
+enum profile_stage { STAGE_CHANNEL, STAGE_CHECK, STAGE_SYMBOL, STAGE_SYNDROME, STAGE_IO, PROFILE_STAGES };
+
+// Written only by the owning worker.
+struct alignas(64) stage_counters {
+  double seconds[PROFILE_STAGES] = {};
+};
+
+struct profiler {
+  bool                                  enabled;
+  std::vector<stage_counters>           threads;   // one per worker
+  std::chrono::steady_clock::time_point start;
+
+  profiler(bool on, int numThreads);
+};
+
+struct stage_clock {
+  stage_counters *                      counters;  // NULL when profiling is off
+  std::chrono::steady_clock::time_point last;
+
+  stage_clock(profiler & P, int tid)
+    : counters(P.enabled ? &P.threads[tid] : NULL)
+  {
+    if (counters != NULL)
+      last = std::chrono::steady_clock::now();
+  }
+
+  void lap(profile_stage s)
+  {
+    if (counters == NULL)
+      return;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    counters->seconds[s] += std::chrono::duration<double>(now - last).count();
+    last = now;
+  }
+};
+
+void profileReport(const profiler & P, const frame_totals & t, int E);
+void recordProfile(result_record & R, const profiler & P, const frame_totals & t, int E);
+
+#endif
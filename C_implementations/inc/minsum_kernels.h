@@ -0,0 +1,101 @@
+/*==========================================================================================
+** minsum_kernels.h
+
+** Description:
+   Node updates of the flooding min-sum decoders (decodeMinSum.cpp),
+   kept here so that benchKernels can time them on their own. Codes
+   with a generated kernel (codekernel.h) use that instead; its
+   arithmetic is the same, operation for operation.
+
+   minsumCheckNodeUpdates() sends each edge the product of the signs
+   and the smallest magnitude of the check's other inputs, using the
+   two smallest magnitudes. The offset and normalization are applied
+   afterwards by the decoder. minsumSymNodeUpdates() sums each
+   symbol's inputs, sends each edge the sum less its own input, and
+   makes the decisions, accumulating the parity of each check as it
+   goes: every -1 decision toggles its neighbouring checks.
+==============================================================================================*/
+
+#ifndef MINSUM_KERNELS_H
+#define MINSUM_KERNELS_H
+
+#include <vector>
+#include <cmath>
+#include "tanner.h"
+
+static inline double minsumSgn(double x)
+{
+  return (x >= 0.0) ? 1.0 : -1.0;
+}
+
+
+static inline void minsumCheckNodeUpdates(tanner_struct &G, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym)
+{
+  double minMag;
+  double minMag2;
+  int minIdx;
+  double msg;
+  double prod;
+  for (int i=0; i<G.M; i++)
+    {
+      minMag = INFINITY;
+      minMag2 = INFINITY;
+      minIdx = -1;
+      prod = 1.0;
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
+	{
+	  msg = sym_to_check[G.check_edge[e]];
+	  prod *= minsumSgn(msg);
+	  if (std::fabs(msg) <= minMag)
+	    {
+	      minMag2 = minMag;
+	      minMag = std::fabs(msg);
+	      minIdx = e;
+	    }
+	  else if (std::fabs(msg) < minMag2)
+	    {
+	      minMag2 = std::fabs(msg);
+	    }
+	}
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
+	{
+	  msg = sym_to_check[G.check_edge[e]];
+	  if (e == minIdx)
+	    check_to_sym[e] = prod*minMag2*minsumSgn(msg);
+	  else
+	    check_to_sym[e] = prod*minMag*minsumSgn(msg);
+	}
+    }
+}
+
+
+static inline void minsumSymNodeUpdates(tanner_struct &G, std::vector<double> & y, std::vector<int> & d, std::vector<double> & sym_to_check, std::vector<double> & check_to_sym, std::vector<int> & syndrome, bool & satisfied)
+{
+  int unsatisfied = 0;
+  for (int j=0; j<G.M; j++)
+    syndrome[j] = 0;
+
+  for (int i=0; i<G.N; i++)
+    {
+      double sum = y[i];
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	sum += check_to_sym[G.sym_edge[k]];
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	sym_to_check[k] = sum - check_to_sym[G.sym_edge[k]];
+      if (sum > 0)
+	d[i] = 1;
+      else
+	{
+	  d[i] = -1;
+	  for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	    {
+	      int j = G.sym_check[k];
+	      unsatisfied += 1 - 2*syndrome[j];
+	      syndrome[j] ^= 1;
+	    }
+	}
+    }
+  satisfied = (unsatisfied == 0);
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*==========================================================================================
+** montecarlo.h
+
+** Description:
+   Multithreaded Monte Carlo frame engine shared by the decoders.
+
+   mcRun() starts numThreads workers. Each worker owns its decoder
+   state and its own random stream (ran_stream(seed,tid) from
+   rand_xoshiro.h), decodes frames until mc.stop is raised, and
+   reports each frame with mcRecordFrame(). Frame counts go into
+   per-thread atomic counters that only their owner writes; after
+   every frame the worker sums all threads' counters and evaluates the
+   stopping rule on the global totals. The calling thread prints an
+   incremental report whenever the total frame count passes a
+   multiple of reportInterval.
+
+   Rare events (frame errors, console output) are serialized through
+   mc.lock. Codewords come from a lock-free codeword_stream
+   (codewords.h).
+
+   The stopping rule is usually mcStopRule(), built from the decoder's
+   default error counts and the stopping flags (see stoprule.h) that
+   extractStopPolicy() takes from the command line.
+
+   Each frame may carry an importance-sampling weight (impsample.h).
+   The engine keeps the sums of the weights of erroneous frames, of
+   their squares, and of the weighted bit errors, so that
+   weightedWordErrors/totalWords and weightedErrors/totalBits are
+   the FER and BER estimates. Unweighted frames have weight 1 and the
+   sums equal the plain counts.
+==============================================================================================*/
+
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include "stoprule.h"
+#include "impsample.h"
+
+typedef struct {
+  long errors;            // Total bit errors
+  long uncodedErrors;     // Bit errors before decoding
+  long totalBits;         // Total number of bits observed
+  long totalWords;        // Total number of frames observed
+  long wordErrors;        // Number of word errors observed
+  long totalIterations;   // Total number of iterations accumulated over all frames
+  double weightedErrors;      // Sum of frame weight times bit errors
+  double weightedErrors2;     // Sum of squares of the same
+  double weightedWordErrors;  // Sum of the weights of erroneous frames
+  double weightedWordErrors2; // Sum of squares of the same
+} frame_totals;
+
+// Written only by the owning worker. Aligned to a cache line so
+// workers updating their own counters do not false-share.
+struct alignas(64) worker_counters {
+  std::atomic<long> errors;
+  std::atomic<long> uncodedErrors;
+  std::atomic<long> totalBits;
+  std::atomic<long> totalWords;
+  std::atomic<long> wordErrors;
+  std::atomic<long> totalIterations;
+  std::atomic<double> weightedErrors;
+  std::atomic<double> weightedErrors2;
+  std::atomic<double> weightedWordErrors;
+  std::atomic<double> weightedWordErrors2;
+};
+
+typedef std::function<bool(const frame_totals &)> stop_rule;
+
+#define MC_STOP_USAGE " [--rel-precision P] [--confidence C] [--max-frames F] [--fer-floor X]"
+#define MC_IS_USAGE " [--is-shift M] [--is-scale S]"
+
+struct mc_engine {
+  int                          numThreads;
+  std::vector<worker_counters> counters;           // one per worker
+  std::atomic<bool>            stop;
+  stop_rule                    done;               // true once the global totals are sufficient
+  std::mutex                   lock;               // guards the histogram and console
+  std::vector<int>             error_weight_hist;  // histogram of error-pattern weights (1 up to N)
+
+  mc_engine(int threads, int N, stop_rule rule);
+};
+
+int          resolveThreads(long requested);
+stop_policy  extractStopPolicy(int & argc, char * argv[]);
+is_channel   extractISChannel(int & argc, char * argv[]);
+stop_rule    mcStopRule(stop_policy P, long minErrors, long minWordErrors);
+void         mcPrintInterval(const stop_policy & P, const frame_totals & t);
+frame_totals mcTotals(mc_engine & mc);
+void         mcRun(mc_engine & mc, std::function<void(int)> worker, long reportInterval);
+void         mcRecordFrame(mc_engine & mc, int tid, int newErrors, int uncodedErrors, int iterations, int N, const char * note, double weight = 1.0);
+void         mcPrintIncremental(mc_engine & mc, frame_totals & t);
+
+#endif
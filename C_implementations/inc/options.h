@@ -0,0 +1,40 @@
+/*==========================================================================================
+** options.h
+
+** Description:
+   Helpers for optional "--name value" command line flags. Each
+   helper searches argv for its flag, removes the flag and its value,
+   and shifts the remaining arguments down, so the decoders can keep
+   checking their positional arguments by count as before.
+
+   Real-valued positional parameters may also be given as a list
+   "a,b,c" or an inclusive range "start:step:stop". addSweep()
+   registers such a parameter with the variable it controls, and the
+   decoders run every combination of the registered values in one
+   process: sweepPoints() counts them and sweepSelect() assigns the
+   values of one point.
+==============================================================================================*/
+
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include <vector>
+
+typedef struct {
+  std::string         name;
+  double *            target;
+  std::vector<double> values;
+} sweep_param;
+
+typedef std::vector<sweep_param> sweep_struct;
+
+long        extractLongOption(int & argc, char * argv[], const char * name, long defaultValue);
+double      extractDoubleOption(int & argc, char * argv[], const char * name, double defaultValue);
+std::string extractStringOption(int & argc, char * argv[], const char * name, const char * defaultValue);
+
+void        addSweep(sweep_struct & S, const char * name, const char * arg, double & target);
+long        sweepPoints(const sweep_struct & S);
+void        sweepSelect(sweep_struct & S, long point);
+
+#endif
@@ -0,0 +1,92 @@
+/*==========================================================================================
+** pipeline.h
+
+** Description:
+   Pipelined channel frame source. Producer threads draw codewords
+   and emulate the AWGN channel (with importance sampling, see
+   impsample.h), so that the decoder threads only quantize the
+   samples and decode.
+
+   Each decoder worker tid has its own ring of depth preallocated
+   channel_frame slots. Producer p fills rings p, p+P, p+2P, ... so
+   every ring has one producer and one consumer, and the head and
+   tail indices need no lock: the producer publishes a slot by
+   advancing head, the consumer returns it by advancing tail. A full
+   ring holds its producer back until the decoder catches up. There
+   are at most as many producers as workers.
+
+   A worker takes a frame with pipelineAcquire(), swaps the slot's
+   buffers with its own (so nothing is copied and nothing allocated),
+   and hands the slot back with pipelineRelease(). pipelineAcquire()
+   returns NULL once mc.stop is raised.
+
+   The producers seed their random streams with ids numThreads+p, so
+   they never share a stream with a worker. pipelineStop() joins them
+   and prints the time each stage spent working and waiting: if the
+   decoders wait on empty rings, add producers; if the producers wait
+   on full rings, they are not the bottleneck.
+==============================================================================================*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include "montecarlo.h"
+#include "encoder.h"
+#include "codewords.h"
+#include "impsample.h"
+
+#define MC_PIPE_USAGE " [--producers P] [--ring-depth D]"
+
+typedef struct {
+  std::vector<int>      c;          // Bipolar codeword
+  std::vector<double>   y;          // Channel samples
+  std::vector<uint64_t> acc;        // Encoder scratch
+  double                logWeight;  // Importance-sampling log-weight of the frame
+} channel_frame;
+
+typedef struct {
+  int                    N;
+  double                 sigma;
+  is_channel             channel;
+  const encoder_struct * encoder;    // Draw random codewords, or NULL
+  codeword_stream *      codewords;  // Take codewords from a stream, or NULL
+} channel_source;
+
+// With neither an encoder nor a stream the codeword is all-zero.
+void makeChannelFrame(const channel_source & S, channel_frame & F);
+
+struct alignas(64) frame_ring {
+  std::vector<channel_frame> slots;
+  alignas(64) std::atomic<long> head {0};  // Frames published, written by the producer
+  alignas(64) std::atomic<long> tail {0};  // Frames returned, written by the consumer
+  double waitSeconds = 0.0;                // Consumer time spent on an empty ring
+};
+
+typedef struct {
+  long   frames;        // Frames made
+  double busySeconds;   // Time spent making them
+  double waitSeconds;   // Time spent with every ring full
+} producer_counters;
+
+struct frame_pipeline {
+  mc_engine &                    mc;
+  channel_source                 source;
+  int                            depth;
+  long                           seed;
+  std::vector<frame_ring>        rings;       // one per worker
+  std::vector<producer_counters> counters;    // one per producer
+  std::vector<std::thread>       producers;
+
+  frame_pipeline(mc_engine & engine, const channel_source & S, int numProducers, int ringDepth, long ranSeed);
+};
+
+void            extractPipeline(int & argc, char * argv[], int numThreads, int & producers, int & depth);
+channel_frame * pipelineAcquire(frame_pipeline & P, int tid);
+void            pipelineRelease(frame_pipeline & P, int tid);
+void            pipelineStop(frame_pipeline & P);
+
+#endif
@@ -0,0 +1,172 @@
+/* rand_philox.h - Random number generators. */
+/* Formatted to be compatible with Neal's
+   rand.h but using the counter-based Philox4x32-10
+   generator (Salmon et al., "Parallel random numbers:
+   as easy as 1, 2, 3", SC'11), one state per thread.
+
+   Every draw is a pure function of a 64-bit key and
+   a 128-bit counter. The key is the seed, and the
+   counter holds (stream, frame, phase, iteration,
+   block), so ran_frame(f,p,i) jumps straight to the
+   numbers used by phase p, iteration i of frame f.
+   Any frame can be regenerated from the seed and its
+   index alone, and threads on different streams can
+   never overlap.
+
+   Field widths: frame < 2^48, stream < 2^16,
+   phase < 2^8, iteration < 2^24, and 2^34 words
+   may be drawn at each position.
+
+   Original rand.h copyright message:
+   Copyright (c) 1992 by Radford M. Neal
+*/
+
+#ifndef RAND_PHILOX_H
+#define RAND_PHILOX_H
+
+#include <stdint.h>
+#include <math.h>
+
+typedef struct {
+  uint32_t key[2];
+  uint32_t ctr[4];       /* Block, phase|iteration, frame low, stream|frame high */
+  uint32_t out[4];       /* Current output block */
+  int      used;         /* Words of out already returned */
+  int      stream;
+  int      have_spare;   /* rann() produces deviates in pairs */
+  double   spare;
+} philox_state;
+
+inline thread_local philox_state ran_philox;
+
+static inline uint32_t philox_mulhilo(uint32_t a, uint32_t b, uint32_t & hi)
+{
+  uint64_t p = (uint64_t)a * b;
+  hi = (uint32_t)(p >> 32);
+  return (uint32_t)p;
+}
+
+/* Ten rounds of Philox4x32 on counter c with key k */
+static inline void philox_block(const uint32_t c[4], const uint32_t k[2], uint32_t out[4])
+{
+  uint32_t x0 = c[0], x1 = c[1], x2 = c[2], x3 = c[3];
+  uint32_t k0 = k[0], k1 = k[1];
+  for (int r = 0; r < 10; r++)
+    {
+      uint32_t hi0, hi1;
+      uint32_t lo0 = philox_mulhilo(0xD2511F53u, x0, hi0);
+      uint32_t lo1 = philox_mulhilo(0xCD9E8D57u, x2, hi1);
+      x0 = hi1 ^ x1 ^ k0;
+      x1 = lo1;
+      x2 = hi0 ^ x3 ^ k1;
+      x3 = lo0;
+      k0 += 0x9E3779B9u;
+      k1 += 0xBB67AE85u;
+    }
+  out[0] = x0;
+  out[1] = x1;
+  out[2] = x2;
+  out[3] = x3;
+}
+
+/* Move to the start of phase p, iteration i of frame f */
+static inline void philox_position(philox_state & st, uint64_t frame, int phase, int iteration)
+{
+  st.ctr[0] = 0;
+  st.ctr[1] = ((uint32_t)phase << 24) | ((uint32_t)iteration & 0xffffffu);
+  st.ctr[2] = (uint32_t)frame;
+  st.ctr[3] = ((uint32_t)st.stream << 16) | ((uint32_t)(frame >> 32) & 0xffffu);
+  st.used = 4;
+  st.have_spare = 0;
+}
+
+static inline void philox_seed(philox_state & st, uint64_t seed, int stream)
+{
+  st.key[0] = (uint32_t)seed;
+  st.key[1] = (uint32_t)(seed >> 32);
+  st.stream = stream;
+  philox_position(st, 0, 0, 0);
+}
+
+static inline uint32_t philox_next32(philox_state & st)
+{
+  if (st.used == 4)
+    {
+      philox_block(st.ctr, st.key, st.out);
+      st.ctr[0]++;
+      st.used = 0;
+    }
+  return st.out[st.used++];
+}
+
+static inline uint64_t philox_next(philox_state & st)
+{
+  uint64_t hi = philox_next32(st);
+  return (hi << 32) | philox_next32(st);
+}
+
+/* Uniform from [0,1) using the top 53 bits */
+static inline double philox_uniform(philox_state & st)
+{
+  return (philox_next(st) >> 11) * (1.0/9007199254740992.0);
+}
+
+/* Uniform from (0,1) */
+static inline double philox_uniform_pos(philox_state & st)
+{
+  return ((philox_next(st) >> 11) + 0.5) * (1.0/9007199254740992.0);
+}
+
+/* Standard normal by the polar method, keeping the second deviate */
+static inline double philox_normal(philox_state & st)
+{
+  if (st.have_spare)
+    {
+      st.have_spare = 0;
+      return st.spare;
+    }
+  double u, v, s;
+  do
+    {
+      u = 2.0*philox_uniform(st) - 1.0;
+      v = 2.0*philox_uniform(st) - 1.0;
+      s = u*u + v*v;
+    }
+  while ((s >= 1.0) || (s == 0.0));
+  s = sqrt(-2.0*log(s)/s);
+  st.spare = v*s;
+  st.have_spare = 1;
+  return u*s;
+}
+
+
+/* SET RANDOM NUMBER SEED AND POSITION. */
+
+#define ran_seed(s) philox_seed(ran_philox, (s), 0)
+
+#define ran_stream(s,k) philox_seed(ran_philox, (s), (k))
+
+#define ran_frame(f,p,i) philox_position(ran_philox, (f), (p), (i))
+
+
+/* GENERATE RANDOM NUMBERS. */
+
+#define ranf() \
+  philox_uniform(ran_philox)                  /* Uniform from interval [0,1) */
+
+#define ranu() \
+  philox_uniform_pos(ran_philox)              /* Uniform from (0,1) */
+
+#define rani(n) \
+  ( (int) (ranf()*(n)) )		    /* Uniform from 0, 1, ..., (n-1) */
+
+#define rann() \
+  philox_normal(ran_philox)                   /* From standard Norml */
+
+#define rane() \
+  (-log(ranu()))		                  /* From exponential */
+
+#define ranc() \
+  (tan(3.141592654*(ranu()-0.5)))		                      /* From Cauchy */
+
+#endif
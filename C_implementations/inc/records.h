@@ -0,0 +1,59 @@
+/*==========================================================================================
+** records.h
+
+** Description:
+   Self-describing result records, written alongside the decoders'
+   tab-separated logs when --results FILE is given. A record names
+   every field: the program, git revision, host, UTC time, seed and
+   thread count, each positional parameter under its usage name (the
+   current value for swept ones), any decoder-specific fields, the
+   frame totals, and the throughput and timing of the point.
+
+   The format follows the file name: FILE.csv gets CSV with a header
+   line, anything else gets one JSON object per line. Each record is
+   formatted in memory and appended with a single write() while the
+   file is flock()ed, so several sweep processes may share one file.
+   A CSV file whose header does not match the record's fields is left
+   alone, with a message on stderr.
+==============================================================================================*/
+
+#ifndef RECORDS_H
+#define RECORDS_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include "options.h"
+#include "montecarlo.h"
+
+#define RESULTS_USAGE " [--results FILE]"
+
+typedef struct {
+  std::vector<std::string> keys;
+  std::vector<std::string> values;   // Formatted values
+  std::vector<bool>        quoted;   // Whether JSON needs the value as a string
+} result_record;
+
+typedef struct {
+  std::chrono::steady_clock::time_point start;
+  double                                cpuStart;   // Process CPU seconds, all threads
+} run_timer;
+
+run_timer startTimer();
+
+void recordString(result_record & R, const char * key, const std::string & value);
+void recordNumber(result_record & R, const char * key, double value);
+void recordCount(result_record & R, const char * key, long value);
+
+// The fields that identify a run: program, revision, host, time, seed
+// and threads. recordRun() starts with them.
+void recordHeader(result_record & R, const char * program, long seed, int threads);
+
+// argv holds the positional arguments only, named by names[0..].
+void recordRun(result_record & R, int argc, char * argv[], const std::vector<std::string> & names,
+	       const sweep_struct & sweep, long seed, int threads);
+void recordTotals(result_record & R, const frame_totals & t, const run_timer & T);
+
+void writeResultRecord(const std::string & fileName, const result_record & R);
+
+#endif
@@ -0,0 +1,59 @@
+/*==========================================================================================
+** simdms.h
+
+** Description:
+   Frame-parallel fixed-point min-sum engine. SIMDMS_LANES frames are
+   decoded together: every message and decision is stored as a row of
+   SIMDMS_LANES int8 values, one per frame, so each node update works
+   on whole rows with packed instructions. Messages saturate at +-127.
+
+   One flooding iteration (check nodes, then symbol nodes with the
+   syndrome accumulated on the fly) is compiled once per instruction
+   set from simdms_kernel.h. selectSimdKernel() picks the widest one
+   the CPU supports at run time, or the one named by `isa`
+   ("avx512", "avx2", "sse41" or "generic").
+==============================================================================================*/
+
+#ifndef SIMDMS_H
+#define SIMDMS_H
+
+#include <stdint.h>
+#include "tanner.h"
+
+#define SIMDMS_LANES 64
+
+typedef struct {
+  int offset;   // Subtracted from check-to-symbol magnitudes (offset min-sum)
+  int scale;    // Magnitudes are multiplied by scale/16 (normalized min-sum); 16 for none
+} simdms_params;
+
+// Rows of SIMDMS_LANES bytes, aligned for the widest vectors. Both
+// message memories are indexed by check-major edge.
+typedef struct {
+  int8_t * ch;    // Channel LLRs, one row per symbol
+  int8_t * c2v;   // Check-to-symbol messages, one row per edge
+  int8_t * v2c;   // Symbol-to-check messages, one row per edge
+  int8_t * d;     // Decisions, -1 where the bipolar decision is -1, else 0
+  int8_t * par;   // Parity of the decisions at each check
+  int8_t * done;  // One row: -1 for lanes whose decisions are frozen
+} simdms_frames;
+
+typedef uint64_t (*simdms_iteration)(tanner_struct & G, simdms_frames & F, const simdms_params & P);
+
+typedef struct {
+  const char *     name;
+  simdms_iteration iterate;   // Returns the lanes that still have unsatisfied checks
+} simdms_kernel;
+
+simdms_frames allocSimdFrames(tanner_struct & G);
+void          freeSimdFrames(simdms_frames & F);
+void          initSimdFrames(tanner_struct & G, simdms_frames & F);
+simdms_kernel selectSimdKernel(const char * isa);
+bool          simdIsaSupported(const char * isa);
+
+uint64_t simdmsIterationGeneric(tanner_struct & G, simdms_frames & F, const simdms_params & P);
+uint64_t simdmsIterationSSE41(tanner_struct & G, simdms_frames & F, const simdms_params & P);
+uint64_t simdmsIterationAVX2(tanner_struct & G, simdms_frames & F, const simdms_params & P);
+uint64_t simdmsIterationAVX512(tanner_struct & G, simdms_frames & F, const simdms_params & P);
+
+#endif
@@ -0,0 +1,161 @@
+/*==========================================================================================
+** simdms_kernel.h
+
+** Description:
+   Body of one fixed-point min-sum iteration for simdms.h. It is
+   written with GCC vector types and included once per instruction
+   set, by a source file compiled with the matching -m flags that
+   first defines SIMDMS_ITERATION as the function name to emit and
+   SIMDMS_WIDTH as the native vector width in bytes. The lanes are
+   processed in SIMDMS_LANES/SIMDMS_WIDTH independent slices, since
+   vectors wider than the hardware are split badly by the compiler.
+==============================================================================================*/
+
+#ifndef SIMDMS_ITERATION
+#error "Define SIMDMS_ITERATION before including simdms_kernel.h"
+#endif
+
+#include "simdms.h"
+
+#ifndef SIMDMS_WIDTH
+#define SIMDMS_WIDTH SIMDMS_LANES
+#endif
+#define SIMDMS_SLICES (SIMDMS_LANES/SIMDMS_WIDTH)
+
+typedef int8_t  simd_i8  __attribute__((vector_size(SIMDMS_WIDTH)));
+typedef int8_t  simd_i8h __attribute__((vector_size(SIMDMS_WIDTH/2)));
+typedef int16_t simd_i16 __attribute__((vector_size(SIMDMS_WIDTH)));
+
+// 16-bit arithmetic is done on the two halves of a row separately, in
+// native-width vectors: a double-width vector is spilled to the stack
+// and handled piecewise by the compiler. The halves are split off and
+// joined again with shuffles, which stay in registers.
+#if SIMDMS_WIDTH == 16
+#define SIMDMS_LOW   0, 1, 2, 3, 4, 5, 6, 7
+#define SIMDMS_HIGH  8, 9, 10, 11, 12, 13, 14, 15
+#elif SIMDMS_WIDTH == 32
+#define SIMDMS_LOW   0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+#define SIMDMS_HIGH  16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31
+#elif SIMDMS_WIDTH == 64
+#define SIMDMS_LOW   0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, \
+                     16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31
+#define SIMDMS_HIGH  32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, \
+                     48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63
+#else
+#error "SIMDMS_WIDTH must be 16, 32 or 64"
+#endif
+
+static inline void widen(simd_i8 x, simd_i16 & lo, simd_i16 & hi)
+{
+  lo = __builtin_convertvector(__builtin_shufflevector(x, x, SIMDMS_LOW), simd_i16);
+  hi = __builtin_convertvector(__builtin_shufflevector(x, x, SIMDMS_HIGH), simd_i16);
+}
+
+static inline simd_i8 narrow(simd_i16 lo, simd_i16 hi)
+{
+  simd_i8h l = __builtin_convertvector(lo, simd_i8h);
+  simd_i8h h = __builtin_convertvector(hi, simd_i8h);
+  return __builtin_shufflevector(l, h, SIMDMS_LOW, SIMDMS_HIGH);
+}
+
+// Row r of a slice, whose first row starts at p:
+#define ROW(p,r) (p)[SIMDMS_SLICES*(r)]
+
+uint64_t SIMDMS_ITERATION(tanner_struct & G, simdms_frames & F, const simdms_params & P)
+{
+  const simd_i8  zero   = {};
+  const simd_i8  maxmag = zero + 127;
+  const simd_i8  offset = zero + (int8_t) P.offset;
+  const simd_i16 lim    = (simd_i16){} + 127;
+
+  uint64_t mask = 0;
+  for (int q=0; q<SIMDMS_SLICES; q++)
+    {
+      simd_i8 * ch  = (simd_i8 *) F.ch + q;
+      simd_i8 * c2v = (simd_i8 *) F.c2v + q;
+      simd_i8 * v2c = (simd_i8 *) F.v2c + q;
+      simd_i8 * d   = (simd_i8 *) F.d + q;
+      simd_i8 * par = (simd_i8 *) F.par + q;
+      simd_i8   done = ((simd_i8 *) F.done)[q];
+
+      // Check nodes: two-minimum search and sign XOR over each row.
+      for (int j=0; j<G.M; j++)
+	{
+	  simd_i8 m1 = maxmag;
+	  simd_i8 m2 = maxmag;
+	  simd_i8 s = zero;
+	  for (int e=G.check_start[j]; e<G.check_start[j+1]; e++)
+	    {
+	      simd_i8 x = ROW(v2c,e);
+	      simd_i8 a = (x < 0) ? -x : x;
+	      simd_i8 hi = (a > m1) ? a : m1;
+	      m2 = (hi < m2) ? hi : m2;
+	      m1 = (a < m1) ? a : m1;
+	      s ^= x;
+	    }
+	  for (int e=G.check_start[j]; e<G.check_start[j+1]; e++)
+	    {
+	      simd_i8 x = ROW(v2c,e);
+	      simd_i8 a = (x < 0) ? -x : x;
+	      simd_i8 mag = (a == m1) ? m2 : m1;
+	      if (P.offset > 0)
+		{
+		  mag -= offset;
+		  mag = (mag < 0) ? zero : mag;
+		}
+	      if (P.scale != 16)
+		{
+		  simd_i16 lo, hi;
+		  widen(mag, lo, hi);
+		  lo = (lo * (int16_t) P.scale) >> 4;
+		  hi = (hi * (int16_t) P.scale) >> 4;
+		  lo = (lo > lim) ? lim : lo;
+		  hi = (hi > lim) ? lim : hi;
+		  mag = narrow(lo, hi);
+		}
+	      ROW(c2v,e) = ((s ^ x) < 0) ? -mag : mag;
+	    }
+	}
+
+      // Symbol nodes: 16-bit sums, saturated outputs, and the parity of
+      // every check toggled by the symbols that decide -1.
+      for (int j=0; j<G.M; j++)
+	ROW(par,j) = zero;
+      for (int i=0; i<G.N; i++)
+	{
+	  simd_i16 sumlo, sumhi, lo, hi;
+	  widen(ROW(ch,i), sumlo, sumhi);
+	  for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	    {
+	      widen(ROW(c2v,G.sym_edge[k]), lo, hi);
+	      sumlo += lo;
+	      sumhi += hi;
+	    }
+	  for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	    {
+	      int e = G.sym_edge[k];
+	      widen(ROW(c2v,e), lo, hi);
+	      lo = sumlo - lo;
+	      hi = sumhi - hi;
+	      lo = (lo > lim) ? lim : lo;
+	      hi = (hi > lim) ? lim : hi;
+	      lo = (lo < -lim) ? -lim : lo;
+	      hi = (hi < -lim) ? -lim : hi;
+	      ROW(v2c,e) = narrow(lo, hi);
+	    }
+	  simd_i8 dnew = narrow(sumlo <= 0, sumhi <= 0);
+	  ROW(d,i) = (done & ROW(d,i)) | (~done & dnew);
+	  for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	    ROW(par,G.sym_check[k]) ^= ROW(d,i);
+	}
+
+      simd_i8 unsatisfied = zero;
+      for (int j=0; j<G.M; j++)
+	unsatisfied |= ROW(par,j);
+
+      for (int l=0; l<SIMDMS_WIDTH; l++)
+	if (unsatisfied[l])
+	  mask |= (uint64_t)1 << (q*SIMDMS_WIDTH + l);
+    }
+  return mask;
+}
@@ -0,0 +1,130 @@
+/*==========================================================================================
+** stoprule.h
+
+** Description:
+   Stopping policy for Monte Carlo error-rate simulations. By default a
+   run stops once it has seen minErrors bit errors and minWordErrors
+   frame errors. The policy can instead stop when the frame error
+   rate is known to a target relative precision, judged by the Wilson
+   score interval at the given confidence level, which is cheap to
+   recompute from the running totals after every frame. Independently
+   of either rule, a run stops when it reaches its frame budget, or
+   when the upper end of the FER interval falls below a floor, i.e.
+   the point is already known to be better than anything of interest.
+
+   The BER is not used for the precision rule, since bit errors come
+   in bursts within a frame and are not independent trials.
+
+   Importance-sampled runs (weighted set) estimate the FER as a mean
+   of per-frame weights instead, with a normal interval from the
+   sample variance of the weights. That variance is only trustworthy
+   once some biased frame errors have been seen, so the precision and
+   floor rules then also wait for minWordErrors frame errors, and
+   mcStopRule() gives weighted runs a 10% precision target when none
+   is set.
+==============================================================================================*/
+
+#ifndef STOPRULE_H
+#define STOPRULE_H
+
+#include <math.h>
+
+typedef struct {
+  double precision;      // Target relative half-width of the FER interval (0: count errors instead)
+  double confidence;     // Confidence level of the interval
+  long   maxFrames;      // Frame budget (0: unlimited)
+  double ferFloor;       // Stop once the FER upper bound is below this (0: never)
+  long   minErrors;      // Bit errors needed by the error-count rule
+  long   minWordErrors;  // Frame errors needed by the error-count rule
+  bool   weighted;       // Frames carry importance-sampling weights
+} stop_policy;
+
+inline stop_policy defaultStopPolicy(long minErrors, long minWordErrors)
+{
+  stop_policy P = {0.0, 0.95, 0, 0.0, minErrors, minWordErrors, false};
+  return P;
+}
+
+// Two-sided standard normal quantile for a confidence level, found by
+// bisection on erfc (only evaluated when an interval is needed):
+inline double confidenceZ(double confidence)
+{
+  double lo = 0.0, hi = 10.0;
+  for (int k=0; k<60; k++)
+    {
+      double z = 0.5*(lo + hi);
+      if (erfc(z/sqrt(2.0)) > 1.0 - confidence)
+	lo = z;
+      else
+	hi = z;
+    }
+  return 0.5*(lo + hi);
+}
+
+// Wilson score interval for k successes in n trials:
+inline void wilsonInterval(long k, long n, double z, double & lower, double & upper)
+{
+  if (n == 0)
+    {
+      lower = 0.0;
+      upper = 1.0;
+      return;
+    }
+  double p = (double) k/n;
+  double z2n = z*z/n;
+  double centre = (p + 0.5*z2n)/(1.0 + z2n);
+  double half = z*sqrt(p*(1.0 - p)/n + 0.25*z2n/n)/(1.0 + z2n);
+  lower = (centre - half > 0.0) ? centre - half : 0.0;
+  upper = (centre + half < 1.0) ? centre + half : 1.0;
+}
+
+// z is confidenceZ(P.confidence), passed in so that it is computed once per run.
+inline bool stopReached(const stop_policy & P, double z, long errors, long wordErrors, long totalWords)
+{
+  if ((P.maxFrames > 0) && (totalWords >= P.maxFrames))
+    return true;
+  if ((P.precision > 0.0) || (P.ferFloor > 0.0))
+    {
+      double lower, upper;
+      wilsonInterval(wordErrors, totalWords, z, lower, upper);
+      if ((P.ferFloor > 0.0) && (upper < P.ferFloor))
+	return true;
+      if (P.precision > 0.0)
+	return (wordErrors > 0) && (0.5*(upper - lower) <= P.precision*wordErrors/totalWords);
+    }
+  return (errors >= P.minErrors) && (wordErrors >= P.minWordErrors);
+}
+
+// Mean of n per-frame values, and the variance of that mean, from the
+// sum and the sum of squares of the values:
+inline void weightedEstimate(double sum, double sum2, long n, double & mean, double & var)
+{
+  mean = (n > 0) ? sum/n : 0.0;
+  var = (n > 1) ? (sum2/n - mean*mean)/(n - 1) : INFINITY;
+  if (var < 0.0)
+    var = 0.0;
+}
+
+// As stopReached(), for weighted runs. wSum and w2Sum are the sums of
+// the weights of the erroneous frames and of their squares:
+inline bool stopReachedWeighted(const stop_policy & P, double z, long errors, long wordErrors, long totalWords,
+				double wSum, double w2Sum)
+{
+  if ((P.maxFrames > 0) && (totalWords >= P.maxFrames))
+    return true;
+  if (((P.precision > 0.0) || (P.ferFloor > 0.0)) && (wordErrors >= P.minWordErrors) && (wordErrors > 0))
+    {
+      double fer, var;
+      weightedEstimate(wSum, w2Sum, totalWords, fer, var);
+      double half = z*sqrt(var);
+      if ((P.ferFloor > 0.0) && (fer + half < P.ferFloor))
+	return true;
+      if (P.precision > 0.0)
+	return (half <= P.precision*fer);
+    }
+  else if (P.precision > 0.0)
+    return false;
+  return (errors >= P.minErrors) && (wordErrors >= P.minWordErrors);
+}
+
+#endif
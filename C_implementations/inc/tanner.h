@@ -0,0 +1,54 @@
+/*==========================================================================================
+** tanner.h
+
+** Description:
+   Defines a flat (CSR) representation of the Tanner graph described
+   by an alist_struct. Edges are stored twice in contiguous arrays:
+   once in check-major order (all edges of check 0, then check 1, ...)
+   and once in symbol-major order. Each ordering carries the index of
+   the same edge in the other ordering, so a decoder can gather a
+   message written by the opposite node type by direct indexing
+   instead of searching the neighbour lists.
+
+   Message buffers are indexed by edge:
+     check_to_sym[e]  uses check-major indices e,
+     sym_to_check[k]  uses symbol-major indices k,
+   so a check node reads sym_to_check[check_edge[e]] and a symbol
+   node reads check_to_sym[sym_edge[k]].
+
+   All node indices are 0-based (alist files are 1-based).
+
+   loadTanner() keeps a binary copy of the graph next to the alist
+   file (<alist>.csr). When the cache matches the alist's size and
+   modification time it is mmap'ed and the edge arrays point straight
+   into the mapping; otherwise the alist is parsed, the graph built
+   and the cache rewritten.
+==============================================================================================*/
+
+#ifndef TANNER_H
+#define TANNER_H
+
+#include <stddef.h>
+#include "alist.h"
+
+typedef struct {
+	int N , M ;        /* number of symbol nodes and check nodes */
+	int E ;            /* number of edges (ones in the matrix) */
+	int *check_start ; /* M+1 offsets; edges of check i are check_start[i] .. check_start[i+1]-1 */
+	int *check_sym ;   /* symbol node attached to each check-major edge */
+	int *check_edge ;  /* symbol-major index of each check-major edge */
+	int *sym_start ;   /* N+1 offsets; edges of symbol i are sym_start[i] .. sym_start[i+1]-1 */
+	int *sym_check ;   /* check node attached to each symbol-major edge */
+	int *sym_edge ;    /* check-major index of each symbol-major edge */
+	int biggest_dv ;   /* largest symbol node degree */
+	int biggest_dc ;   /* largest check node degree */
+	void *map_base ;   /* mmap'ed cache backing the arrays, or NULL if malloc'ed */
+	size_t map_len ;
+} tanner_struct ;
+
+
+tanner_struct buildTanner(alist_struct & H);
+tanner_struct loadTanner(const char * fileName);
+void freeTanner(tanner_struct G);
+
+#endif
@@ -0,0 +1,57 @@
+/*==========================================================================================
+** trace.h
+
+** Description:
+   Decoding traces for regression checks against stored golden
+   traces (scripts/golden.sh), written when --trace FILE is given.
+
+   traceIteration() is called after every iteration with the current
+   hard decisions, and traceFrame() once the frame is decided. Each
+   writes one line:
+       frame iteration decisions syndrome unsatisfied
+       frame end iterations decisions syndrome unsatisfied
+   where decisions and syndrome are 64-bit FNV-1a hashes of the
+   packed decision bits and of the packed unsatisfied-check flags,
+   and unsatisfied is the number of unsatisfied checks. Decoders that
+   decode several frames at once pass each frame's lane; its frame
+   number is the batch's first frame plus the lane, and traceNext()
+   moves past the batch.
+
+   A trace is only reproducible when the frames are, so --trace needs
+   a fixed --seed and a single worker thread. With tracing off every
+   call returns at once.
+==============================================================================================*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include "tanner.h"
+
+#define TRACE_USAGE " [--trace FILE]"
+
+typedef std::function<bool(int)> decision_bits;   // Whether symbol i is decided as a 1
+
+typedef struct {
+  FILE *                file;     // NULL when tracing is off
+  long                  frame;    // Number of the current (first) frame
+  std::vector<uint64_t> packed;   // Scratch for the packed bits
+} decode_trace;
+
+decode_trace openTrace(int & argc, char * argv[], int numThreads);
+void         closeTrace(decode_trace & T);
+
+void traceIteration(decode_trace & T, const tanner_struct & G, int lane, int it, const decision_bits & bit);
+void traceFrame(decode_trace & T, const tanner_struct & G, int lane, int iterations, const decision_bits & bit);
+void traceNext(decode_trace & T, int lanes);
+
+// Decisions held as bipolar symbols, -1 for a 1:
+inline decision_bits bipolarBits(const std::vector<int> & d)
+{
+  return [&d](int i) { return d[i] < 0; };
+}
+
+#endif
@@ -0,0 +1,70 @@
+#!/bin/bash
+
+# Steady-state heap allocation check (make allocations).
+#
+# Usage: scripts/allocations.sh [dir]
+#
+# The decoders in dir (tmp/alloc by default) are built with
+# -D countAllocations (see inc/alloccount.h), and report the heap
+# allocations made after each worker's first frame. Every run below
+# decodes a fixed number of seeded frames on PEGReg504x1008 with two
+# workers (the precision target is out of reach, so that only
+# --max-frames stops it), and fails unless its report shows some
+# frames and no allocation. The bitsliced and SIMD decoders take 64
+# frames at a time.
+
+PROBES=${1:-./tmp/alloc}
+ALIST=./codes/PEGReg504x1008/PEGReg504x1008.alist
+WORK=$(mktemp -d)
+trap "rm -rf $WORK" EXIT
+LOG=$WORK/log
+
+###################################
+### RUNS                        ###
+###################################
+# name  frames  arguments (after the alist and rate)
+RUNS="
+decodeGDBF                     40 --variant MGDBF 4.0 30 -0.9 $LOG
+decodeGDBF                     40 --variant SMNGDBF 4.0 30 -0.9 $LOG 0.95 0.99 2.25 5 2.5
+decodeGDBF                     40 --variant ATGDBF 4.0 30 -0.9 $LOG 0.99
+decodeBitslicedGDBF           512 4.0 30 -0.9 $LOG
+decodeBitslicedMGDBF          512 4.0 30 -0.9 $LOG
+decodeMinSum                   40 2.0 20 $LOG
+decodeLayeredMinSum            40 2.0 20 $LOG
+decodeSIMDMinSum              512 2.0 20 2.0 5 $LOG
+decodeBP                       40 2.0 20 $LOG
+decodeDDBMP                    40 2.5 50 1.0 3 $LOG
+"
+
+FAILED=0
+while read NAME FRAMES ARGS
+do
+    [ -z "$NAME" ] && continue
+    LABEL=$NAME
+    case $ARGS in
+	--variant*) set -- $ARGS; LABEL="$NAME --variant $2" ;;
+    esac
+    if [ ! -x $PROBES/$NAME ]; then
+	echo "$LABEL: FAILED, $PROBES/$NAME not built"
+	FAILED=1
+	continue
+    fi
+    $PROBES/$NAME --threads 2 --seed 1 --rel-precision 1e-9 --max-frames $FRAMES $ALIST 0.5 $ARGS < /dev/null > $WORK/out || { cat $WORK/out; FAILED=1; continue; }
+    set -- $(awk '/^Steady-state heap allocations:/ { print $4, $6 }' $WORK/out)
+    if [ $# -ne 2 ]; then
+	echo "$LABEL: FAILED, no allocation report"
+	FAILED=1
+    elif [ $1 -ne 0 ] || [ $2 -eq 0 ]; then
+	echo "$LABEL: FAILED ($1 allocations in $2 frames)"
+	FAILED=1
+    else
+	echo "$LABEL: ok (0 allocations in $2 frames)"
+    fi
+done <<< "$RUNS"
+
+if [ $FAILED -eq 0 ]; then
+    echo "No steady-state allocations"
+else
+    echo "Allocation check FAILED"
+fi
+exit $FAILED
@@ -0,0 +1,84 @@
+#!/bin/bash
+
+# Kernel benchmark suite over the shipped codes (make bench).
+#
+# Usage: scripts/bench.sh [results file]
+#
+# Appends result records (JSON lines) to the results file, by default
+# results/bench.jsonl:
+#  - bin/benchKernels times alist loading, noise generation, encoding,
+#    the decoders' node updates and the SIMD min-sum iteration on each
+#    code;
+#  - each decoder is run REPS times on each code with a fixed seed,
+#    frame budget and --profile 1, so that its records carry the time
+#    spent in the channel, check, symbol and syndrome stages. With the
+#    same seed every revision decodes the same frames.
+#
+# scripts/benchcompare.sh runs this suite on two revisions and
+# compares them.
+
+OUT=${1:-results/bench.jsonl}
+BIN=${BIN:-./bin}
+REPS=${REPS:-3}
+FRAMES=${FRAMES:-100}
+SEED=${SEED:-1}
+LOGDIR=$(mktemp -d)
+trap "rm -rf $LOGDIR" EXIT
+
+###################################
+### CODES                       ###
+###################################
+# name  alist  rate  SNR  theta  noiseScale  lambda  alpha
+CODES=${CODES:-"PEGReg504x1008 4000.2000.4.244 802_3 4376.282.4.9598 dvbs2_1_2"}
+
+codeParameters() {
+    case $1 in
+	PEGReg504x1008)   echo ./codes/PEGReg504x1008/PEGReg504x1008.alist 0.5 3.0 -0.9 0.95 0.99 2.25 ;;
+	4000.2000.4.244)  echo ./codes/4000.2000.4.244/4000.2000.4.244.alist 0.5 2.6 -0.7 0.75 0.99 2.2 ;;
+	802_3)            echo ./codes/802_3/802_3_H.alist 0.8413 4.5 -0.6 0.7 0.99 0.5 ;;
+	4376.282.4.9598)  echo ./codes/4376.282.4.9598/4376.282.4.9598.alist 0.9356 5.0 -0.7 0.65 0.993 0.75 ;;
+	dvbs2_1_2)        echo ./codes/dvbs2_1_2/dvbs2_1_2.alist 0.5 3.0 -1.1 0.775 0.987 2.5 ;;
+	*)                echo "Unknown code $1" >&2; exit 1 ;;
+    esac
+}
+
+mkdir -p $(dirname $OUT)
+FLAGS="--seed $SEED --max-frames $FRAMES --profile 1 --results $OUT"
+
+###################################
+### KERNEL MICRO-BENCHMARKS     ###
+###################################
+ALISTS=""
+for CODE in $CODES
+do
+    set -- $(codeParameters $CODE)
+    ALISTS="$ALISTS $1"
+done
+if [ -x $BIN/benchKernels ]; then
+    echo Running $BIN/benchKernels --seed $SEED --results $OUT $ALISTS
+    $BIN/benchKernels --seed $SEED --results $OUT $ALISTS || exit 1
+else
+    echo "No $BIN/benchKernels in this revision, skipping the micro-benchmarks"
+fi
+
+###################################
+### DECODER STAGE TIMINGS       ###
+###################################
+for CODE in $CODES
+do
+    set -- $(codeParameters $CODE)
+    ALIST=$1; RATE=$2; SNR=$3; THETA=$4; NOISESCALE=$5; LAMBDA=$6; ALPHA=$7
+    for REP in $(seq $REPS)
+    do
+	for CMD in \
+	    "decodeMNGDBF $ALIST $RATE $SNR 100 $THETA $LOGDIR/log $NOISESCALE $LAMBDA $ALPHA 2.5" \
+	    "decodeMinSum $ALIST $RATE $SNR 20 $LOGDIR/log" \
+	    "decodeBP $ALIST $RATE $SNR 20 $LOGDIR/log" \
+	    "decodeDDBMP $ALIST $RATE $SNR 100 1.0 3 $LOGDIR/log"
+	do
+	    set -- $CMD
+	    echo Running $BIN/$1 $FLAGS ${@:2}
+	    $BIN/$1 $FLAGS ${@:2} > $LOGDIR/out || { cat $LOGDIR/out; exit 1; }
+	done
+    done
+done
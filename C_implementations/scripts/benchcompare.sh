@@ -0,0 +1,109 @@
+#!/bin/bash
+
+# Compare the benchmark suite (scripts/bench.sh) between two revisions.
+#
+# Usage: scripts/benchcompare.sh revA revB
+#
+# Each revision is checked out in a temporary git worktree, built
+# with make and benchmarked with this tree's bench.sh; a revision
+# given as "." is the current working tree, built as it stands. The
+# environment variables of bench.sh (REPS, FRAMES, SEED, CODES) apply
+# to both runs.
+#
+# For every kernel the median over the repetitions is printed for
+# each revision, with the ratio B/A: benchKernels times are ns per
+# call, decoder stages are ns per iteration (stage seconds over the
+# iterations decoded). Ratios below 1 mean revB is faster. Kernels
+# that a revision does not report (such as --profile stages before
+# the stage timing existed) are left out, as are stages a decoder
+# fuses into another.
+
+if [ $# -ne 2 ]; then
+    echo "Usage: $0 revA revB"
+    exit 0
+fi
+
+HERE=$(pwd)
+SCRIPTS=$(cd $(dirname $0) && pwd)
+TOP=$(git rev-parse --show-toplevel) || exit 1
+PREFIX=$(git rev-parse --show-prefix)
+WORK=$(mktemp -d)
+trap "cd $HERE; for W in $WORK/A $WORK/B; do [ -d \$W ] && git worktree remove --force \$W; done; rm -rf $WORK" EXIT
+
+benchRevision() {
+    if [ "$1" = "." ]; then
+	DIR=$HERE
+    else
+	git worktree add --detach $WORK/$2 $1 > /dev/null || exit 1
+	DIR=$WORK/$2/$PREFIX
+    fi
+    echo "=== $2: $1 ($DIR)"
+    mkdir -p $DIR/obj $DIR/bin
+    (cd $DIR && make -k all > $WORK/make_$2.out 2>&1)
+    (cd $DIR && bash $SCRIPTS/bench.sh $WORK/$2.jsonl) || exit 1
+}
+
+touch $WORK/A.jsonl $WORK/B.jsonl
+benchRevision $1 A
+benchRevision $2 B
+
+# Pull "key:value" fields out of the flat JSON records, one
+# "kernel code metric revision value" line each, then take medians.
+for R in A B
+do
+    awk -v rev=$R '
+	function field(k,   s) {
+	    if (!match($0, "\"" k "\": [^,}]*"))
+		return "";
+	    s = substr($0, RSTART + length(k) + 4, RLENGTH - length(k) - 4);
+	    gsub("\"", "", s);
+	    return s;
+	}
+	{
+	    if (field("benchmark") != "") {
+		print field("benchmark"), field("code"), "ns/call", rev, field("median_ns");
+		next;
+	    }
+	    it = field("iterations");
+	    if ((it == "") || (it == 0) || (field("check_s") == "null"))
+		next;
+	    code = field("alist");
+	    sub(".*/", "", code);
+	    sub("\\.alist$", "", code);
+	    split("channel check symbol syndrome", stages, " ");
+	    for (s = 1; s <= 4; s++)
+		print field("program") "/" stages[s], code, "ns/iteration", rev, 1e9*field(stages[s] "_s")/it;
+	}' $WORK/$R.jsonl
+done | sort -k1,4 -k5,5g | awk '
+    function flush() {
+	if (n == 0)
+	    return;
+	m = (n % 2) ? v[(n+1)/2] : 0.5*(v[n/2] + v[n/2+1]);
+	median[group] = m;
+	if (!(kernel in seen)) {
+	    seen[kernel] = 1;
+	    order[++kernels] = kernel;
+	}
+	n = 0;
+    }
+    {
+	g = $1 " " $2 " " $3 " " $4;
+	if (g != group)
+	    flush();
+	group = g;
+	kernel = $1 " " $2 " " $3;
+	v[++n] = $5;
+    }
+    END {
+	flush();
+	printf("%-28s %-18s %-13s %12s %12s %8s\n", "kernel", "code", "unit", "A", "B", "B/A");
+	for (k = 1; k <= kernels; k++) {
+	    split(order[k], f, " ");
+	    a = order[k] " A";
+	    b = order[k] " B";
+	    if (!(a in median) || !(b in median) || (median[a] == 0 && median[b] == 0))
+		continue;
+	    printf("%-28s %-18s %-13s %12.1f %12.1f %8.3f\n", f[1], f[2], f[3], median[a], median[b],
+		   (median[a] > 0) ? median[b]/median[a] : 0);
+	}
+    }'
@@ -0,0 +1,149 @@
+#!/bin/bash
+
+# Golden-trace regression check for the decoders (make golden).
+#
+# Usage: scripts/golden.sh [check|update] [tolerance]
+#
+# Every decoder variant below decodes a fixed set of seeded frames on
+# PEGReg504x1008 with --trace (see inc/trace.h), which records the
+# hashes of the decisions and of the syndrome after every iteration.
+# "check" compares each trace with the stored one in golden/, "update"
+# replaces the stored traces after an intended change in decoding.
+#
+# With a tolerance of 0 (the default) traces must match bit for bit.
+# A tolerance t > 0 is for kernels whose floating-point sums are
+# reassociated, which can flip near-tie decisions: a trace then passes
+# when at most a fraction t of its frames differ anywhere.
+#
+# ISA=avx2 (or sse41, generic, ...) runs the SIMD decoders with that
+# kernel instead of the best one the host supports; all of them must
+# match the same traces. The flooding min-sum decoders are also run
+# with --code-kernel off, and both paths must match the same traces. A
+# variant whose binary is missing fails the check.
+
+MODE=${1:-check}
+TOLERANCE=${2:-0}
+BIN=${BIN:-./bin}
+GOLDEN=./golden
+ALIST=./codes/PEGReg504x1008/PEGReg504x1008.alist
+WORK=$(mktemp -d)
+trap "rm -rf $WORK" EXIT
+LOG=$WORK/log
+
+if [ "$MODE" != "check" ] && [ "$MODE" != "update" ]; then
+    echo "Usage: $0 [check|update] [tolerance]"
+    exit 1
+fi
+
+###################################
+### RUNS                        ###
+###################################
+# name  frames  arguments (after the alist and rate)
+RUNS="
+decodeGDBF                     20 4.0 30 -0.9 $LOG
+decodeStochasticNGDBF          20 4.0 30 -0.9 $LOG 0.95 4 2.25 2.5
+decodeMGDBF                    20 4.0 30 -0.9 $LOG
+decodeSGDBF                    20 4.0 30 -0.9 $LOG
+decodeSMGDBF                   20 4.0 30 -0.9 $LOG 5
+decodeMNGDBF                   20 4.0 30 -0.9 $LOG 0.95 0.99 2.25 2.5
+decodeSMNGDBF                  20 4.0 30 -0.9 $LOG 0.95 0.99 2.25 5 2.5
+decodeSATGDBF                  20 4.0 30 -0.9 $LOG 0.99 5
+decodeATGDBF                   20 4.0 30 -0.9 $LOG 0.99
+decodeRSMNGDBF                 20 4.0 30 -0.9 $LOG 0.95 0.99 1.0 5 2.5 3
+decodeBitslicedGDBF            64 4.0 30 -0.9 $LOG
+decodeBitslicedMGDBF           64 4.0 30 -0.9 $LOG
+decodeBitslicedSGDBF           64 4.0 30 -0.9 $LOG
+decodeMinSum                   20 2.0 20 $LOG
+decodeOffsetMinSum             20 2.0 20 2.0 5 0.25 $LOG
+decodeNormalizedMinSum         20 2.0 20 2.0 5 0.75 $LOG
+decodeLayeredMinSum            20 2.0 20 $LOG
+decodeLayeredOffsetMinSum      20 2.0 20 2.0 5 0.25 $LOG
+decodeLayeredNormalizedMinSum  20 2.0 20 2.0 5 0.75 $LOG
+decodeSIMDMinSum               64 2.0 20 2.0 5 $LOG
+decodeSIMDOffsetMinSum         64 2.0 20 2.0 5 1 $LOG
+decodeSIMDNormalizedMinSum     64 2.0 20 2.0 5 0.75 $LOG
+decodeBP                       20 2.0 20 $LOG
+decodeDDBMP                    20 2.5 50 1.0 3 $LOG
+"
+
+# Number of frames whose lines differ between two traces, out of
+# the frames in the golden one:
+compareTraces() {
+    awk '
+	FNR == NR { golden[$1] = golden[$1] "|" $0; next }
+	{ trace[$1] = trace[$1] "|" $0 }
+	END {
+	    for (f in golden) {
+		frames++;
+		if (trace[f] != golden[f])
+		    differ++;
+	    }
+	    for (f in trace)
+		if (!(f in golden))
+		    differ++;
+	    print differ+0, frames+0;
+	}' $1 $2
+}
+
+mkdir -p $GOLDEN
+FAILED=0
+# Usage: runTrace LABEL NAME args...
+# Runs $BIN/NAME with args and checks its trace against golden/NAME.trace.
+# A LABEL other than NAME marks another path through the same decoder,
+# which is always checked against that trace, even on update.
+runTrace() {
+    LABEL=$1; NAME=$2; shift 2
+    if [ ! -x $BIN/$NAME ]; then
+	echo "$LABEL: FAILED, $BIN/$NAME not built"
+	FAILED=1
+	return
+    fi
+    $BIN/$NAME --trace $WORK/trace "$@" < /dev/null > $WORK/out || { cat $WORK/out; FAILED=1; return; }
+    if [ "$MODE" = "update" ] && [ "$LABEL" = "$NAME" ]; then
+	cp $WORK/trace $GOLDEN/$NAME.trace
+	echo "$LABEL: updated ($(wc -l < $GOLDEN/$NAME.trace) lines)"
+	return
+    fi
+    if [ ! -f $GOLDEN/$NAME.trace ]; then
+	echo "$LABEL: FAILED, no golden trace"
+	FAILED=1
+	return
+    fi
+    set -- $(compareTraces $GOLDEN/$NAME.trace $WORK/trace)
+    if awk -v d=$1 -v n=$2 -v t=$TOLERANCE 'BEGIN { exit !((t == 0) ? (d == 0) : (d <= t*n)) }'; then
+	echo "$LABEL: ok ($1 of $2 frames differ)"
+    else
+	echo "$LABEL: FAILED ($1 of $2 frames differ)"
+	FAILED=1
+    fi
+}
+
+while read NAME FRAMES ARGS
+do
+    [ -z "$NAME" ] && continue
+    case $NAME in
+	decodeSIMD*) [ -n "$ISA" ] && ARGS="--isa $ISA $ARGS" ;;
+    esac
+    runTrace $NAME $NAME --threads 1 --seed 1 --max-frames $FRAMES $ALIST 0.5 $ARGS
+done <<< "$RUNS"
+
+# The flooding min-sum runs above use the kernel generated for
+# PEGReg504x1008 (see inc/codekernel.h); the generic node updates must
+# give the same traces:
+for NAME in decodeMinSum decodeOffsetMinSum decodeNormalizedMinSum
+do
+    set -- $(awk -v n=$NAME '$1 == n' <<< "$RUNS")
+    FRAMES=$2; shift 2
+    runTrace "$NAME --code-kernel off" $NAME --code-kernel off --threads 1 --seed 1 --max-frames $FRAMES $ALIST 0.5 "$@"
+done
+
+# NGDBFhw takes the seed and frame count as arguments, for the 802.3
+# code it was written for:
+runTrace NGDBFhw NGDBFhw ./codes/802_3/802_3_H.alist 4.5 20 1 $LOG
+
+if [ $FAILED -eq 0 ]; then
+    echo "All traces match"
+else
+    echo "Golden trace check FAILED"
+fi
+exit $FAILED
@@ -21,22 +21,20 @@ ALPHA=2.25
 RATE=0.5
 SNR=3.0
 WINDOWSIZE=64
+YMAX=2.5
 
 ###################################
 ### SIMULATION COMMANDS         ###
 ###################################
-# NOTE: These commands are executed in parallel. 
-# To run the simulations sequentially, remove the
-# "nohup" and the "&" from the command below.
-for SNR in 2.5 3.0
-do
-for NOISESCALE in 0.6 0.65 0.7 0.725 0.75 0.775 0.8 0.85 0.9 0.95 1.05 1.1 1.15 1.2
-do
-#echo .
- echo Running ./bin/decodeSMNGDBF $ALIST $RATE $SNR $ITER $THETA $LOGNAME $NOISESCALE $LAMBDA $ALPHA $WINDOWSIZE $datafile \> tmp/nohup_ngdbf${SNR}.out
- nohup ./bin/decodeSMNGDBF $ALIST $RATE $SNR $ITER $THETA $LOGNAME $NOISESCALE $LAMBDA $ALPHA $WINDOWSIZE $datafile > tmp/nohup_ngdbf${SNR}.out &
-done
-done
+# NOTE: Each command sweeps every listed SNR and NOISESCALE
+# value in one process, writing one log line per point, with
+# one worker thread per core (--threads 0). The commands are
+# executed in parallel; to run them sequentially, remove the
+# "nohup" and the "&" from the commands below.
+SNR=2.5,3.0
+NOISESCALE=0.6,0.65,0.7,0.725,0.75,0.775,0.8,0.85,0.9,0.95,1.05,1.1,1.15,1.2
+echo Running ./bin/decodeSMNGDBF --threads 0 $ALIST $RATE $SNR $ITER $THETA $LOGNAME $NOISESCALE $LAMBDA $ALPHA $WINDOWSIZE $YMAX $datafile \> tmp/nohup_ngdbf_sweep.out
+nohup ./bin/decodeSMNGDBF --threads 0 $ALIST $RATE $SNR $ITER $THETA $LOGNAME $NOISESCALE $LAMBDA $ALPHA $WINDOWSIZE $YMAX $datafile > tmp/nohup_ngdbf_sweep.out &
 
 ########################################################
 # DIFFERENT PARAMETERS WORK BETTER AT HIGHER SNR VALUES:
@@ -45,8 +43,7 @@ LAMBDA=0.988
 ALPHA=2.3
 SNR=3.75
 
-for NOISESCALE in 1.05 1.1 1.15 1.2
-do
- echo Running ./bin/decodeSMNGDBF $ALIST $RATE $SNR $ITER $THETA $LOGNAME $NOISESCALE $LAMBDA $ALPHA $WINDOWSIZE $datafile \> tmp/nohup_ngdbf${SNR}.out
- nohup ./bin/decodeSMNGDBF $ALIST $RATE $SNR $ITER $THETA $LOGNAME $NOISESCALE $LAMBDA $ALPHA $WINDOWSIZE $datafile > tmp/nohup_ngdbf${SNR}.out &
-done
+NOISESCALE=1.05:0.05:1.2
+
+echo Running ./bin/decodeSMNGDBF --threads 0 $ALIST $RATE $SNR $ITER $THETA $LOGNAME $NOISESCALE $LAMBDA $ALPHA $WINDOWSIZE $YMAX $datafile \> tmp/nohup_ngdbf${SNR}.out
+nohup ./bin/decodeSMNGDBF --threads 0 $ALIST $RATE $SNR $ITER $THETA $LOGNAME $NOISESCALE $LAMBDA $ALPHA $WINDOWSIZE $YMAX $datafile > tmp/nohup_ngdbf${SNR}.out &
@@ -40,6 +40,13 @@ using namespace std;
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
 #include "rand.h"
+#include "rand_normal.h"
+#include "tanner.h"
+#include "codewords.h"
+#include "options.h"
+#include "records.h"
+#include "instrument.h"
+#include "trace.h"
 
 
 //============ GLOBAL PARAMETERS ============//
@@ -56,7 +63,7 @@ long   seed           = 1234;  // Random number generator seed
 const int NQ          = 5;     // Number of bits for quantization
 double theta0         = -0.525;
 
-alist_struct H;                // Code definition
+tanner_struct G;               // Code definition (flat Tanner graph)
 string logfilename;            // Filename for output data
 
 
@@ -79,7 +86,7 @@ int unpack(unsigned long sample);
 unsigned long packbig(int sample, int sign);
 int unpackbig(unsigned long sample);
 int find(int symNodes[], int len, int snode);
-int countDecisionErrors(vector<int> d, vector<int> c);
+int countDecisionErrors(const vector<int> & d, const vector<int> & c);
 double sgn(double y);
 vector<string> setupUsage();
 void   parseArguments(int argc, char * argv[]);
@@ -98,11 +105,14 @@ int main(int argc, char * argv[])
 {
 
   //=========== Handle command line arguments ============//
+  string resultsFile = extractStringOption(argc, argv, "results", "");
+  bool   profiling   = extractLongOption(argc, argv, "profile", 0);
+  decode_trace trace = openTrace(argc, argv, 1);
   vector<string> command_arguments = setupUsage();
 
   if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
     {
-      cout << "Usage: " << argv[0];
+      cout << "Usage: " << argv[0] << RESULTS_USAGE << PROFILE_USAGE << TRACE_USAGE;
       for (int i=0; i<command_arguments.size(); i++)
 	cout << " " << command_arguments[i];
       cout << "\n";
@@ -112,12 +122,13 @@ int main(int argc, char * argv[])
   parseArguments(argc, argv);
 
   ran_seed(seed); 
+  ran_normal_seed(seed, 0);
 
-  ifstream codewordFile;
+  codeword_stream codewords;
   if (argc == command_arguments.size()+1)
     {
-      cout << "\nUsing codewords from " << argv[argc] << endl;
-      codewordFile.open(argv[argc],ios::in);
+      cout << "\nUsing codewords from " << argv[argc-1] << endl;
+      openCodewords(codewords, argv[argc-1], G.N);
     }
   else
     cout << "\nUsing all-zero sequence.\n";
@@ -129,27 +140,28 @@ int main(int argc, char * argv[])
   double noiseSigma = sigma*noiseScale;
 
   // Get code parameters:
-  int dv = H.biggest_num_n;
-  int dc = H.biggest_num_m;
+  int dv = G.biggest_dv;
+  int dc = G.biggest_dc;
 
   // Report initial status messages:
-  cout << "Simulating GDBF decoding on code with N=" << H.N << ", M=" << H.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
+  cout << "Simulating GDBF decoding on code with N=" << G.N << ", M=" << G.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
   cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
 
 
   // Declare top-level variables:
-  vector<int>    c(H.N,0);      // Bipolar codeword (all +1 in this simulation)
-  vector<double> x(H.N,1);      // Modulated codeword (all +1 in this simulation)
+  vector<int>    c(G.N,0);      // Bipolar codeword (all +1 in this simulation)
+  vector<double> x(G.N,1);      // Modulated codeword (all +1 in this simulation)
   vector<double> y(x);          // Channel samples
   vector<double> ymodified(x);  // Modified channel samples
-  vector<double>    yprime(H.N,0); // Modified and quantized channel samples
-  vector<int>    r(H.N);        // Received bipolar decisions (+1 or -1)
-  vector<int>    d(H.N,0);      // Decoder outputs (0 or 1 after decoding)
-  vector<int>    E(H.N,0);      // Flip function
-  vector<int>    flip(H.N,0);      // Flip activity
+  vector<double>    yprime(G.N,0); // Modified and quantized channel samples
+  vector<int>    r(G.N);        // Received bipolar decisions (+1 or -1)
+  vector<int>    d(G.N,0);      // Decoder outputs (0 or 1 after decoding)
+  vector<int>    E(G.N,0);      // Flip function
+  vector<int>    flip(G.N,0);      // Flip activity
 
   vector<double> qmodified(2648,0.0);
   vector<double> qprime(2648,0.0);
+  vector<double> gauss(max((size_t)G.N, qprime.size())); // Batch of standard normal deviates
   int qpointer=0;
 
   // Declare and initialize statistics variables:
@@ -160,11 +172,11 @@ int main(int argc, char * argv[])
   long wordErrors = 0;        // Number of word errors observed
   long totalIterations = 0;   // Total number of iterations accumulated over all frames.
 
-  vector<int> error_weight_hist(H.N,0);       // Vector to serve as histogram of error-pattern weights (1 up to H.N)
+  vector<int> error_weight_hist(G.N,0);       // Vector to serve as histogram of error-pattern weights (1 up to G.N)
   vector<double> itdist(num_iterations,0.0);  // Cumulative distribution of completion times
 
   // Declare and initialize message memories:
-  vector<int> syndrome(H.M,0);
+  vector<int> syndrome(G.M,0);
 
   /////////////////////////////////////////////////////////////////
   // ------===== MAIN TEST LOOP =====-------
@@ -190,34 +202,26 @@ int main(int argc, char * argv[])
       ofmsgs << "\tSmult = " << Smult << endl;
   #endif
 
+  run_timer timer = startTimer();
+  profiler prof(profiling, 1);
+  stage_clock stages(prof, 0);
   while (totalWords < numFrames)
     {
-      string s;
       // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
+      if (codewords.frames > 0)
 	{
-	  getline(codewordFile, s);
-	  if (codewordFile.eof())
+	  const uint8_t * row = nextCodeword(codewords);
+	  for (i=0; i<G.N; i++)
 	  {
-	    codewordFile.clear();
-	    codewordFile.seekg(0);
-	    getline(codewordFile, s);
-	  }
-	  for (i=0; i<H.N; i++)
-	  {	    
-	    if (s[i] == '1')	      
-	      c[i] = 1;
-	    else if (s[i] == '0')
-	      c[i] = 0;
-	    else
-	      cout << "Got an invalid symbol at index " << i << endl;
+	    c[i] = codewordBit(row, i);
 	    x[i] = 1-2*c[i];
 	  }
 	}
       // Emulate AWGN or BSC transmission      
-      for (i=0; i<H.N; i++)
+      ran_normals(&gauss[0], G.N);
+      for (i=0; i<G.N; i++)
 	{
-	  y[i] = x[i]*(1.0+sigma*rann());
+	  y[i] = x[i]*(1.0+sigma*gauss[i]);
 
 	  if (abs(y[i])>Ymax)
 	    y[i] *= Ymax/abs(y[i]);
@@ -236,9 +240,10 @@ int main(int argc, char * argv[])
 
       quantize(ymodified, yprime);
 
+      ran_normals(&gauss[0], qprime.size());
       for (i=0; i<qprime.size(); i++)
 	{
-	  double q = noiseSigma*rann();
+	  double q = noiseSigma*gauss[i];
 	  //if (abs(q)>Ymax)
 	  //  q = q*Ymax/abs(q);
 	  qmodified[i] = ((q-theta0)/(2.0*w) - 1.0);
@@ -250,6 +255,7 @@ int main(int argc, char * argv[])
 	  //qprime[i]=round(128.0*qmodified[i])/128.0;
 	}
       quantize(qmodified, qprime);
+      stages.lap(STAGE_CHANNEL);
 
       bool satisfied;
       int it;
@@ -257,10 +263,10 @@ int main(int argc, char * argv[])
 
       //-------------- Out Multi-Phase Loop -----------------//
       int leastIterations=num_iterations;
-      int leastErrors=H.N;
+      int leastErrors=G.N;
       #ifdef LOG_PROCESSING
       if (totalWords==0) {
-      for (int idx=0; idx<H.N; idx++) {
+      for (int idx=0; idx<G.N; idx++) {
 	unsigned long yul = yprime[idx];
 	std::bitset<NQ> by(yul);
 	ofchanin << by << endl;
@@ -268,19 +274,20 @@ int main(int argc, char * argv[])
 	std::bitset<NQ> bn(qul);
 	ofnoise << bn << endl;
       }
-      for (int idx=H.N; idx<qprime.size(); idx++)
+      for (int idx=G.N; idx<qprime.size(); idx++)
 	{
 	unsigned long qul = qprime[idx];
 	std::bitset<NQ> bn(qul);
 	ofnoise << bn << endl;
 	}
     }
+      stages.lap(STAGE_IO);
       #endif
 
       for (int phase=0; phase<maxPhases; phase++)
 	{
 	  //	  theta = theta0;
-	  for (int idx=0; idx<H.N; idx++)
+	  for (int idx=0; idx<G.N; idx++)
 	    {
 	      d[idx] = (1-r[idx])/2;
 	    }
@@ -295,16 +302,19 @@ int main(int argc, char * argv[])
 	      //'''''''''''''''''''''''''''''''''''''''''''''''
 	      // First update the check nodes:
 	      checkNodeUpdates(d,syndrome,satisfied);
+	      stages.lap(STAGE_CHECK);
 	      if (satisfied)
 		break;
 	  
 	      // Then perform Symbol node updates:
 	      symNodeUpdates(yprime, d, syndrome, E, qprime,qpointer,flip);
+	      stages.lap(STAGE_SYMBOL);
+	      traceIteration(trace, G, 0, it, [&d](int i) { return d[i] != 0; });
 
 	      #ifdef LOG_PROCESSING
 	      if (totalWords==0) {
 	      ofmsgs << "IT " << it << endl;
-	      for (int idx=0; idx<H.N; idx++)
+	      for (int idx=0; idx<G.N; idx++)
 		{
 		  ofmsgs << "S" << idx << ":\n";
 		  unsigned long yul = yprime[idx];
@@ -313,8 +323,8 @@ int main(int argc, char * argv[])
 		  
 		  ofmsgs << "\tin_messages: ";
 		  int SSum = 0;
-		  for (int jdx=0; jdx<H.num_nlist[idx]; jdx++) {
-		    int msg = syndrome[H.nlist[idx][jdx]-1];
+		  for (int kdx=G.sym_start[idx]; kdx<G.sym_start[idx+1]; kdx++) {
+		    int msg = syndrome[G.sym_check[kdx]];
 		    ofmsgs << msg  << " ";
 		    SSum += 1-msg;
 		  }
@@ -332,6 +342,7 @@ int main(int argc, char * argv[])
 		  ofmsgs << "\tflip: " << flip[idx] << endl;
 		}
 	    }
+	      stages.lap(STAGE_IO);
 	      #endif
 
 
@@ -354,7 +365,7 @@ int main(int argc, char * argv[])
 	      // ..............................................
 	      
 	      qpointer++;
-	      if (qpointer >= (qprime.size()-H.N))
+	      if (qpointer >= (qprime.size()-G.N))
 		qpointer=0;
 	}
       
@@ -362,7 +373,9 @@ int main(int argc, char * argv[])
       // -------------------------------------------------------------
 
 
-      // Count remaining errors after decoding:
+      // Count remaining errors after decoding (each phase adds an
+      // end line to the trace):
+      traceFrame(trace, G, 0, it, [&d](int i) { return d[i] != 0; });
       int newErrors = countDecisionErrors(d,c);
       
       // Count least iterations from repeated decoding:
@@ -389,7 +402,7 @@ int main(int argc, char * argv[])
 	  error_weight_hist[leastErrors-1]++;
 	  wordErrors++;
 	  
-	  cout << " BER=" << (double)errors/(totalBits+H.N) << ", WER=" << (double) wordErrors/(totalWords+1) << endl;
+	  cout << " BER=" << (double)errors/(totalBits+G.N) << ", WER=" << (double) wordErrors/(totalWords+1) << endl;
 	  // ------------------------------------------------
 	  // WRITE ERROR PATTNERS TO FILE
 	  // ------------------------------------------------
@@ -399,7 +412,7 @@ int main(int argc, char * argv[])
 	  ss2 << logfilename << "_" << SNR << "_dec.dat";
 	  ofstream oferrpat(ss1.str().c_str(),ios::app);
 	  ofstream ofdec(ss2.str().c_str(),ios::app);
-	  for (int idx=0; idx<H.N; idx++)
+	  for (int idx=0; idx<G.N; idx++)
 	    {
 	      oferrpat << y[idx] << "\t";
 	      ofdec << d[idx] << "\t";
@@ -413,8 +426,9 @@ int main(int argc, char * argv[])
 
       // Increment frame and bit counters:
       totalWords++;
-      totalBits += H.N;
+      totalBits += G.N;
       totalIterations += leastIterations;
+      traceNext(trace, 1);
 
       // Update cumulative distribution of completion times:
       for (int idx=0; idx<=leastIterations; idx++)
@@ -431,6 +445,7 @@ int main(int argc, char * argv[])
 	       << "\nError weights:\n";
 	  printHistogram(error_weight_hist);
 	}
+      stages.lap(STAGE_IO);
       // ------------------------------------------------
 
     }
@@ -446,6 +461,21 @@ int main(int argc, char * argv[])
        << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
        << (double)uncodedErrors/totalBits << endl;      
 
+  // This loop does not track the squared sums, which only the
+  // importance-sampling estimates use:
+  frame_totals totals = {errors, uncodedErrors, totalBits, totalWords, wordErrors, totalIterations,
+			 (double) errors, 0.0, (double) wordErrors, 0.0};
+  profileReport(prof, totals, G.E);
+  if (!resultsFile.empty())
+    {
+      result_record rec;
+      sweep_struct noSweep;
+      recordRun(rec, argc, argv, command_arguments, noSweep, seed, 1);
+      recordTotals(rec, totals, timer);
+      recordProfile(rec, prof, totals, G.E);
+      writeResultRecord(resultsFile, rec);
+    }
+
   ofstream of(logfilename.c_str(),ios::app);
   char tab = '\t';
   of << SNR << tab << errors << tab << wordErrors << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
@@ -467,6 +497,7 @@ int main(int argc, char * argv[])
   for (int idx=0; idx<itdist.size(); idx++)
     ofitdist << idx << "\t" << itdist[idx] << "\n";
   ofitdist.close();
+  closeTrace(trace);
 
   return 0;
 }
@@ -495,7 +526,7 @@ void parseArguments(int argc, char * argv[])
 {
   // Parse command arguments:
   int idx=1;
-  H = loadFile(argv[idx++]);
+  G = loadTanner(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
   SNR = atof(argv[idx++]);
   cout << " SNR = \t" << SNR << endl;
@@ -527,7 +558,7 @@ void printHistogram(vector<int> & h)
     }
 }
 
-int countDecisionErrors(vector<int> d, vector<int> c)
+int countDecisionErrors(const vector<int> & d, const vector<int> & c)
 {
   int errs =0 ;
   for (int i=0; i<d.size(); i++)
@@ -547,13 +578,12 @@ void checkNodeUpdates(vector<int> & d, vector<int> & syndrome, bool & satisfied)
 {
   int msg;
   satisfied = true;
-  for (int i=0; i<H.M; i++)
+  for (int i=0; i<G.M; i++)
     {
       int prod = 1;
-      for (int j=0; j<H.num_mlist[i]; j++)
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
 	{
-	  int snode = H.mlist[i][j]-1;
-	  msg = d[snode];
+	  msg = d[G.check_sym[e]];
 	  prod *= (1-2*msg);
 	}
       if (prod < 0)
@@ -568,16 +598,15 @@ void symNodeUpdates(vector<double> & yprime, vector<int> & d, vector<int> & synd
   double lmax=Ymax/(2.0*w);
   double NL=qmax-1;
   
-  for (int i=0; i<H.N; i++)
+  for (int i=0; i<G.N; i++)
     {
       E[i] = (1-2*d[i])*unpack(yprime[i]);//*(lmax/NL);
 
-      int dv = H.num_nlist[i];
+      int dv = G.sym_start[i+1]-G.sym_start[i];
       double SSum=0;
-      for (int j=0; j<H.num_nlist[i]; j++)
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
 	{
-	  int cnode = H.nlist[i][j]-1;
-	  int msg = syndrome[cnode];
+	  int msg = syndrome[G.sym_check[k]];
 	  SSum += 1-msg;	  
 	}      
       E[i] += SSum*Smult+unpack(qprime[i+qpointer]);//*(lmax/NL);
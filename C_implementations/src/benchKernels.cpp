@@ -0,0 +1,318 @@
+/*==========================================================================================
+** benchKernels.cpp
+
+** Description:
+   Micro-benchmarks of the shared kernels on one or more codes:
+
+     alist_parse        read an alist file and build the Tanner graph
+     tanner_load        loadTanner(), which maps the .csr cache
+     noise_batch        ran_normals() for one frame of N samples
+     noise_scalar       N samples from rann(), as the decoders draw them
+     encode             randomCodeword(), when the generator can be
+                        derived from H in reasonable time
+     gdbf_check         the GDBF decoders' full check update, and
+     gdbf_symbol        symbol update of the MNGDBF variant, which
+                        scans every symbol (gdbf_kernels.h)
+     gdbf_syndrome      the incremental syndrome update for the flips
+                        of one such symbol update
+     minsum_check       the flooding min-sum node updates
+     minsum_symbol      (minsum_kernels.h), and with _code appended,
+                        those of the code's generated kernel if one is
+                        linked (codekernel.h)
+     bp_check           the BP node updates (bp_kernels.h)
+     bp_symbol
+     ddbmp_check        the DD-BMP node updates (ddbmp_kernels.h)
+     ddbmp_symbol
+     simdms_<isa>       one frame-parallel min-sum iteration on
+                        SIMDMS_LANES frames, for each supported ISA
+
+   Every benchmark is calibrated so that a repetition lasts at least
+   10 ms, run for --warmup repetitions, then timed for --reps
+   repetitions. The random streams are reseeded with --seed before
+   each benchmark, so runs are repeatable. The time per call is
+   printed as median, mean, standard deviation and minimum over the
+   repetitions, and each benchmark is appended to the --results file
+   as a result record (records.h).
+
+   The node updates run on the channel samples of one all-zero frame,
+   at a noise level where decoding would take many iterations. They
+   are built without -O, as the decoders are. scripts/bench.sh also
+   runs the decoders with --profile 1, which times each decoding
+   stage in context.
+
+   Usage: benchKernels [--reps R] [--warmup W] [--seed S] [--results FILE] alist [alist ...]
+==============================================================================================*/
+
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+
+using namespace std;
+
+#include "alist.h"
+#include "tanner.h"
+#include "rand_xoshiro.h"
+#include "rand_normal.h"
+#include "options.h"
+#include "encoder.h"
+#include "simdms.h"
+#include "gdbf_kernels.h"
+#include "minsum_kernels.h"
+#include "bp_kernels.h"
+#include "ddbmp_kernels.h"
+#include "codekernel.h"
+#include "records.h"
+
+// Generators whose derivation would take more word operations than
+// this are skipped (see encoder.h):
+#define MAX_ENCODER_WORK 1e10
+
+// Message clipping of the BP updates, as in decodeBP:
+#define BENCH_MAXLLR 20.0
+
+// The MNGDBF variant (see decodeGDBF.cpp):
+typedef gdbf_variant<false, false, true, true, true, false, true, false, false> bench_gdbf;
+
+typedef struct {
+  int         reps;
+  int         warmup;
+  long        seed;
+  std::string resultsFile;
+  const char * program;
+} bench_options;
+
+static double timeBatch(const function<void()> & call, long calls)
+{
+  auto start = chrono::steady_clock::now();
+  for (long k=0; k<calls; k++)
+    call();
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+// edgesPerCall is the number of edge updates one call performs, or 0
+// when edge throughput does not apply.
+static void runBench(const bench_options & O, const char * name, const char * code, tanner_struct & G,
+		     const function<void()> & call, double edgesPerCall)
+{
+  ran_stream(O.seed, 0);
+  ran_normal_seed(O.seed, 0);
+
+  long calls = 1;
+  while ((timeBatch(call, calls) < 0.01) && (calls < (1L << 24)))
+    calls *= 2;
+  for (int w=0; w<O.warmup; w++)
+    timeBatch(call, calls);
+
+  vector<double> ns(O.reps);
+  for (int r=0; r<O.reps; r++)
+    ns[r] = 1e9*timeBatch(call, calls)/calls;
+  double mean = 0.0, var = 0.0;
+  for (int r=0; r<O.reps; r++)
+    mean += ns[r]/O.reps;
+  for (int r=0; r<O.reps; r++)
+    var += (ns[r] - mean)*(ns[r] - mean)/((O.reps > 1) ? O.reps - 1 : 1);
+  sort(ns.begin(), ns.end());
+  double median = (O.reps % 2) ? ns[O.reps/2] : 0.5*(ns[O.reps/2 - 1] + ns[O.reps/2]);
+
+  printf("%-20s %-18s %12.0f ns  (mean %.0f, sd %.0f, min %.0f; %ld calls x %d reps)\n",
+	 name, code, median, mean, sqrt(var), ns[0], calls, O.reps);
+
+  if (O.resultsFile.empty())
+    return;
+  result_record rec;
+  recordHeader(rec, O.program, O.seed, 1);
+  recordString(rec, "benchmark", name);
+  recordString(rec, "code", code);
+  recordCount(rec, "N", G.N);
+  recordCount(rec, "M", G.M);
+  recordCount(rec, "E", G.E);
+  recordCount(rec, "reps", O.reps);
+  recordCount(rec, "calls_per_rep", calls);
+  recordNumber(rec, "median_ns", median);
+  recordNumber(rec, "mean_ns", mean);
+  recordNumber(rec, "stddev_ns", sqrt(var));
+  recordNumber(rec, "min_ns", ns[0]);
+  recordNumber(rec, "edge_updates_per_s", (edgesPerCall > 0.0) ? 1e9*edgesPerCall/median : NAN);
+  writeResultRecord(O.resultsFile, rec);
+}
+
+
+// Each update is timed on fixed inputs. The GDBF symbol update and
+// the DD-BMP symbol update change their own state as they go, which
+// does not change the work per call: the GDBF thresholds are kept
+// fixed (lambda = 1), so they cannot decay into denormals.
+static void benchNodeUpdates(const bench_options & O, const char * code, tanner_struct & G)
+{
+  vector<double> y(G.N);
+  ran_normal_seed(O.seed, 0);
+  for (int i=0; i<G.N; i++)
+    y[i] = 1.0 + 0.9*ran_normal_pooled();
+
+  vector<double> sym_to_check(G.E), check_to_sym(G.E);
+  vector<int>    d(G.N), syndrome(G.M);
+  bool satisfied;
+  for (int i=0; i<G.N; i++)
+    {
+      d[i] = (y[i] > 0) ? 1 : -1;
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	sym_to_check[k] = y[i];
+    }
+
+  // GDBF, from the hard decisions:
+  vector<int>    check_prod(G.M);
+  vector<double> thetas(G.N, -0.9), perturbation(G.N);
+  flip_state F;
+  F.S.assign(G.N, 0);
+  F.listed.assign(G.N, 0);
+  F.flips.reserve(G.N);
+  F.candidates.reserve(G.N);
+  for (int i=0; i<G.N; i++)
+    perturbation[i] = 0.9*ran_normal_pooled();
+  double lambda = 1.0, sigma = 0.9;
+  int mu = 1;
+  runBench(O, "gdbf_check", code, G, [&]() { gdbfCheckNodeUpdates(G, d, check_prod, satisfied); }, (double) G.E);
+  initFlipState(G, check_prod, F);
+  runBench(O, "gdbf_symbol", code, G, [&]()
+	   {
+	     gdbfSymNodeUpdates<bench_gdbf>(G, thetas, lambda, 2.25, mu, y, d, F, sigma, perturbation);
+	   }, 0.0);
+  // Replaying the same flips toggles the same checks back and forth:
+  runBench(O, "gdbf_syndrome", code, G, [&]() { gdbfUpdateSyndromes(G, d, check_prod, F); }, 0.0);
+
+  // Min-sum, generic and generated:
+  for (int i=0; i<G.N; i++)
+    d[i] = (y[i] > 0) ? 1 : -1;
+  runBench(O, "minsum_check", code, G, [&]() { minsumCheckNodeUpdates(G, sym_to_check, check_to_sym); }, (double) G.E);
+  vector<double> sym_out(G.E);
+  runBench(O, "minsum_symbol", code, G, [&]()
+	   {
+	     minsumSymNodeUpdates(G, y, d, sym_out, check_to_sym, syndrome, satisfied);
+	   }, (double) G.E);
+  const code_kernel * K = findCodeKernel(G);
+  if (K != NULL)
+    {
+      runBench(O, "minsum_check_code", code, G, [&]() { K->checkNodes(&sym_to_check[0], &check_to_sym[0]); }, (double) G.E);
+      runBench(O, "minsum_symbol_code", code, G, [&]()
+	       {
+		 K->symNodes(&y[0], &d[0], &sym_out[0], &check_to_sym[0], &syndrome[0]);
+	       }, (double) G.E);
+    }
+
+  // BP:
+  vector<double> suffix(G.biggest_dc+1);
+  runBench(O, "bp_check", code, G, [&]()
+	   {
+	     bpCheckNodeUpdates(G, BENCH_MAXLLR, sym_to_check, check_to_sym, suffix);
+	   }, (double) G.E);
+  runBench(O, "bp_symbol", code, G, [&]()
+	   {
+	     bpSymNodeUpdates(G, BENCH_MAXLLR, y, d, sym_out, check_to_sym, syndrome, satisfied);
+	   }, (double) G.E);
+
+  // DD-BMP, whose symbol memories start at the channel samples:
+  vector<double> sym_memories(sym_to_check);
+  runBench(O, "ddbmp_check", code, G, [&]() { ddbmpCheckNodeUpdates(G, sym_to_check, check_to_sym); }, (double) G.E);
+  runBench(O, "ddbmp_symbol", code, G, [&]()
+	   {
+	     ddbmpSymNodeUpdates(G, y, d, sym_out, check_to_sym, sym_memories);
+	   }, (double) G.E);
+}
+
+
+static void benchCode(const bench_options & O, const char * fileName)
+{
+  string path(fileName);
+  size_t slash = path.rfind('/');
+  string code = path.substr((slash == string::npos) ? 0 : slash+1);
+  if ((code.size() > 6) && (code.compare(code.size()-6, 6, ".alist") == 0))
+    code.erase(code.size()-6);
+
+  tanner_struct G = loadTanner(fileName);
+
+  runBench(O, "alist_parse", code.c_str(), G, [&]()
+	   {
+	     alist_struct H = loadFile(fileName);
+	     tanner_struct T = buildTanner(H);
+	     freeTanner(T);
+	     freeAlist(H);
+	   }, 0.0);
+
+  runBench(O, "tanner_load", code.c_str(), G, [&]()
+	   {
+	     tanner_struct T = loadTanner(fileName);
+	     freeTanner(T);
+	   }, 0.0);
+
+  vector<double> y(G.N);
+  runBench(O, "noise_batch", code.c_str(), G, [&]() { ran_normals(&y[0], G.N); }, 0.0);
+  runBench(O, "noise_scalar", code.c_str(), G, [&]()
+	   {
+	     for (int i=0; i<G.N; i++)
+	       y[i] = rann();
+	   }, 0.0);
+
+  if ((double) G.M*G.M*G.N/64 <= MAX_ENCODER_WORK)
+    {
+      encoder_struct E = deriveEncoder(G);
+      vector<uint64_t> acc(E.words);
+      vector<int> c(G.N);
+      runBench(O, "encode", code.c_str(), G, [&]() { randomCodeword(E, ran_state, &acc[0], c); }, 0.0);
+    }
+  else
+    printf("%-20s %-18s skipped: generator too costly to derive\n", "encode", code.c_str());
+
+  benchNodeUpdates(O, code.c_str(), G);
+
+  // Channel LLRs for the all-zero word at a noise level where few
+  // lanes converge, so the iterations do full work:
+  simdms_frames F = allocSimdFrames(G);
+  ran_normal_seed(O.seed, 0);
+  for (int i=0; i<G.N*SIMDMS_LANES; i++)
+    {
+      long q = lround(4.0*(1.0 + 0.9*ran_normal_pooled()));
+      F.ch[i] = (int8_t) max(-7L, min(7L, q));
+    }
+  simdms_params P;
+  P.offset = 0;
+  P.scale = 16;
+  const char * isas[] = { "generic", "sse41", "avx2", "avx512" };
+  for (int k=0; k<4; k++)
+    {
+      if (!simdIsaSupported(isas[k]))
+	continue;
+      simdms_kernel K = selectSimdKernel(isas[k]);
+      initSimdFrames(G, F);
+      string name = string("simdms_") + K.name;
+      runBench(O, name.c_str(), code.c_str(), G, [&]() { K.iterate(G, F, P); }, (double) G.E*SIMDMS_LANES);
+    }
+  freeSimdFrames(F);
+  freeTanner(G);
+}
+
+
+int main(int argc, char * argv[])
+{
+  bench_options O;
+  O.reps        = extractLongOption(argc, argv, "reps", 10);
+  O.warmup      = extractLongOption(argc, argv, "warmup", 3);
+  O.seed        = extractLongOption(argc, argv, "seed", 1);
+  O.resultsFile = extractStringOption(argc, argv, "results", "");
+  O.program     = argv[0];
+  if ((argc < 2) || (O.reps < 1) || (O.warmup < 0))
+    {
+      cout << "Usage: " << argv[0] << " [--reps R] [--warmup W] [--seed S]" << RESULTS_USAGE << " alist [alist ...]" << endl;
+      return 0;
+    }
+
+  for (int k=1; k<argc; k++)
+    benchCode(O, argv[k]);
+  return 0;
+}
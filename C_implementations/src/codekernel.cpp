@@ -0,0 +1,106 @@
+/*==========================================================================================
+** codekernel.cpp
+
+** Description:
+   Registry of the code-specialized min-sum kernels. See codekernel.h.
+==============================================================================================*/
+
+
+#include "codekernel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <vector>
+using namespace std;
+
+
+// The registrars run before main(), in no fixed order, so the list
+// is built on first use:
+static vector<const code_kernel *> & linkedKernels()
+{
+  static vector<const code_kernel *> kernels;
+  return kernels;
+}
+
+
+static void hashInts(uint64_t & h, const int * v, int n)
+{
+  for (int k=0; k<n; k++)
+    for (int b=0; b<32; b+=8)
+      {
+	h ^= ((uint32_t) v[k] >> b) & 0xff;
+	h *= 1099511628211ULL;
+      }
+}
+
+
+// FNV-1a over the sizes and the check-major edges, which determine
+// the rest of the graph:
+uint64_t tannerSignature(const tanner_struct & G)
+{
+  uint64_t h = 14695981039346656037ULL;
+  int sizes[3] = { G.N, G.M, G.E };
+  hashInts(h, sizes, 3);
+  hashInts(h, G.check_start, G.M+1);
+  hashInts(h, G.check_sym, G.E);
+  return h;
+}
+
+
+static bool kernelMatches(const code_kernel * K, const tanner_struct & G, uint64_t signature)
+{
+  return (K->N == G.N) && (K->M == G.M) && (K->E == G.E) && (K->signature == signature);
+}
+
+
+void registerCodeKernel(const code_kernel * K)
+{
+  linkedKernels().push_back(K);
+}
+
+
+const code_kernel * findCodeKernel(const tanner_struct & G)
+{
+  vector<const code_kernel *> & kernels = linkedKernels();
+  if (kernels.empty())
+    return NULL;
+  uint64_t signature = tannerSignature(G);
+  for (size_t k=0; k<kernels.size(); k++)
+    if (kernelMatches(kernels[k], G, signature))
+      return kernels[k];
+  return NULL;
+}
+
+
+const code_kernel * loadCodeKernel(const char * fileName, const tanner_struct & G)
+{
+  void * lib = dlopen(fileName, RTLD_NOW | RTLD_LOCAL);
+  if (lib == NULL)
+    {
+      fprintf(stderr, "Cannot load code kernel %s: %s\n", fileName, dlerror());
+      exit(1);
+    }
+  const code_kernel * K = (const code_kernel *) dlsym(lib, "sharedCodeKernel");
+  if (K == NULL)
+    {
+      fprintf(stderr, "%s does not define a code kernel (built without -D CODE_KERNEL_SHARED?)\n", fileName);
+      exit(1);
+    }
+  if (!kernelMatches(K, G, tannerSignature(G)))
+    {
+      fprintf(stderr, "Code kernel %s was generated for %s, not for this code\n", fileName, K->name);
+      exit(1);
+    }
+  return K;
+}
+
+
+const code_kernel * selectCodeKernel(const char * choice, const tanner_struct & G)
+{
+  if (strcmp(choice, "off") == 0)
+    return NULL;
+  if (strcmp(choice, "auto") == 0)
+    return findCodeKernel(G);
+  return loadCodeKernel(choice, G);
+}
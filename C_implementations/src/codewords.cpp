@@ -0,0 +1,170 @@
+/*==========================================================================================
+** codewords.cpp
+
+** Description:
+   Packed codeword streams. See codewords.h.
+==============================================================================================*/
+
+
+#include "codewords.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+static int mapPacked(codeword_stream & S, const char * fileName, int N);
+
+
+void openCodewords(codeword_stream & S, const char * fileName, int N)
+{
+  S.N = N;
+  S.rowBytes = (N + 7)/8;
+  S.next = 0;
+  if (mapPacked(S, fileName, N))
+    {
+      printf("Mapped %ld packed codewords from %s\n", S.frames, fileName);
+      return;
+    }
+
+  int textN = N;
+  S.frames = packTextCodewords(fileName, textN, S.owned);
+  S.rows = &S.owned[0];
+  S.map_base = NULL;
+  S.map_len = 0;
+}
+
+
+void rewindCodewords(codeword_stream & S)
+{
+  S.next = 0;
+}
+
+
+void closeCodewords(codeword_stream & S)
+{
+  if (S.map_base != NULL)
+    munmap(S.map_base, S.map_len);
+  S.map_base = NULL;
+  S.owned.clear();
+  S.rows = NULL;
+  S.frames = 0;
+}
+
+
+// Read a text codeword file, one codeword per line. If N is 0 it is
+// taken from the first line.
+long packTextCodewords(const char * fileName, int & N, vector<uint8_t> & rows)
+{
+  ifstream f(fileName);
+  if (!f.is_open())
+    {
+      fprintf(stderr, "Cannot open codeword file %s\n", fileName);
+      exit(1);
+    }
+  string s;
+  long frames = 0;
+  rows.clear();
+  while (getline(f, s))
+    {
+      if (!s.empty() && (s[s.size()-1] == '\r'))
+	s.erase(s.size()-1);
+      if (s.empty())
+	continue;
+      if (N == 0)
+	N = s.size();
+      if ((int) s.size() != N)
+	{
+	  fprintf(stderr, "%s line %ld has %d symbols, expected %d\n", fileName, frames+1, (int) s.size(), N);
+	  exit(1);
+	}
+      int rowBytes = (N + 7)/8;
+      rows.resize((size_t)(frames+1)*rowBytes, 0);
+      uint8_t * row = &rows[(size_t)frames*rowBytes];
+      for (int i=0; i<N; i++)
+	{
+	  if (s[i] == '1')
+	    row[i >> 3] |= 1 << (i & 7);
+	  else if (s[i] != '0')
+	    {
+	      fprintf(stderr, "%s line %ld has an invalid symbol at index %d\n", fileName, frames+1, i);
+	      exit(1);
+	    }
+	}
+      frames++;
+    }
+  if (frames == 0)
+    {
+      fprintf(stderr, "No codewords in %s\n", fileName);
+      exit(1);
+    }
+  return frames;
+}
+
+
+void writePackedCodewords(const char * fileName, int N, long frames, const vector<uint8_t> & rows)
+{
+  codeword_file_header hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, CODEWORD_MAGIC, sizeof(hdr.magic));
+  hdr.N = N;
+  hdr.rowBytes = (N + 7)/8;
+  hdr.frames = frames;
+
+  FILE * f = fopen(fileName, "wb");
+  if ((f == NULL)
+      || (fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+      || (fwrite(&rows[0], 1, (size_t)frames*hdr.rowBytes, f) != (size_t)frames*hdr.rowBytes))
+    {
+      fprintf(stderr, "Cannot write %s\n", fileName);
+      exit(1);
+    }
+  fclose(f);
+}
+
+
+// Returns 0 if the file is not a packed codeword file, so that it can
+// be read as text instead.
+static int mapPacked(codeword_stream & S, const char * fileName, int N)
+{
+  codeword_file_header hdr;
+  struct stat st;
+  int fd = open(fileName, O_RDONLY);
+  if (fd < 0)
+    {
+      fprintf(stderr, "Cannot open codeword file %s\n", fileName);
+      exit(1);
+    }
+  if ((fstat(fd, &st) != 0) || (read(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+      || (memcmp(hdr.magic, CODEWORD_MAGIC, sizeof(hdr.magic)) != 0))
+    {
+      close(fd);
+      return 0;
+    }
+  if ((hdr.N != N) || (hdr.rowBytes != S.rowBytes) || (hdr.frames <= 0)
+      || ((size_t)st.st_size != sizeof(hdr) + (size_t)hdr.frames*hdr.rowBytes))
+    {
+      fprintf(stderr, "%s holds %lld codewords of length %d, but the code has N=%d\n", fileName, hdr.frames, hdr.N, N);
+      exit(1);
+    }
+
+  void * base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    {
+      fprintf(stderr, "Cannot map %s\n", fileName);
+      exit(1);
+    }
+  madvise(base, st.st_size, MADV_WILLNEED);
+
+  S.map_base = base;
+  S.map_len = st.st_size;
+  S.frames = hdr.frames;
+  S.rows = (const uint8_t *) base + sizeof(hdr);
+  return 1;
+}
@@ -12,6 +12,7 @@
 #include <fstream>
 #include <cstdlib>
 #include <vector>
+#include <memory>
 #include <cmath>
 #include <sstream>
 #include <time.h>
@@ -19,25 +20,54 @@ using namespace std;
 
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
-#include "rand.h"
+#include "tanner.h"
+#include "rand_xoshiro.h"
+
+//--- Simulation support ---//
+#include "options.h"
+#include "montecarlo.h"
+#include "encoder.h"
+#include "codewords.h"
+#include "records.h"
+#include "instrument.h"
+#include "trace.h"
+#include "pipeline.h"
+#include "alloccount.h"
+#include "bp_kernels.h"
 
 
 //============ GLOBAL PARAMETERS ============//
 int    num_iterations; // Maximum number of iterations 
 double MAXLLR;         // Maximum magnitude of LLR messages
 
+//============ WORKSPACE ====================//
+// Frame buffers and message memories for one worker, allocated once
+// per run so that the frame loop does no heap allocation.
+typedef struct {
+  vector<int>    c;             // Bipolar codeword (all +1 in this simulation)
+  vector<double> x;             // Modulated codeword (all +1 in this simulation)
+  vector<double> y;             // Channel samples
+  vector<double> yq;            // Quantized channel samples
+  vector<int>    d;             // Decoder outputs (+1 or -1 after decoding)
+  vector<int>    r;             // Received hard decision
+  vector<double> check_to_sym;  // Edge-indexed message memories
+  vector<double> sym_to_check;
+  vector<int>    syndrome;      // Parity of the current decisions at each check
+  vector<double> suffix;        // Suffix products for bpCheckNodeUpdates
+  vector<uint64_t> acc;         // Encoder check-bit accumulator
+} bp_workspace;
+
+void allocWorkspace(tanner_struct &G, bp_workspace & W);
+
 //============ DECODING ALGORITHM PREDEFINES ===============//
-void checkNodeUpdates(alist_struct &H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym);
-void symNodeUpdates(alist_struct &H, vector<double> & y, vector<int> & d, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym);
+// The node updates are in bp_kernels.h.
 
 
 //============= SUPPORTING FUNCTION PREDEFINES =================//
-void setupSymMessages(alist_struct & H, vector<vector<double> > & sym_to_check);
-void setupCheckMessages(alist_struct & H, vector<vector<double> > & check_to_sym);
-void initializeSymMessages(alist_struct & H,  vector<vector<double> > & sym_to_check, vector<double> & y);
+void initializeSymMessages(tanner_struct & G,  vector<double> & sym_to_check, vector<double> & y);
 double sgn(double x);
 int find(int symNodes[], int len, int snode);
-int countDecisionErrors(vector<int> d, vector<int> c);
+int countDecisionErrors(const vector<int> & d, const vector<int> & c);
 
 //============= I/O PREDEFINES ============================//
 void printHistogram(vector<int> & h);
@@ -55,6 +85,16 @@ void sendMQTT(int bitErrors, int frameErrors, int totalBits, int totalWords);
 ///////////////////////////////////////////////////////////////////////////////
 int main(int argc, char * argv[])
 {
+  // Optional flags, removed from argv before the positional arguments are counted:
+  int  numThreads = resolveThreads(extractLongOption(argc, argv, "threads", 1));
+  long seed       = extractLongOption(argc, argv, "seed", time(0));
+  stop_policy stopping = extractStopPolicy(argc, argv);
+  string      resultsFile = extractStringOption(argc, argv, "results", "");
+  bool        profiling = extractLongOption(argc, argv, "profile", 0);
+  decode_trace trace = openTrace(argc, argv, numThreads);
+  int producers, ringDepth;
+  extractPipeline(argc, argv, numThreads, producers, ringDepth);
+
   MAXLLR = 20;
 
   vector<string> command_arguments(0);
@@ -64,12 +104,12 @@ int main(int argc, char * argv[])
   command_arguments.push_back("SNR");
   command_arguments.push_back("T");
   command_arguments.push_back("logfilename");
-  command_arguments.push_back("[codeword filename]");
+  command_arguments.push_back("[codeword filename|random|gen file]");
 
   // Check arguments and print usage statements:
   if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
     {
-      cout << "Usage: " << argv[0];
+      cout << "Usage: " << argv[0] << " [--threads N] [--seed S]" << MC_STOP_USAGE << MC_PIPE_USAGE << RESULTS_USAGE << PROFILE_USAGE << TRACE_USAGE;
       for (int i=0; i<command_arguments.size(); i++)
 	cout << " " << command_arguments[i];
       cout << "\n";
@@ -78,200 +118,255 @@ int main(int argc, char * argv[])
 
   // Parse command arguments:
   int idx=1;
-  alist_struct H = loadFile(argv[idx++]);
+  tanner_struct G = loadTanner(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
   double R = atof(argv[idx++]);
   cout << " R = \t" << R << endl;
   //double pchan = atof(argv[idx++]);
   //cout << " pchan = \t" << pchan << endl;
-  double SNR = atof(argv[idx++]);
-  cout << " SNR = \t" << SNR << endl;
+  sweep_struct sweep;
+  double SNR;
+  addSweep(sweep, "SNR", argv[idx], SNR);
+  cout << " SNR = \t" << argv[idx++] << endl;
   num_iterations = atoi(argv[idx++]);
   cout << " T = \t" << num_iterations << endl;
   string logfilename(argv[idx++]);
   cout << " log = \t" << logfilename << endl;
 
-  ifstream codewordFile;
-  if (argc == command_arguments.size()+1)
+  codeword_stream codewords;
+  encoder_struct encoder;
+  bool useEncoder = (argc == command_arguments.size()+1) && isEncoderSource(argv[idx]);
+  if (useEncoder)
+    {
+      cout << "\nUsing random codewords from " << argv[idx] << endl;
+      encoder = openEncoder(argv[idx], G);
+    }
+  else if (argc == command_arguments.size()+1)
     {
       cout << "\nUsing codewords from " << argv[idx] << endl;
-      codewordFile.open(argv[idx],ios::in);
+      openCodewords(codewords, argv[idx], G.N);
     }
   else
     cout << "\nUsing all-zero sequence.\n";
 
-  // Compute channel parameters:
-  double N0 = pow(10.0,-SNR/10.0)/R;  // power spectral density of noise
-  double sigma = sqrt(N0/2.0);  // Standard deviation of channel noise
-
-  // Get code parameters:
-  int dv = H.biggest_num_n;
-  int dc = H.biggest_num_m;
-
-  // Report initial status messages:
-  cout << "Simulating Min-Sum decoding on code with N=" << H.N << ", M=" << H.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
-  //cout << "\nParameters are:\n\tpchan\t" << pchan << endl; 
-  cout << "\nParameters are:\n\tSNR\t" << SNR << endl; 
-
-  // Declare top-level variables:
-  vector<int>    c(H.N,1);     // Bipolar codeword (all +1 in this simulation)
-  vector<double> x(H.N,1);     // Modulated codeword (all +1 in this simulation)
-  vector<double> y(x);          // Channel samples
-  vector<double> yq(H.N);       // Quantized channel samples
-  vector<int>    d(H.N,0);      // Decoder outputs (+1 or -1 after decoding)
-  vector<int>    r(H.N,0);      // Received hard decision
-
-  // Declare and initialize statistics variables:
-  long errors = 0;            // Total bit errors
-  long uncodedErrors = 0;     // Bit errors in r before decoding
-  long totalBits = 0;         // Total number of bits observed
-  long totalWords = 0;        // Total number of frames observed
-  long wordErrors = 0;        // Number of word errors observed
-  long totalIterations = 0;   // Total number of iterations accumulated over all frames.
-  vector<int> error_weight_hist(H.N,0);  // Vector to serve as histogram of error-pattern weights (1 up to H.N)
-
-  // Declare and initialize message memories:
-
-  vector<vector<double> > check_to_sym;
-  vector<vector<double> > sym_to_check;
-
-  // Allocate appropriate sizes for the message memories:                                                                                                                                                         
-  setupSymMessages(H,sym_to_check);
-  setupCheckMessages(H,check_to_sym);
-
-  /////////////////////////////////////////////////////////////////
-  // ------===== MAIN TEST LOOP =====-------
-  /////////////////////////////////////////////////////////////////
-  int minWordErrors = 20;
-  if (H.N > 10000) minWordErrors = 10;
-  if (H.N > 50000) minWordErrors = 5;
-  ran_seed(time(0)); //(134159);
-  int i,j;
-  while ((errors < 200) || (wordErrors < minWordErrors))
+  // Run every point of the parameter sweep in this process, keeping
+  // the graph and the workers' buffers:
+  vector<bp_workspace> workspaces(numThreads);
+  for (long point=0; point<sweepPoints(sweep); point++)
     {
-      string s;
-      // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
-	{
-	  getline(codewordFile, s);
-	  if (codewordFile.eof())
+      sweepSelect(sweep, point);
+      rewindCodewords(codewords);
+
+      // Compute channel parameters:
+      double N0 = pow(10.0,-SNR/10.0)/R;  // power spectral density of noise
+      double sigma = sqrt(N0/2.0);  // Standard deviation of channel noise
+
+      // Get code parameters:
+      int dv = G.biggest_dv;
+      int dc = G.biggest_dc;
+
+      // Report initial status messages:
+      cout << "Simulating Min-Sum decoding on code with N=" << G.N << ", M=" << G.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
+      //cout << "\nParameters are:\n\tpchan\t" << pchan << endl; 
+      cout << "\nParameters are:\n\tSNR\t" << SNR << endl; 
+
+      // Declare and initialize statistics variables:
+      int minWordErrors = 20;
+      if (G.N > 10000) minWordErrors = 10;
+      if (G.N > 50000) minWordErrors = 5;
+      mc_engine mc(numThreads, G.N, mcStopRule(stopping, 200, minWordErrors));
+      run_timer timer = startTimer();
+      profiler prof(profiling, numThreads);
+      bool useCodewordFile = (codewords.frames > 0);
+      cout << "Running " << numThreads << " worker thread(s) with seed " << seed << endl;
+
+      // With --producers, the channel runs on its own threads:
+      is_channel noBias = {0.0, 1.0};
+      channel_source source = {G.N, sigma, noBias, useEncoder ? &encoder : NULL, useCodewordFile ? &codewords : NULL};
+      unique_ptr<frame_pipeline> pipe;
+      if (producers > 0)
+	pipe.reset(new frame_pipeline(mc, source, producers, ringDepth, seed));
+
+      // Set up each point's workspaces. After the first point this
+      // reuses their storage and only resets the contents:
+      for (int t=0; t<numThreads; t++)
+	allocWorkspace(G, workspaces[t]);
+
+      /////////////////////////////////////////////////////////////////
+      // ------===== MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+      // Each worker owns a workspace and a random stream, and decodes
+      // frames until the engine's stopping rule holds.
+      auto decodeFrames = [&](int tid)
+      {
+	bp_workspace & W = workspaces[tid];
+	vector<int>    & c  = W.c;
+	vector<double> & x  = W.x;
+	vector<double> & y  = W.y;
+	vector<double> & yq = W.yq;
+	vector<int>    & d  = W.d;
+	vector<int>    & r  = W.r;
+	vector<double> & check_to_sym = W.check_to_sym;
+	vector<double> & sym_to_check = W.sym_to_check;
+	vector<int>    & syndrome = W.syndrome;
+
+	allocation_probe probe;
+	ran_stream(seed, tid);
+	stage_clock stages(prof, tid);
+	int i;
+	while (!mc.stop.load())
 	  {
-	    codewordFile.clear();
-	    codewordFile.seekg(0);
-	    getline(codewordFile, s);
-	  }
-	  for (i=0; i<H.N; i++)
-	  {	    
-	    if (s[i] == '1')	      
-	      c[i] = -1;
-	    else if (s[i] == '0')
-	      c[i] = +1;
+	    if (pipe)
+	      {
+		// Take the next frame from the producers, trading buffers:
+		channel_frame * F = pipelineAcquire(*pipe, tid);
+		if (F == NULL)
+		  break;
+		c.swap(F->c);
+		y.swap(F->y);
+		pipelineRelease(*pipe, tid);
+	      }
 	    else
-	      cout << "Got an invalid symbol at index " << i << endl;
-	    x[i] = c[i];
-	  }
-	}
-      // Emulate Additive White Gaussian Noise (AWGN) transmission      
-      for (i=0; i<H.N; i++)
-	{
-	  /* BSC:
-	  y[i] = x[i]; //*(1.0+sigma*rann());
-	  double rnum = ranu();
-	  if (rnum < pchan) {
-	    y[i] = 1.0 - y[i];
-	  }
-	  */
-	  y[i] = x[i]*(1.0+sigma*rann());
-	  
-	  //yq[i] = log(pchan)/log(1.0-pchan); // y[i]; //
-	  
-	  yq[i] = 4.0*y[i]/N0;
-	  
-	  if (abs(yq[i]) > MAXLLR) 
-	    yq[i] = sgn(yq[i])*MAXLLR;
-	  
-	  r[i] = sgn(yq[i]);
-	  d[i] = r[i];
-	  if (r[i]*c[i] < 0)
-	    uncodedErrors++;
-	}
+	      {
+	      // Draw a fresh codeword, or load one from the codeword file:
+	      if (useEncoder)
+		{
+		  randomCodeword(encoder, ran_state, &W.acc[0], c);
+		  for (i=0; i<G.N; i++)
+		    x[i] = c[i];
+		}
+	      else if (useCodewordFile)
+		{
+		  const uint8_t * row = nextCodeword(codewords);
+		  for (i=0; i<G.N; i++)
+		    {
+		      c[i] = codewordBit(row, i) ? -1 : +1;
+		      x[i] = c[i];
+		    }
+		}
+	      // Emulate Additive White Gaussian Noise (AWGN) transmission
+	      for (i=0; i<G.N; i++)
+		{
+		  /* BSC:
+		  y[i] = x[i]; //*(1.0+sigma*rann());
+		  double rnum = ranu();
+		  if (rnum < pchan) {
+		    y[i] = 1.0 - y[i];
+		  }
+		  */
+		  y[i] = x[i]*(1.0+sigma*rann());
+		}
+	      }
 
-      initializeSymMessages(H, sym_to_check, yq);
+	    int uncodedErrors = 0;
+	    for (i=0; i<G.N; i++)
+	      {
+		//yq[i] = log(pchan)/log(1.0-pchan); // y[i]; //
 
+		yq[i] = 4.0*y[i]/N0;
 
-      // Perform decoding iterations:      
-      int it;
+		if (abs(yq[i]) > MAXLLR)
+		  yq[i] = sgn(yq[i])*MAXLLR;
 
-      
-      for (it=0; it<num_iterations; it++)
-	{      
-	  // First update the check nodes:
-	  checkNodeUpdates(H,sym_to_check,check_to_sym);
-	  
-	  // Then perform Symbol node updates:
-	  symNodeUpdates(H, yq, d, sym_to_check, check_to_sym);	  
-	}
-      
-      // --- End of iteration --------------------------------------
-      // -------------------------------------------------------------
+		r[i] = sgn(yq[i]);
+		d[i] = r[i];
+		if (r[i]*c[i] < 0)
+		  uncodedErrors++;
+	      }
 
+	    initializeSymMessages(G, sym_to_check, yq);
+	    stages.lap(STAGE_CHANNEL);
 
-      // Count remaining errors after decoding:
-      int newErrors = countDecisionErrors(d,c);
 
-      if (newErrors > 0)
-	{
-	  // Report the frame error to the console:
-	  cout << "Ferr with " << newErrors << " errors.";
-	  cout << endl;
-
-	  // Update statistical information
-	  errors += newErrors;
-	  error_weight_hist[newErrors-1]++;
-	  wordErrors++;
-	  
-	  //	  sendMQTT(errors,wordErrors,totalBits+H.N,totalWords+1);
-	}
+	    // Perform decoding iterations:
+	    bool satisfied = false;
+	    int it;
+
+
+	    for (it=0; it<num_iterations; it++)
+	      {
+		// First update the check nodes:
+		bpCheckNodeUpdates(G,MAXLLR,sym_to_check,check_to_sym,W.suffix);
+		stages.lap(STAGE_CHECK);
+
+		// Then perform Symbol node updates:
+		bpSymNodeUpdates(G, MAXLLR, yq, d, sym_to_check, check_to_sym, syndrome, satisfied);
+		stages.lap(STAGE_SYMBOL);
+
+		traceIteration(trace, G, 0, it, bipolarBits(d));
+
+		// Stop once the decisions satisfy every check:
+		if (satisfied)
+		  {
+		    it++;
+		    break;
+		  }
+	      }
+
+	    // --- End of iteration --------------------------------------
+	    // -------------------------------------------------------------
+
+
+	    // Count remaining errors after decoding, and update the
+	    // statistics and error-weight histogram:
+	    traceFrame(trace, G, 0, it, bipolarBits(d));
+	    traceNext(trace, 1);
+	    int newErrors = countDecisionErrors(d,c);
+	    mcRecordFrame(mc, tid, newErrors, uncodedErrors, it, G.N, satisfied ? " All checks satisfied." : "");
+	    stages.lap(STAGE_IO);
+	    probe.endFrame();
+	  }
+      };
 
-      // Increment frame and bit counters:
-      totalWords++;
-      totalBits += H.N;
-      totalIterations += it;
-      
-      // ------------------------------------------------
       // Give a status message every 5 frames
-      if ((totalWords % 5) == 0)
+      mcRun(mc, decodeFrames, 5);
+      if (pipe)
+	pipelineStop(*pipe);
+      /////////////////////////////////////////////////////////////////
+      // ------===== END OF MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+
+      frame_totals totals = mcTotals(mc);
+      long errors          = totals.errors;
+      long uncodedErrors   = totals.uncodedErrors;
+      long totalBits       = totals.totalBits;
+      long totalWords      = totals.totalWords;
+      long wordErrors      = totals.wordErrors;
+      long totalIterations = totals.totalIterations;
+
+      // ------------------------------------------------
+      // REPORT FINAL RESULTS:
+      cout << "\nFinal result: " << errors << " bit errs in " 
+	   << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
+	   << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
+	   << (double)uncodedErrors/totalBits << endl;      
+      mcPrintInterval(stopping, totals);
+      profileReport(prof, totals, G.E);
+      reportAllocations();
+
+      if (!resultsFile.empty())
 	{
-	  cout << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
-	       << ". Average iterations = " << (double) totalIterations/totalWords << ". Word error=" << wordErrors << ". Uncoded errors = " << uncodedErrors << ", uncBER=" << (double)uncodedErrors/totalBits
-	       << "\nError weights:\n";
-	  printHistogram(error_weight_hist);
+	  result_record rec;
+	  recordRun(rec, argc, argv, command_arguments, sweep, seed, numThreads);
+	  recordTotals(rec, totals, timer);
+	  recordProfile(rec, prof, totals, G.E);
+	  writeResultRecord(resultsFile, rec);
 	}
-      // ------------------------------------------------
 
+      ofstream of(logfilename.c_str(),ios::app);
+      char tab = '\t';
+      of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
+	 << (double) wordErrors/totalWords << tab
+	 << num_iterations << tab;
+
+      of << argv[1]
+	 << endl;
+      of.close();
     }
-  /////////////////////////////////////////////////////////////////
-  // ------===== END OF MAIN TEST LOOP =====-------
-  /////////////////////////////////////////////////////////////////
-  
-  // ------------------------------------------------
-  // REPORT FINAL RESULTS:
-  cout << "\nFinal result: " << errors << " bit errs in " 
-       << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
-       << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
-       << (double)uncodedErrors/totalBits << endl;      
-
-  ofstream of(logfilename.c_str(),ios::app);
-  char tab = '\t';
-  of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
-     << (double) wordErrors/totalWords << tab
-     << num_iterations << tab;
-
-  of << argv[1]
-     << endl;
-  of.close();
-
-  freeAlist(H);
+
+  closeCodewords(codewords);
+  freeTanner(G);
+  closeTrace(trace);
 
   return 0;
 }
@@ -285,31 +380,27 @@ int main(int argc, char * argv[])
 // adequate comments...
 //============================================================//
 
-void  setupSymMessages(alist_struct & H, vector<vector<double> > & sym_to_check)
-{
-  for (int i=0; i<H.N; i++)
-    {
-      vector<double> initial_msgs(H.num_nlist[i],0.0);
-      sym_to_check.push_back(initial_msgs);
-    }
-}
-
-void setupCheckMessages(alist_struct & H,vector<vector<double> > & check_to_sym)
+void allocWorkspace(tanner_struct &G, bp_workspace & W)
 {
-  for (int i=0; i<H.M; i++)
-    {
-      vector<double> initial_msgs(H.num_mlist[i],0.0);
-      check_to_sym.push_back(initial_msgs);
-    }
+  W.c.assign(G.N,1);
+  W.x.assign(G.N,1);
+  W.y.assign(G.N,1);
+  W.yq.assign(G.N,0.0);
+  W.d.assign(G.N,0);
+  W.r.assign(G.N,0);
+  W.check_to_sym.assign(G.E,0.0);
+  W.sym_to_check.assign(G.E,0.0);
+  W.syndrome.assign(G.M,0);
+  W.suffix.assign(G.biggest_dc+1,0.0);
+  W.acc.assign((G.M+63)/64,0);
 }
 
-
-void initializeSymMessages(alist_struct & H,  vector<vector<double> > & sym_to_check, vector<double> & y)
+void initializeSymMessages(tanner_struct & G,  vector<double> & sym_to_check, vector<double> & y)
 {
-  int i,j;
-  for (i=0; i<H.N; i++)
-    for (j=0; j<H.num_nlist[i]; j++)
-      sym_to_check[i][j] = y[i];
+  int i,k;
+  for (i=0; i<G.N; i++)
+    for (k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+      sym_to_check[k] = y[i];
 }
 
 
@@ -322,7 +413,7 @@ void printHistogram(vector<int> & h)
     }
 }
 
-int countDecisionErrors(vector<int> d, vector<int> c)
+int countDecisionErrors(const vector<int> & d, const vector<int> & c)
 {
   int errs =0 ;
   for (int i=0; i<d.size(); i++)
@@ -350,65 +441,6 @@ void printErroneousMessages(vector<vector<int> > v)
     }
 }
 
-void checkNodeUpdates(alist_struct &H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym)
-{
-  double msg;
-  double prod;
-  double outmsg;
-  for (int i=0; i<H.M; i++)
-    {
-      for (int j=0; j<H.num_mlist[i]; j++)
-	{
-	  prod=1.0;
-	  for (int k=0; k<H.num_mlist[i]; k++)
-	    {
-	      if (j != k)
-		{
-		  int snode = H.mlist[i][k]-1;
-		  int midx = find(H.nlist[snode], H.num_nlist[snode], i);
-		  msg = sym_to_check[snode][midx];
-		  prod *= tanh(msg/2.0);
-		}
-	    }
-	  outmsg = log((1.0+prod)/(1.0-prod));	      
-	  check_to_sym[i][j] = outmsg;	  
-	}
-    }
-}
-
-void symNodeUpdates(alist_struct &H, vector<double> & y, vector<int> & d, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym)
-{ 
-  int cnode, midx;
-  double msg, outmsg, sum;
-
-  for (int i=0; i<H.N; i++)
-    {
-      sum = y[i];
-      for (int j=0; j<H.num_nlist[i]; j++)
-	{
-	  cnode = H.nlist[i][j]-1;
-	  midx = find(H.mlist[cnode],H.num_mlist[cnode],i);
-	  msg = check_to_sym[cnode][midx];
-	  sum += msg;
-	}      
-      for (int j=0; j<H.num_nlist[i]; j++) 
-	{
-	  cnode = H.nlist[i][j]-1;  
-	  midx = find(H.mlist[cnode],H.num_mlist[cnode],i); 
-	  msg = check_to_sym[cnode][midx]; 
-	  outmsg = sum - msg;
-	  if (abs(outmsg) > MAXLLR)
-	    outmsg = MAXLLR*sgn(outmsg);
-	  sym_to_check[i][j] = outmsg;
-	}
-      if (sum > 0)
-	d[i] = 1;
-      else
-	d[i] = -1;	
-    }
-}
-
-
 double sgn(double x)
 {
   if (x >= 0.0)
@@ -0,0 +1,639 @@
+//==============================================================
+// decodeBitslicedGDBF.cpp
+//
+// Bit-sliced GDBF decoder for long error-floor runs. Each
+// worker decodes 64 independent frames at once: bit l of a
+// 64-bit word belongs to frame (lane) l, so one word per
+// symbol holds 64 hard decisions, the syndromes are XOR
+// reductions over the CSR neighbours, and the number of
+// unsatisfied checks at each symbol is kept as a bit-parallel
+// counter (one word per counter bit).
+//
+// The flip rules follow decodeGDBF.cpp. In parallel mode the
+// flip condition E < theta is turned into a per-lane integer
+// threshold on the unsatisfied-check count when the frames are
+// loaded, so the whole iteration is bitwise. Sequential flipping
+// and Wadayama's mode-switching need a per-lane search for the
+// minimum energy, which is done lane by lane from the counters.
+// A lane stops as soon as all of its checks are satisfied.
+//
+// The noisy and adaptive variants (addNoise, thresholdAdaptation,
+// outputSmoothing, quantizeProbabilities) draw or update real
+// values per symbol and frame; use decodeGDBF.cpp for those.
+//==============================================================
+
+//--- COMPILE OPTIONS ---//
+/*
+//#define sequentialmode  // Use sequential flipping only
+//#define modeswitching   // Use Wadayama's parallel-serial mode-switching technique
+//#define weightSyndromes // Apply scale factor alpha to the syndrome sums
+//#define saturateSamples // Clip channel samples at +-Ymax
+//#define quantizeSamples // Quantize channel samples on NQ bits
+*/
+
+//--- Standard C++ headers ---//
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <vector>
+#include <cmath>
+#include <sstream>
+#include <time.h>
+#include <stdint.h>
+using namespace std;
+
+//--- Borrowed from Radford Neal's source code ---//
+#include "alist.h"
+#include "tanner.h"
+#include "rand_xoshiro.h"
+
+//--- Simulation support ---//
+#include "options.h"
+#include "montecarlo.h"
+#include "encoder.h"
+#include "codewords.h"
+#include "records.h"
+#include "trace.h"
+#include "alloccount.h"
+
+
+//============ GLOBAL PARAMETERS ============//
+
+const int LANES = 64;       // Frames decoded together, one per bit of a uint64_t
+
+int    num_iterations;      // Maximum number of iterations
+double theta;               // Threshold
+int    Tswitch    = 0;
+double alpha      = 2.25;
+double Ymax       = 2.25;
+int    NQ         = 16;
+
+// Working memory for one batch of 64 frames, allocated once per
+// worker and run. Bit l of every word belongs to lane l; a set
+// bit stands for the bipolar value -1 (binary 1).
+typedef struct {
+  int              B;       // Bits in the unsatisfied-check counters and thresholds
+  vector<uint64_t> c;       // Codeword bits, per symbol
+  vector<uint64_t> r;       // Received hard decisions, per symbol
+  vector<uint64_t> d;       // Decoder decisions, per symbol
+  vector<uint64_t> s;       // Syndromes (1 = unsatisfied), per check
+  vector<uint64_t> Tagree;  // Flip thresholds when d agrees with r, B words per symbol
+  vector<uint64_t> Tflip;   // Flip thresholds when d disagrees with r, B words per symbol
+  vector<double>   ymag;    // |yq|, LANES values per symbol
+  vector<int>      iterations;  // Iterations used by each lane
+  vector<bool>     satisfied;   // Lane stopped on a valid codeword
+  vector<int>      uncodedErrors;  // Channel errors in each lane
+  vector<int>      newErrors;      // Decoding errors in each lane
+  vector<uint64_t> acc;         // Encoder check-bit accumulator
+  vector<int>      cw;          // One encoded codeword, bipolar
+} bitslice_struct;
+
+//============ DECODING ALGORITHM PREDEFINES ===============//
+void setupBitslice(tanner_struct &G, bitslice_struct &W);
+void computeThresholds(tanner_struct &G, bitslice_struct &W);
+uint64_t checkNodeUpdates(tanner_struct &G, bitslice_struct &W);
+void symNodeUpdates(tanner_struct &G, bitslice_struct &W, uint64_t active, uint64_t & parallel, int it);
+void decodeBatch(tanner_struct &G, bitslice_struct &W, decode_trace &trace);
+
+//============= SUPPORTING FUNCTION PREDEFINES =================//
+double quantize(double x);
+double sgn(double y);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// -----===== MAIN BODY ======------
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char * argv[])
+{
+  // Optional flags, removed from argv before the positional arguments are counted:
+  int  numThreads = resolveThreads(extractLongOption(argc, argv, "threads", 1));
+  long seed       = extractLongOption(argc, argv, "seed", time(0));
+  stop_policy stopping = extractStopPolicy(argc, argv);
+  string      resultsFile = extractStringOption(argc, argv, "results", "");
+  decode_trace trace = openTrace(argc, argv, numThreads);
+
+  vector<string> command_arguments(0);
+  command_arguments.push_back("alist");
+  command_arguments.push_back("R");
+  command_arguments.push_back("SNR");
+  command_arguments.push_back("T");
+  command_arguments.push_back("theta");
+  command_arguments.push_back("logfilename");
+#ifdef quantizeSamples
+  command_arguments.push_back("NQ");
+#endif
+  #ifdef weightSyndromes
+  command_arguments.push_back("alpha");
+  #endif
+  #ifdef saturateSamples
+  command_arguments.push_back("Ymax");
+  #endif
+  command_arguments.push_back("[codeword filename|random|gen file]");
+
+  // Check arguments and print usage statements:
+  if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
+    {
+      cout << "Usage: " << argv[0] << " [--threads N] [--seed S]" << MC_STOP_USAGE << RESULTS_USAGE << TRACE_USAGE;
+      for (int i=0; i<command_arguments.size(); i++)
+	cout << " " << command_arguments[i];
+      cout << "\n";
+      return 0;
+    }
+
+  // Parse command arguments:
+  int idx=1;
+  tanner_struct G = loadTanner(argv[idx++]);
+  cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
+  double R = atof(argv[idx++]);
+  cout << " R = \t" << R << endl;
+  sweep_struct sweep;
+  double SNR;
+  addSweep(sweep, "SNR", argv[idx], SNR);
+  cout << " SNR = \t" << argv[idx++] << endl;
+  num_iterations = atoi(argv[idx++]);
+  cout << " T = \t" << num_iterations << endl;
+  addSweep(sweep, "theta", argv[idx], theta);
+  cout << " theta = \t" << argv[idx++] << endl;
+  string logfilename(argv[idx++]);
+  cout << " log = \t" << logfilename << endl;
+
+#ifdef quantizeSamples
+  NQ = atoi(argv[idx++]);
+  cout << " NQ = \t" << NQ << endl;
+#endif
+  #ifdef weightSyndromes
+  addSweep(sweep, "alpha", argv[idx], alpha);
+  cout << " alpha = \t" << argv[idx++] << endl;
+  #endif
+  #ifdef saturateSamples
+  addSweep(sweep, "Ymax", argv[idx], Ymax);
+  cout << " Ymax = \t" << argv[idx++] << endl;
+  #endif
+
+  codeword_stream codewords;
+  encoder_struct encoder;
+  bool useEncoder = (argc == command_arguments.size()+1) && isEncoderSource(argv[idx]);
+  if (useEncoder)
+    {
+      cout << "\nUsing random codewords from " << argv[idx] << endl;
+      encoder = openEncoder(argv[idx], G);
+    }
+  else if (argc == command_arguments.size()+1)
+    {
+      cout << "\nUsing codewords from " << argv[idx] << endl;
+      openCodewords(codewords, argv[idx], G.N);
+    }
+  else
+    cout << "\nUsing all-zero sequence.\n";
+
+  // Run every point of the parameter sweep in this process, keeping
+  // the graph and the workers' buffers:
+  vector<bitslice_struct> workspaces(numThreads);
+  for (long point=0; point<sweepPoints(sweep); point++)
+    {
+      sweepSelect(sweep, point);
+      rewindCodewords(codewords);
+
+      // Compute channel parameters:
+      double N0 = pow(10.0,-SNR/10.0)/R;
+      double sigma = sqrt(N0/2.0);
+
+      // Get code parameters:
+      int dv = G.biggest_dv;
+      int dc = G.biggest_dc;
+
+      // Report initial status messages:
+      cout << "Simulating bit-sliced GDBF decoding on code with N=" << G.N << ", M=" << G.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
+      cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
+
+      // Declare and initialize statistics variables:
+      int minWordErrors = 20;
+      if (G.N > 10000) minWordErrors = 10;
+      if (G.N > 50000) minWordErrors = 5;
+      mc_engine mc(numThreads, G.N, mcStopRule(stopping, 200, minWordErrors));
+      run_timer timer = startTimer();
+      bool useCodewordFile = (codewords.frames > 0);
+      cout << "Running " << numThreads << " worker thread(s) with seed " << seed << endl;
+
+      // Set up each point's workspaces. After the first point this
+      // reuses their storage and only resets the contents:
+      for (int t=0; t<numThreads; t++)
+	setupBitslice(G, workspaces[t]);
+
+      /////////////////////////////////////////////////////////////////
+      // ------===== MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+      // Each worker decodes batches of 64 frames with its own
+      // working memory and random stream until the stopping rule holds.
+      auto decodeFrames = [&](int tid)
+      {
+	bitslice_struct & W = workspaces[tid];
+	vector<int> & uncodedErrors = W.uncodedErrors;
+	vector<int> & newErrors = W.newErrors;
+
+	allocation_probe probe;
+	ran_stream(seed, tid);
+	int i, l;
+	while (!mc.stop.load())
+	  {
+	    // Load the codewords and emulate AWGN transmission, one lane at a time:
+	    for (l=0; l<LANES; l++)
+	      uncodedErrors[l] = 0;
+	    for (i=0; i<G.N; i++)
+	      W.c[i] = 0;
+	    for (l=0; l<LANES; l++)
+	      {
+		uint64_t bit = (uint64_t)1 << l;
+		if (useEncoder)
+		  {
+		    randomCodeword(encoder, ran_state, &W.acc[0], W.cw);
+		    for (i=0; i<G.N; i++)
+		      if (W.cw[i] < 0)
+			W.c[i] |= bit;
+		  }
+		else if (useCodewordFile)
+		  {
+		    const uint8_t * row = nextCodeword(codewords);
+		    for (i=0; i<G.N; i++)
+		      if (codewordBit(row, i))
+			W.c[i] |= bit;
+		  }
+		for (i=0; i<G.N; i++)
+		  {
+		    double x = (W.c[i] & bit) ? -1.0 : 1.0;
+		    double yq = x*(1.0+sigma*rann());
+		    #ifdef saturateSamples
+		    if (abs(yq)>Ymax)
+		      yq *= Ymax/abs(yq);
+		    #endif
+		    if (yq > 0)
+		      W.r[i] &= ~bit;
+		    else
+		      W.r[i] |= bit;
+		    #ifdef quantizeSamples
+		    yq = quantize(yq);
+		    #endif
+		    W.ymag[i*LANES+l] = abs(yq);
+		    if ((W.r[i] ^ W.c[i]) & bit)
+		      uncodedErrors[l]++;
+		  }
+	      }
+
+	    decodeBatch(G, W, trace);
+	    if (trace.file != NULL)
+	      {
+		for (l=0; l<LANES; l++)
+		  traceFrame(trace, G, l, W.iterations[l], [&W, l](int i) { return (W.d[i] >> l) & 1; });
+		traceNext(trace, LANES);
+	      }
+
+	    // Count remaining errors in each lane, and update the
+	    // statistics and error-weight histogram:
+	    for (l=0; l<LANES; l++)
+	      newErrors[l] = 0;
+	    for (i=0; i<G.N; i++)
+	      {
+		uint64_t e = W.d[i] ^ W.c[i];
+		while (e)
+		  {
+		    newErrors[__builtin_ctzll(e)]++;
+		    e &= e-1;
+		  }
+	      }
+	    for (l=0; l<LANES; l++)
+	      mcRecordFrame(mc, tid, newErrors[l], uncodedErrors[l], W.iterations[l], G.N, W.satisfied[l] ? " All checks satisfied." : "");
+	    probe.endFrame();
+	  }
+      };
+
+      // Give a status message every 100k bits
+      mcRun(mc, decodeFrames, round(100e3/G.N));
+      /////////////////////////////////////////////////////////////////
+      // ------===== END OF MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+
+      frame_totals totals = mcTotals(mc);
+      long errors          = totals.errors;
+      long uncodedErrors   = totals.uncodedErrors;
+      long totalBits       = totals.totalBits;
+      long totalWords      = totals.totalWords;
+      long wordErrors      = totals.wordErrors;
+      long totalIterations = totals.totalIterations;
+
+      // ------------------------------------------------
+      // REPORT FINAL RESULTS:
+      cout << "\nFinal result: " << errors << " bit errs in "
+	   << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords
+	   << ". Uncoded errors = " << uncodedErrors << ", uncBER="
+	   << (double)uncodedErrors/totalBits << endl;
+      mcPrintInterval(stopping, totals);
+      reportAllocations();
+
+      if (!resultsFile.empty())
+	{
+	  result_record rec;
+	  recordRun(rec, argc, argv, command_arguments, sweep, seed, numThreads);
+	  recordTotals(rec, totals, timer);
+	  writeResultRecord(resultsFile, rec);
+	}
+
+      ofstream of(logfilename.c_str(),ios::app);
+      char tab = '\t';
+      of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
+	 << (double) wordErrors/totalWords << tab
+	 << totalBits << tab << totalWords << tab
+	 << num_iterations << tab << theta << tab;
+#ifdef quantizeSamples
+      of << NQ << tab;
+#endif
+      #ifdef weightSyndromes
+      of << alpha << tab;
+      #endif
+      #ifdef saturateSamples
+      of << Ymax << tab;
+      #endif
+
+      of << argv[1]
+	 << endl;
+      of.close();
+    }
+
+  closeCodewords(codewords);
+  freeTanner(G);
+  closeTrace(trace);
+
+  return 0;
+}
+/////////////////////////////////////////////////////////////////
+// ------===== END OF MAIN BODY =====-------
+/////////////////////////////////////////////////////////////////
+
+
+//============================================================//
+// Functions follow in no particular order.
+//============================================================//
+
+void setupBitslice(tanner_struct &G, bitslice_struct &W)
+{
+  // The counters must hold every count 0..dv, and the thresholds
+  // must also hold dv+1, which stands for "never flip":
+  W.B = 1;
+  while ((1 << W.B) - 1 < G.biggest_dv + 1)
+    W.B++;
+
+  W.c.assign(G.N,0);
+  W.acc.assign((G.M+63)/64,0);
+  W.cw.assign(G.N,1);
+  W.r.assign(G.N,0);
+  W.d.assign(G.N,0);
+  W.s.assign(G.M,0);
+  W.Tagree.assign(G.N*W.B,0);
+  W.Tflip.assign(G.N*W.B,0);
+  W.ymag.assign(G.N*LANES,0.0);
+  W.iterations.assign(LANES,0);
+  W.satisfied.assign(LANES,false);
+  W.uncodedErrors.assign(LANES,0);
+  W.newErrors.assign(LANES,0);
+}
+
+
+// For parallel flipping, symbol i flips when
+//    E = d*y + w*(dv - 2u) < theta,
+// where u is its number of unsatisfied checks and d*y is +|y| if
+// d agrees with the received decision r, -|y| otherwise. So i
+// flips exactly when u >= T, with one integer T for each of the
+// two cases. The thresholds are stored as bit planes so that the
+// comparison against the counters is bitwise as well.
+void computeThresholds(tanner_struct &G, bitslice_struct &W)
+{
+  double w = 1;
+  #ifdef weightSyndromes
+  w = alpha;
+  #endif
+  int Tnever = (1 << W.B) - 1;
+
+  for (int i=0; i<G.N; i++)
+    {
+      int dv = G.sym_start[i+1]-G.sym_start[i];
+      uint64_t * Ta = &W.Tagree[i*W.B];
+      uint64_t * Tf = &W.Tflip[i*W.B];
+      for (int b=0; b<W.B; b++)
+	{
+	  Ta[b] = 0;
+	  Tf[b] = 0;
+	}
+      for (int l=0; l<LANES; l++)
+	{
+	  double yabs = W.ymag[i*LANES+l];
+	  for (int agree=0; agree<2; agree++)
+	    {
+	      double q = ((agree ? yabs : -yabs) + w*dv - theta)/(2*w);
+	      double Tq = floor(q) + 1;
+	      int T;
+	      if (Tq < 0)
+		T = 0;
+	      else if (Tq > dv)
+		T = Tnever;
+	      else
+		T = (int) Tq;
+	      uint64_t * planes = agree ? Ta : Tf;
+	      for (int b=0; b<W.B; b++)
+		if (T & (1 << b))
+		  planes[b] |= (uint64_t)1 << l;
+	    }
+	}
+    }
+}
+
+
+// Computes the syndrome of every check for all lanes and returns
+// the lanes with at least one unsatisfied check.
+uint64_t checkNodeUpdates(tanner_struct &G, bitslice_struct &W)
+{
+  uint64_t unsatisfied = 0;
+  for (int j=0; j<G.M; j++)
+    {
+      uint64_t s = 0;
+      for (int e=G.check_start[j]; e<G.check_start[j+1]; e++)
+	s ^= W.d[G.check_sym[e]];
+      W.s[j] = s;
+      unsatisfied |= s;
+    }
+  return unsatisfied;
+}
+
+
+// Flips symbols in the active lanes. Lanes set in `parallel`
+// use the threshold rule, the others flip the single symbol of
+// minimum energy. With modeswitching, a parallel lane whose
+// flips did not decrease the objective function switches to
+// sequential flipping.
+void symNodeUpdates(tanner_struct &G, bitslice_struct &W, uint64_t active, uint64_t & parallel, int it)
+{
+  double w = 1;
+  #ifdef weightSyndromes
+  w = alpha;
+  #endif
+  uint64_t par = active & parallel;
+  uint64_t seq = active & ~parallel;
+  double Emin[LANES];
+  int    mindx[LANES];
+  #ifdef modeswitching
+  double gain[LANES];  // sum of d*y over the flipped symbols
+  #endif
+  for (int l=0; l<LANES; l++)
+    {
+      Emin[l] = INFINITY;
+      mindx[l] = -1;
+      #ifdef modeswitching
+      gain[l] = 0;
+      #endif
+    }
+
+  uint64_t u[32];
+  for (int i=0; i<G.N; i++)
+    {
+      // Bit-parallel count of unsatisfied neighbouring checks:
+      for (int b=0; b<W.B; b++)
+	u[b] = 0;
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	{
+	  uint64_t carry = W.s[G.sym_check[k]];
+	  for (int b=0; carry && (b<W.B); b++)
+	    {
+	      uint64_t t = u[b] & carry;
+	      u[b] ^= carry;
+	      carry = t;
+	    }
+	}
+
+      uint64_t disagree = W.d[i] ^ W.r[i];
+
+      if (par)
+	{
+	  // Bitwise u >= T, from the least significant bit up:
+	  const uint64_t * Ta = &W.Tagree[i*W.B];
+	  const uint64_t * Tf = &W.Tflip[i*W.B];
+	  uint64_t ge = ~(uint64_t)0;
+	  for (int b=0; b<W.B; b++)
+	    {
+	      uint64_t T = (Ta[b] & ~disagree) | (Tf[b] & disagree);
+	      ge = (u[b] & ~T) | (~(u[b] ^ T) & ge);
+	    }
+	  uint64_t flip = par & ge;
+	  W.d[i] ^= flip;
+
+	  #ifdef modeswitching
+	  if (it > Tswitch)
+	    for (uint64_t f=flip; f; f &= f-1)
+	      {
+		int l = __builtin_ctzll(f);
+		double yabs = W.ymag[i*LANES+l];
+		gain[l] += ((disagree >> l) & 1) ? -yabs : yabs;
+	      }
+	  #endif
+	}
+
+      if (seq)
+	{
+	  int dv = G.sym_start[i+1]-G.sym_start[i];
+	  for (uint64_t m=seq; m; m &= m-1)
+	    {
+	      int l = __builtin_ctzll(m);
+	      int count = 0;
+	      for (int b=0; b<W.B; b++)
+		count |= ((u[b] >> l) & 1) << b;
+	      double yabs = W.ymag[i*LANES+l];
+	      double E = (((disagree >> l) & 1) ? -yabs : yabs) + w*(dv - 2*count);
+	      if (E < Emin[l])
+		{
+		  Emin[l] = E;
+		  mindx[l] = i;
+		}
+	    }
+	}
+    }
+
+  for (uint64_t m=seq; m; m &= m-1)
+    {
+      int l = __builtin_ctzll(m);
+      if (mindx[l] >= 0)
+	W.d[mindx[l]] ^= (uint64_t)1 << l;
+    }
+
+  // The objective function changes by -2*gain, so it did not
+  // decrease when gain >= 0:
+  #ifdef modeswitching
+  if (it > Tswitch)
+    for (uint64_t m=par; m; m &= m-1)
+      {
+	int l = __builtin_ctzll(m);
+	if (gain[l] >= 0)
+	  parallel &= ~((uint64_t)1 << l);
+      }
+  #endif
+}
+
+
+// Decodes the 64 frames held in W, starting from the received
+// decisions, and records each lane's iteration count.
+void decodeBatch(tanner_struct &G, bitslice_struct &W, decode_trace &trace)
+{
+  uint64_t parallel;
+  #ifdef sequentialmode
+  parallel = 0;
+  #else
+  parallel = ~(uint64_t)0;
+  computeThresholds(G, W);
+  #endif
+
+  for (int i=0; i<G.N; i++)
+    W.d[i] = W.r[i];
+  for (int l=0; l<LANES; l++)
+    {
+      W.iterations[l] = num_iterations;
+      W.satisfied[l] = false;
+    }
+
+  uint64_t active = ~(uint64_t)0;
+  for (int it=0; it<num_iterations; it++)
+    {
+      // First update the check nodes, and retire the lanes
+      // whose checks are all satisfied:
+      uint64_t unsatisfied = checkNodeUpdates(G, W);
+      for (uint64_t m=active & ~unsatisfied; m; m &= m-1)
+	{
+	  int l = __builtin_ctzll(m);
+	  W.iterations[l] = it;
+	  W.satisfied[l] = true;
+	}
+      active &= unsatisfied;
+      if (!active)
+	break;
+
+      // Then perform Symbol node updates:
+      symNodeUpdates(G, W, active, parallel, it);
+      if (trace.file != NULL)
+	for (uint64_t m=active; m; m &= m-1)
+	  {
+	    int l = __builtin_ctzll(m);
+	    traceIteration(trace, G, l, it, [&W, l](int i) { return (W.d[i] >> l) & 1; });
+	  }
+    }
+}
+
+
+double quantize(double x)
+{
+  double qmax=pow(2,(NQ-1));
+  double lmax = Ymax/2.0;
+  return sgn(x)*floor((abs(x)*qmax)/(2*lmax)+0.5)*(2.0*lmax/qmax);
+}
+
+double sgn(double y)
+{
+  if (y>0)
+    return 1.0;
+  else
+    return -1.0;
+}
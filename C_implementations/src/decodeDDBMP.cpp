@@ -11,6 +11,7 @@
 #include <fstream>
 #include <cstdlib>
 #include <vector>
+#include <memory>
 #include <cmath>
 #include <sstream>
 #include <time.h>
@@ -18,25 +19,53 @@ using namespace std;
 
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
-#include "rand.h"
+#include "tanner.h"
+#include "rand_xoshiro.h"
+
+//--- Simulation support ---//
+#include "options.h"
+#include "montecarlo.h"
+#include "encoder.h"
+#include "codewords.h"
+#include "records.h"
+#include "instrument.h"
+#include "trace.h"
+#include "pipeline.h"
+#include "alloccount.h"
+#include "ddbmp_kernels.h"
 
 
 //============ GLOBAL PARAMETERS ============//
 int    num_iterations; // Maximum number of iterations for MLSBM (an additional phase of Gallager-A follows after this)
 
+//============ WORKSPACE ====================//
+// Frame buffers and message memories for one worker, allocated once
+// per run so that the frame loop does no heap allocation.
+typedef struct {
+  vector<int>    c;             // Bipolar codeword (all +1 in this simulation)
+  vector<double> x;             // Modulated codeword (all +1 in this simulation)
+  vector<double> y;             // Channel samples
+  vector<double> yq;            // Quantized channel samples
+  vector<int>    d;             // Decoder outputs (+1 or -1 after decoding)
+  vector<int>    r;             // Received hard decision
+  vector<double> check_to_sym;  // Edge-indexed message memories
+  vector<double> sym_to_check;
+  vector<double> sym_memories;
+  vector<uint64_t> acc;         // Encoder check-bit accumulator
+} ddbmp_workspace;
+
+void allocWorkspace(tanner_struct &G, ddbmp_workspace & W);
+
 //============ DECODING ALGORITHM PREDEFINES ===============//
-void checkNodeUpdates(alist_struct &H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym);
-void symNodeUpdates(alist_struct &H, vector<double> & y, vector<int> & d, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym, vector<vector<double> > & sym_memories);
-bool checkStoppingCondition(alist_struct &H, vector<int>  & d);
+// The node updates are in ddbmp_kernels.h.
+bool checkStoppingCondition(tanner_struct &G, vector<int>  & d);
 
 
 //============= SUPPORTING FUNCTION PREDEFINES =================//
-void setupSymMessages(alist_struct & H, vector<vector<double> > & sym_to_check, vector<vector<double> > & sym_memories);
-void setupCheckMessages(alist_struct & H, vector<vector<double> > & check_to_sym);
-void initializeSymMessages(alist_struct & H,  vector<vector<double> > & sym_to_check, vector<vector<double> > & sym_memories, vector<double> & y);
+void initializeSymMessages(tanner_struct & G,  vector<double> & sym_to_check, vector<double> & sym_memories, vector<double> & y);
 double sgn(double x);
 int find(int symNodes[], int len, int snode);
-int countDecisionErrors(vector<int> d, vector<int> c);
+int countDecisionErrors(const vector<int> & d, const vector<int> & c);
 double quantize(double x, double Ymax, double Nq);
 
 //============= I/O PREDEFINES ============================//
@@ -54,6 +83,16 @@ void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check
 ///////////////////////////////////////////////////////////////////////////////
 int main(int argc, char * argv[])
 {
+  // Optional flags, removed from argv before the positional arguments are counted:
+  int  numThreads = resolveThreads(extractLongOption(argc, argv, "threads", 1));
+  long seed       = extractLongOption(argc, argv, "seed", time(0));
+  stop_policy stopping = extractStopPolicy(argc, argv);
+  string      resultsFile = extractStringOption(argc, argv, "results", "");
+  bool        profiling = extractLongOption(argc, argv, "profile", 0);
+  decode_trace trace = openTrace(argc, argv, numThreads);
+  int producers, ringDepth;
+  extractPipeline(argc, argv, numThreads, producers, ringDepth);
+
   vector<string> command_arguments(0);
   command_arguments.push_back("alist");
   command_arguments.push_back("R");
@@ -62,12 +101,12 @@ int main(int argc, char * argv[])
   command_arguments.push_back("Ymax");
   command_arguments.push_back("Q");
   command_arguments.push_back("logfilename");
-  command_arguments.push_back("[codeword filename]");
+  command_arguments.push_back("[codeword filename|random|gen file]");
 
   // Check arguments and print usage statements:
   if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
     {
-      cout << "Usage: " << argv[0];
+      cout << "Usage: " << argv[0] << " [--threads N] [--seed S]" << MC_STOP_USAGE << MC_PIPE_USAGE << RESULTS_USAGE << PROFILE_USAGE << TRACE_USAGE;
       for (int i=0; i<command_arguments.size(); i++)
 	cout << " " << command_arguments[i];
       cout << "\n";
@@ -76,195 +115,243 @@ int main(int argc, char * argv[])
 
   // Parse command arguments:
   int idx=1;
-  alist_struct H = loadFile(argv[idx++]);
+  tanner_struct G = loadTanner(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
   double R = atof(argv[idx++]);
   cout << " R = \t" << R << endl;
-  double SNR = atof(argv[idx++]);
-  cout << " SNR = \t" << SNR << endl;
+  sweep_struct sweep;
+  double SNR;
+  addSweep(sweep, "SNR", argv[idx], SNR);
+  cout << " SNR = \t" << argv[idx++] << endl;
   num_iterations = atoi(argv[idx++]);
   cout << " T = \t" << num_iterations << endl;
-  double Ymax = atof(argv[idx++]);
-  cout << " Ymax = \t" << Ymax << endl;
+  double Ymax;
+  addSweep(sweep, "Ymax", argv[idx], Ymax);
+  cout << " Ymax = \t" << argv[idx++] << endl;
   int Q = atoi(argv[idx++]);
   cout << "Q = \t" << Q << endl;
   string logfilename(argv[idx++]);
   cout << " log = \t" << logfilename << endl;
 
-  ifstream codewordFile;
-  if (argc == command_arguments.size()+1)
+  codeword_stream codewords;
+  encoder_struct encoder;
+  bool useEncoder = (argc == command_arguments.size()+1) && isEncoderSource(argv[idx]);
+  if (useEncoder)
+    {
+      cout << "\nUsing random codewords from " << argv[idx] << endl;
+      encoder = openEncoder(argv[idx], G);
+    }
+  else if (argc == command_arguments.size()+1)
     {
       cout << "\nUsing codewords from " << argv[idx] << endl;
-      codewordFile.open(argv[idx],ios::in);
+      openCodewords(codewords, argv[idx], G.N);
     }
   else
     cout << "\nUsing all-zero sequence.\n";
 
-  // Compute channel parameters:
-  double N0 = pow(10.0,-SNR/10.0)/R;
-  double sigma = sqrt(N0/2.0);
-  double Nq = pow(2.0,Q);
-
-  // Get code parameters:
-  int dv = H.biggest_num_n;
-  int dc = H.biggest_num_m;
-
-  // Report initial status messages:
-  cout << "Simulating DD-BMP decoding on code with N=" << H.N << ", M=" << H.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
-  cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
-
-
-  // Declare top-level variables:
-  vector<int>    c(H.N,1);     // Bipolar codeword (all +1 in this simulation)
-  vector<double> x(H.N,1);     // Modulated codeword (all +1 in this simulation)
-  vector<double> y(x);          // Channel samples
-  vector<double> yq(H.N);       // Quantized channel samples
-  vector<int>    d(H.N,0);      // Decoder outputs (+1 or -1 after decoding)
-  vector<int>    r(H.N,0);      // Received hard decision
-
-  // Declare and initialize statistics variables:
-  long errors = 0;            // Total bit errors
-  long uncodedErrors = 0;     // Bit errors in r before decoding
-  long totalBits = 0;         // Total number of bits observed
-  long totalWords = 0;        // Total number of frames observed
-  long wordErrors = 0;        // Number of word errors observed
-  long totalIterations = 0;   // Total number of iterations accumulated over all frames.
-  vector<int> error_weight_hist(H.N,0);  // Vector to serve as histogram of error-pattern weights (1 up to H.N)
-
-  // Declare and initialize message memories:
-
-  vector<vector<double> > check_to_sym;
-  vector<vector<double> > sym_to_check;
-  vector<vector<double> > sym_memories;
-
-  // Allocate appropriate sizes for the message memories:                                                                                                                                                         
-  setupSymMessages(H,sym_to_check,sym_memories);
-  setupCheckMessages(H,check_to_sym);
-
-  /////////////////////////////////////////////////////////////////
-  // ------===== MAIN TEST LOOP =====-------
-  /////////////////////////////////////////////////////////////////
-  ran_seed(time(0)); //(134159);
-  int i,j;
-   while ((errors < 200) || (wordErrors < 40))
+  // Run every point of the parameter sweep in this process, keeping
+  // the graph and the workers' buffers:
+  vector<ddbmp_workspace> workspaces(numThreads);
+  for (long point=0; point<sweepPoints(sweep); point++)
     {
-      string s;
-      // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
-	{
-	  getline(codewordFile, s);
-	  if (codewordFile.eof())
+      sweepSelect(sweep, point);
+      rewindCodewords(codewords);
+
+      // Compute channel parameters:
+      double N0 = pow(10.0,-SNR/10.0)/R;
+      double sigma = sqrt(N0/2.0);
+      double Nq = pow(2.0,Q);
+
+      // Get code parameters:
+      int dv = G.biggest_dv;
+      int dc = G.biggest_dc;
+
+      // Report initial status messages:
+      cout << "Simulating DD-BMP decoding on code with N=" << G.N << ", M=" << G.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
+      cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
+
+
+      // Declare and initialize statistics variables:
+      mc_engine mc(numThreads, G.N, mcStopRule(stopping, 200, 40));
+      run_timer timer = startTimer();
+      profiler prof(profiling, numThreads);
+      bool useCodewordFile = (codewords.frames > 0);
+      cout << "Running " << numThreads << " worker thread(s) with seed " << seed << endl;
+
+      // With --producers, the channel runs on its own threads:
+      is_channel noBias = {0.0, 1.0};
+      channel_source source = {G.N, sigma, noBias, useEncoder ? &encoder : NULL, useCodewordFile ? &codewords : NULL};
+      unique_ptr<frame_pipeline> pipe;
+      if (producers > 0)
+	pipe.reset(new frame_pipeline(mc, source, producers, ringDepth, seed));
+
+      // Set up each point's workspaces. After the first point this
+      // reuses their storage and only resets the contents:
+      for (int t=0; t<numThreads; t++)
+	allocWorkspace(G, workspaces[t]);
+
+      /////////////////////////////////////////////////////////////////
+      // ------===== MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+      // Each worker owns a workspace and a random stream, and decodes
+      // frames until the engine's stopping rule holds.
+      auto decodeFrames = [&](int tid)
+      {
+	ddbmp_workspace & W = workspaces[tid];
+	vector<int>    & c  = W.c;
+	vector<double> & x  = W.x;
+	vector<double> & y  = W.y;
+	vector<double> & yq = W.yq;
+	vector<int>    & d  = W.d;
+	vector<int>    & r  = W.r;
+	vector<double> & check_to_sym = W.check_to_sym;
+	vector<double> & sym_to_check = W.sym_to_check;
+	vector<double> & sym_memories = W.sym_memories;
+
+	allocation_probe probe;
+	ran_stream(seed, tid);
+	stage_clock stages(prof, tid);
+	int i;
+	while (!mc.stop.load())
 	  {
-	    codewordFile.clear();
-	    codewordFile.seekg(0);
-	    getline(codewordFile, s);
-	  }
-	  for (i=0; i<H.N; i++)
-	  {	    
-	    if (s[i] == '1')	      
-	      c[i] = -1;
-	    else if (s[i] == '0')
-	      c[i] = +1;
+	    if (pipe)
+	      {
+		// Take the next frame from the producers, trading buffers:
+		channel_frame * F = pipelineAcquire(*pipe, tid);
+		if (F == NULL)
+		  break;
+		c.swap(F->c);
+		y.swap(F->y);
+		pipelineRelease(*pipe, tid);
+	      }
 	    else
-	      cout << "Got an invalid symbol at index " << i << endl;
-	    x[i] = c[i];
+	      {
+	      // Draw a fresh codeword, or load one from the codeword file:
+	      if (useEncoder)
+		{
+		  randomCodeword(encoder, ran_state, &W.acc[0], c);
+		  for (i=0; i<G.N; i++)
+		    x[i] = c[i];
+		}
+	      else if (useCodewordFile)
+		{
+		  const uint8_t * row = nextCodeword(codewords);
+		  for (i=0; i<G.N; i++)
+		    {
+		      c[i] = codewordBit(row, i) ? -1 : +1;
+		      x[i] = c[i];
+		    }
+		}
+	      // Emulate AWGN transmission
+	      for (i=0; i<G.N; i++)
+		y[i] = x[i]*(1.0+sigma*rann());
+	      }
+
+	    int uncodedErrors = 0;
+	    for (i=0; i<G.N; i++)
+	      {
+		yq[i] = quantize(y[i],Ymax,Nq);
+		if (yq[i] > 0)
+		  r[i] = 1;
+		else
+		  r[i] = -1;
+		d[i] = r[i];
+		if (r[i]*c[i] < 0)
+		  uncodedErrors++;
+	      }
+
+	    initializeSymMessages(G, sym_to_check, sym_memories, yq);
+	    stages.lap(STAGE_CHANNEL);
+
+
+	    // Perform decoding iterations:
+	    int it;
+
+
+	    for (it=0; it<num_iterations; it++)
+	      {
+		// First update the check nodes:
+		ddbmpCheckNodeUpdates(G,sym_to_check,check_to_sym);
+		stages.lap(STAGE_CHECK);
+
+		// Then perform Symbol node updates:
+		ddbmpSymNodeUpdates(G, yq, d, sym_to_check, check_to_sym, sym_memories);
+		stages.lap(STAGE_SYMBOL);
+
+		// Check stopping condition:
+		bool satisfied = checkStoppingCondition(G,d);
+		stages.lap(STAGE_SYNDROME);
+		traceIteration(trace, G, 0, it, bipolarBits(d));
+		if (satisfied)
+		  break;
+	      }
+
+	    // --- End of iteration --------------------------------------
+	    // -------------------------------------------------------------
+
+
+	    // Count remaining errors after decoding, and update the
+	    // statistics and error-weight histogram:
+	    traceFrame(trace, G, 0, it, bipolarBits(d));
+	    traceNext(trace, 1);
+	    int newErrors = countDecisionErrors(d,c);
+	    mcRecordFrame(mc, tid, newErrors, uncodedErrors, it, G.N, "");
+	    stages.lap(STAGE_IO);
+	    probe.endFrame();
 	  }
-	}
-      // Emulate AWGN transmission      
-      for (i=0; i<H.N; i++)
-	{
-	  y[i] = x[i]*(1.0+sigma*rann());
-	  yq[i] = quantize(y[i],Ymax,Nq);
-	  if (yq[i] > 0)
-	    r[i] = 1;
-	  else
-	    r[i] = -1;
-	  d[i] = r[i];
-	  if (r[i]*c[i] < 0)
-	    uncodedErrors++;
-	}
-
-      initializeSymMessages(H, sym_to_check, sym_memories, yq);
-
-
-      // Perform decoding iterations:      
-      int it;
-
-      
-      for (it=0; it<num_iterations; it++)
-	{      
-	  // First update the check nodes:
-	  checkNodeUpdates(H,sym_to_check,check_to_sym);
-	  
-	  // Then perform Symbol node updates:
-	  symNodeUpdates(H, yq, d, sym_to_check, check_to_sym, sym_memories);	  
-
-	  // Check stopping condition:
-	  if (checkStoppingCondition(H,d))
-	    break;
-	}
-      
-      // --- End of iteration --------------------------------------
-      // -------------------------------------------------------------
-
+      };
+
+      // Give a status message every 5 frames
+      mcRun(mc, decodeFrames, 5);
+      if (pipe)
+	pipelineStop(*pipe);
+      /////////////////////////////////////////////////////////////////
+      // ------===== END OF MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+
+      frame_totals totals = mcTotals(mc);
+      long errors          = totals.errors;
+      long uncodedErrors   = totals.uncodedErrors;
+      long totalBits       = totals.totalBits;
+      long totalWords      = totals.totalWords;
+      long wordErrors      = totals.wordErrors;
+      long totalIterations = totals.totalIterations;
 
-      // Count remaining errors after decoding:
-      int newErrors = countDecisionErrors(d,c);
-
-      if (newErrors > 0)
-	{
-	  // Report the frame error to the console:
-	  cout << "Ferr with " << newErrors << " errors.";
-	  cout << endl;
-
-	  // Update statistical information
-	  errors += newErrors;
-	  error_weight_hist[newErrors-1]++;
-	  wordErrors++;
-	  
-	}
-
-      // Increment frame and bit counters:
-      totalWords++;
-      totalBits += H.N;
-      totalIterations += it;
-      
       // ------------------------------------------------
-      // Give a status message every 100 frames
-      if ((totalWords % 5) == 0)
+      // REPORT FINAL RESULTS:
+      cout << "\nFinal result: " << errors << " bit errs in " 
+	   << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
+	   << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
+	   << (double)uncodedErrors/totalBits << endl;      
+      mcPrintInterval(stopping, totals);
+      profileReport(prof, totals, G.E);
+      reportAllocations();
+
+      if (!resultsFile.empty())
 	{
-	  cout << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
-	       << ". Average iterations = " << (double) totalIterations/totalWords << ". Word error=" << wordErrors << ". Uncoded errors = " << uncodedErrors << ", uncBER=" << (double)uncodedErrors/totalBits
-	       << "\nError weights:\n";
-	  printHistogram(error_weight_hist);
+	  result_record rec;
+	  recordRun(rec, argc, argv, command_arguments, sweep, seed, numThreads);
+	  recordTotals(rec, totals, timer);
+	  recordProfile(rec, prof, totals, G.E);
+	  writeResultRecord(resultsFile, rec);
 	}
-      // ------------------------------------------------
 
+      ofstream of(logfilename.c_str(),ios::app);
+      char tab = '\t';
+      of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
+	 << (double) wordErrors/totalWords << tab
+	 << num_iterations << tab
+	 << Ymax << tab 
+	 << Q << tab;
+
+      of << argv[1]
+	 << endl;
+      of.close();
     }
-  /////////////////////////////////////////////////////////////////
-  // ------===== END OF MAIN TEST LOOP =====-------
-  /////////////////////////////////////////////////////////////////
-  
-  // ------------------------------------------------
-  // REPORT FINAL RESULTS:
-  cout << "\nFinal result: " << errors << " bit errs in " 
-       << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
-       << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
-       << (double)uncodedErrors/totalBits << endl;      
-
-  ofstream of(logfilename.c_str(),ios::app);
-  char tab = '\t';
-  of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
-     << (double) wordErrors/totalWords << tab
-     << num_iterations << tab
-     << Ymax << tab 
-     << Q << tab;
-
-  of << argv[1]
-     << endl;
-  of.close();
-
-  freeAlist(H);
+
+  closeCodewords(codewords);
+  freeTanner(G);
+  closeTrace(trace);
 
   return 0;
 }
@@ -278,34 +365,28 @@ int main(int argc, char * argv[])
 // adequate comments...
 //============================================================//
 
-void  setupSymMessages(alist_struct & H, vector<vector<double> > & sym_to_check, vector<vector<double> > & sym_memories)
+void allocWorkspace(tanner_struct &G, ddbmp_workspace & W)
 {
-  for (int i=0; i<H.N; i++)
-    {
-      vector<double> initial_msgs(H.num_nlist[i],0.0);
-      sym_memories.push_back(initial_msgs);
-      sym_to_check.push_back(initial_msgs);
-    }
-}
-
-void setupCheckMessages(alist_struct & H,vector<vector<double> > & check_to_sym)
-{
-  for (int i=0; i<H.M; i++)
-    {
-      vector<double> initial_msgs(H.num_mlist[i],0.0);
-      check_to_sym.push_back(initial_msgs);
-    }
+  W.c.assign(G.N,1);
+  W.x.assign(G.N,1);
+  W.y.assign(G.N,1);
+  W.yq.assign(G.N,0.0);
+  W.d.assign(G.N,0);
+  W.r.assign(G.N,0);
+  W.check_to_sym.assign(G.E,0.0);
+  W.sym_to_check.assign(G.E,0.0);
+  W.sym_memories.assign(G.E,0.0);
+  W.acc.assign((G.M+63)/64,0);
 }
 
-
-void initializeSymMessages(alist_struct & H,  vector<vector<double> > & sym_to_check, vector<vector<double> > & sym_memories, vector<double> & y)
+void initializeSymMessages(tanner_struct & G,  vector<double> & sym_to_check, vector<double> & sym_memories, vector<double> & y)
 {
-  int i,j;
-  for (i=0; i<H.N; i++)
-    for (j=0; j<H.num_nlist[i]; j++)
+  int i,k;
+  for (i=0; i<G.N; i++)
+    for (k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
       {
-	sym_to_check[i][j] = sgn(y[i]);
-	sym_memories[i][j] = y[i];
+	sym_to_check[k] = sgn(y[i]);
+	sym_memories[k] = y[i];
       }
 }
 
@@ -319,7 +400,7 @@ void printHistogram(vector<int> & h)
     }
 }
 
-int countDecisionErrors(vector<int> d, vector<int> c)
+int countDecisionErrors(const vector<int> & d, const vector<int> & c)
 {
   int errs =0 ;
   for (int i=0; i<d.size(); i++)
@@ -347,43 +428,17 @@ void printErroneousMessages(vector<vector<int> > v)
     }
 }
 
-void checkNodeUpdates(alist_struct &H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym)
-{
-  double msg;
-  double prod;
-  for (int i=0; i<H.M; i++)
-    {
-      prod = 1.0;
-      for (int j=0; j<H.num_mlist[i]; j++)
-	{
-	  int snode = H.mlist[i][j]-1;
-	  int midx = find(H.nlist[snode], H.num_nlist[snode], i);
-	  msg = sym_to_check[snode][midx];
-	  prod *= sgn(msg);
-	}
-      for (int j=0; j<H.num_mlist[i]; j++)
-	{
-	  int snode = H.mlist[i][j]-1;
-	  int midx = find(H.nlist[snode], H.num_nlist[snode], i);
-	  msg = sym_to_check[snode][midx];
-	  check_to_sym[i][j] = prod*sgn(msg);	
-	}
-    }
-}
-
-
-bool checkStoppingCondition(alist_struct &H, vector<int> & d)
+bool checkStoppingCondition(tanner_struct &G, vector<int> & d)
 {
   double msg;
   double prod=1.0;
   bool satisfied = true;
-  for (int i=0; i<H.M; i++)
+  for (int i=0; i<G.M; i++)
     {
       prod=1.0;
-      for (int j=0; j<H.num_mlist[i]; j++)
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
 	{
-	  int snode = H.mlist[i][j]-1;
-	  msg = sgn(d[snode]);
+	  msg = sgn(d[G.check_sym[e]]);
 	  prod *= msg;
 	}
       if (prod < 0)
@@ -393,36 +448,6 @@ bool checkStoppingCondition(alist_struct &H, vector<int> & d)
 }
 
 
-void symNodeUpdates(alist_struct &H, vector<double> & y, vector<int> & d, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym, vector<vector<double> > & sym_memories)
-{ 
-  for (int i=0; i<H.N; i++)
-    {
-      double sum = y[i];
-      double dsum = sgn(y[i]);
-      for (int j=0; j<H.num_nlist[i]; j++)
-	{
-	  int cnode = H.nlist[i][j]-1;
-	  int midx = find(H.mlist[cnode],H.num_mlist[cnode],i);
-	  double msg = check_to_sym[cnode][midx];
-	  sum += msg;
-	}      
-      for (int j=0; j<H.num_nlist[i]; j++) 
-	{
-	  int cnode = H.nlist[i][j]-1;  
-	  int midx = find(H.mlist[cnode],H.num_mlist[cnode],i); 
-	  double msg = check_to_sym[cnode][midx]; 
-	  sym_memories[i][j] += sum - msg;
-	  sym_to_check[i][j] = sgn(sym_memories[i][j]);
-	  dsum += sym_to_check[i][j];
-	}
-      if (dsum > 0)
-	d[i] = 1;
-      else
-	d[i] = -1;	
-    }
-}
-
-
 double sgn(double x)
 {
   if (x >= 0.0)
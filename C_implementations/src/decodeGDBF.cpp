@@ -9,38 +9,72 @@
 // sequential flipping.
 //==============================================================
 
-//--- COMPILE OPTIONS ---//
-// Possible algorithm modes. Implement the different options
-// by passing them to the compiler via -D <option>.
-// Note that some options don't make sense together (e.g. 
-// modeswitching and sequentialmode).
+//--- ALGORITHM VARIANTS ---//
+// The algorithm options are the members of a gdbf_variant policy,
+// and the decoder is a template over it, so each variant is compiled
+// with its options fixed and no per-symbol tests of them:
+//   sequentialmode        Use sequential flipping only
+//   modeswitching         Use Wadayama's parallel-serial mode-switching technique for improved performance
+//   addNoise              Add noise perturbation
+//   thresholdAdaptation   Scale each symbol's threshold by lambda while it does not flip
+//   weightSyndromes       Apply scale factor alpha to weight syndrome sums
+//   outputSmoothing       Apply smoothing to the output
+//   saturateSamples       Clip the channel samples to +/-Ymax
+//   quantizeSamples       Quantize the channel samples on NQ bits
+//   quantizeProbabilities Use only a small set of flipping probabilities
+// The named variants in gdbfVariants[] are instantiated, and a run
+// picks one with --variant NAME. Without the flag the variant is
+// taken from the program name, so the Makefile's decodeMGDBF,
+// decodeSMNGDBF, etc. are links to one decodeGDBF binary. Each
+// variant takes the positional arguments its options need.
+//
+// Some options don't make sense together (e.g. modeswitching and
+// sequentialmode). The experimental noise options below are still
+// chosen at compile time, with -D <option>:
 /*
-//#define parallelmode
-//#define sequentialmode  // Use sequential flipping only
-//#define modeswitching   // Use Wadayama's parallel-serial mode-switching technique for improved performance
-//#define addNoise        // Add noise perturbation
-//#define weightSyndromes // NOT IMPLEMENTED Apply scale factor to weight syndrome sums
-//#define outputSmoothing // Apply smoothing to the output
-//#define thresholdAdaptation
-//#define saturateSamples
-//#define anneal // Dynamically reduce noise variance during decoding
-//#define noiseShaping
-//#define quantizeProbabilities // Use only a small set of flipping probabilities
+//#define uniformNoise    // Draw the perturbation from a uniform distribution
+//#define noiseShaping    // Perturb by the difference of successive noise samples
 */
 
+//--- INCREMENTAL UPDATES ---//
+// The check products are computed in full once per frame. After that,
+// each iteration only toggles the checks adjacent to the flipped bits,
+// and adjusts the syndrome sums of their neighbours (see flip_state).
+// Without noise or threshold adaptation, a symbol's energy can only
+// change when a neighbour flips, so in parallel mode only those
+// symbols are examined and an iteration costs O(flips*dv*dc). When
+// so many bits flip that this would exceed a full pass over the
+// edges, the checks are recomputed in full instead.
+
 //--- Standard C++ headers ---//
 #include <iostream>
 #include <fstream>
 #include <cstdlib>
 #include <vector>
+#include <memory>
 #include <cmath>
 #include <sstream>
 #include <time.h>
+#include <atomic>
 using namespace std;
 
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
-#include "rand.h"
+#include "tanner.h"
+#include "rand_xoshiro.h"
+#include "rand_normal.h"
+
+//--- Simulation support ---//
+#include "options.h"
+#include "montecarlo.h"
+#include "encoder.h"
+#include "codewords.h"
+#include "records.h"
+#include "instrument.h"
+#include "trace.h"
+#include "pipeline.h"
+#include "alloccount.h"
+#include "gdbf_kernels.h"
 
 
 //============ GLOBAL PARAMETERS ============//
@@ -55,18 +89,73 @@ int    windowsize = 64;
 double noiseScale = 1.0;
 int    NQ         = 16;
 
+//============ DECODING STATE ===============//
+// Frame buffers and decoder state for one worker, allocated once per
+// run so that the frame loop does no heap allocation:
+typedef struct {
+  vector<int>    c;             // Bipolar codeword (all +1 in this simulation)
+  vector<double> x;             // Modulated codeword (all +1 in this simulation)
+  vector<double> y;             // Channel samples
+  vector<double> yq;            // Quantized channel samples
+  vector<int>    r;             // Received bipolar decisions (+1 or -1)
+  vector<int>    d;             // Decoder outputs (+1 or -1 after decoding)
+  vector<int>    dsum;          // Decision sums for outputSmoothing
+  vector<double> perturbation;
+  vector<double> noiseSamples;
+  vector<double> gauss;         // Batch of standard normal deviates
+  vector<double> thetas;
+  vector<int>    check_to_sym;
+  flip_state     F;
+  vector<uint64_t> acc;         // Encoder check-bit accumulator
+} gdbf_workspace;
+
+void allocWorkspace(tanner_struct &G, gdbf_workspace & W);
+
+//============ ALGORITHM VARIANTS ===========//
+// Options common to every variant, taken from the command line
+// before the variant's positional arguments are counted:
+typedef struct {
+  int          numThreads;
+  long         seed;
+  stop_policy  stopping;
+  string       resultsFile;
+  bool         profiling;
+  decode_trace trace;
+  is_channel   channel;
+  int          producers;
+  int          ringDepth;
+} gdbf_flags;
+
+typedef int (*gdbf_decoder)(int argc, char * argv[], gdbf_flags & flags);
+
+typedef struct {
+  const char * name;
+  gdbf_decoder decode;
+} gdbf_entry;
+
+template <class P> int decodeGDBF(int argc, char * argv[], gdbf_flags & flags);
+
+//                              seq    switch noise  adapt  weight smooth sat    qsamp  qprob
+static const gdbf_entry gdbfVariants[] = {
+  { "GDBF",            decodeGDBF<gdbf_variant<false, false, false, false, false, false, false, false, false> > },
+  { "MGDBF",           decodeGDBF<gdbf_variant<false, true,  false, false, false, false, false, false, false> > },
+  { "SGDBF",           decodeGDBF<gdbf_variant<true,  false, false, false, false, false, false, false, false> > },
+  { "SMGDBF",          decodeGDBF<gdbf_variant<false, false, false, false, false, true,  false, false, false> > },
+  { "ATGDBF",          decodeGDBF<gdbf_variant<false, false, false, true,  false, false, false, false, false> > },
+  { "SATGDBF",         decodeGDBF<gdbf_variant<false, false, false, true,  false, true,  false, false, false> > },
+  { "MNGDBF",          decodeGDBF<gdbf_variant<false, false, true,  true,  true,  false, true,  false, false> > },
+  { "SMNGDBF",         decodeGDBF<gdbf_variant<false, false, true,  true,  true,  true,  true,  false, false> > },
+  { "StochasticNGDBF", decodeGDBF<gdbf_variant<false, false, false, false, true,  false, true,  true,  true > > },
+};
+static const int numGdbfVariants = sizeof(gdbfVariants)/sizeof(gdbfVariants[0]);
+
 //============ DECODING ALGORITHM PREDEFINES ===============//
-void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied);
-void symNodeUpdates(alist_struct &H, vector<double> &  thetas, double & lambda, int & mu,  vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation);
-double evaluateObjectiveFunction(alist_struct &H, vector<int> & d, vector<double> & y, vector<int> & check_to_sym); 
+// The node updates are in gdbf_kernels.h.
+double evaluateObjectiveFunction(tanner_struct &G, vector<int> & d, vector<double> & y, vector<int> & check_to_sym); 
 
 //============= SUPPORTING FUNCTION PREDEFINES =================//
 int find(int symNodes[], int len, int snode);
-int countDecisionErrors(vector<int> d, vector<int> c);
-double normalCDF(double value)
-{
-  return 0.5 * erfc(-value * M_SQRT1_2);
-}
+int countDecisionErrors(const vector<int> & d, const vector<int> & c);
 double quantize(double x);
 double sgn(double y);
 
@@ -85,6 +174,50 @@ void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check
 ///////////////////////////////////////////////////////////////////////////////
 int main(int argc, char * argv[])
 {
+  // Optional flags, removed from argv before the positional arguments are counted:
+  gdbf_flags flags;
+  flags.numThreads  = resolveThreads(extractLongOption(argc, argv, "threads", 1));
+  flags.seed        = extractLongOption(argc, argv, "seed", time(0));
+  flags.stopping    = extractStopPolicy(argc, argv);
+  flags.resultsFile = extractStringOption(argc, argv, "results", "");
+  flags.profiling   = extractLongOption(argc, argv, "profile", 0);
+  flags.trace       = openTrace(argc, argv, flags.numThreads);
+  flags.channel     = extractISChannel(argc, argv);
+  extractPipeline(argc, argv, flags.numThreads, flags.producers, flags.ringDepth);
+  flags.stopping.weighted = isActive(flags.channel);
+
+  // The variant defaults to the program name without "decode":
+  string program(argv[0]);
+  program = program.substr(program.rfind('/') + 1);
+  if (program.compare(0, 6, "decode") == 0)
+    program.erase(0, 6);
+  string variant = extractStringOption(argc, argv, "variant", program.c_str());
+
+  for (int v=0; v<numGdbfVariants; v++)
+    if (variant == gdbfVariants[v].name)
+      return gdbfVariants[v].decode(argc, argv, flags);
+
+  cout << "Unknown variant " << variant << ". Usage: " << argv[0] << " --variant V ..., where V is one of:";
+  for (int v=0; v<numGdbfVariants; v++)
+    cout << " " << gdbfVariants[v].name;
+  cout << endl;
+  return 0;
+}
+
+
+// Decodes with the options of variant P:
+template <class P> int decodeGDBF(int argc, char * argv[], gdbf_flags & flags)
+{
+  int           numThreads  = flags.numThreads;
+  long          seed        = flags.seed;
+  stop_policy   stopping    = flags.stopping;
+  string        resultsFile = flags.resultsFile;
+  bool          profiling   = flags.profiling;
+  decode_trace & trace      = flags.trace;
+  is_channel    channel     = flags.channel;
+  int           producers   = flags.producers;
+  int           ringDepth   = flags.ringDepth;
+
   vector<string> command_arguments(0);
   command_arguments.push_back("alist");
   command_arguments.push_back("R");
@@ -92,30 +225,24 @@ int main(int argc, char * argv[])
   command_arguments.push_back("T");
   command_arguments.push_back("theta");
   command_arguments.push_back("logfilename");
-#if defined(addNoise) || defined(quantizeProbabilities) 
-  command_arguments.push_back("noiseScale");
-  #endif
-#ifdef quantizeSamples
-  command_arguments.push_back("NQ");
-#endif
-  #ifdef thresholdAdaptation
-  command_arguments.push_back("lambda");
-  #endif
-  #ifdef weightSyndromes
-  command_arguments.push_back("alpha");
-  #endif
-  #ifdef outputSmoothing
-  command_arguments.push_back("windowsize");
-  #endif
-  #ifdef saturateSamples
-  command_arguments.push_back("Ymax");
-  #endif
-  command_arguments.push_back("[codeword filename]");
+  if (P::addNoise || P::quantizeProbabilities)
+    command_arguments.push_back("noiseScale");
+  if (P::quantizeSamples)
+    command_arguments.push_back("NQ");
+  if (P::thresholdAdaptation)
+    command_arguments.push_back("lambda");
+  if (P::weightSyndromes)
+    command_arguments.push_back("alpha");
+  if (P::outputSmoothing)
+    command_arguments.push_back("windowsize");
+  if (P::saturateSamples)
+    command_arguments.push_back("Ymax");
+  command_arguments.push_back("[codeword filename|random|gen file]");
 
   // Check arguments and print usage statements:
   if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
     {
-      cout << "Usage: " << argv[0];
+      cout << "Usage: " << argv[0] << " [--variant V] [--threads N] [--seed S]" << MC_STOP_USAGE << MC_IS_USAGE << MC_PIPE_USAGE << RESULTS_USAGE << PROFILE_USAGE << TRACE_USAGE;
       for (int i=0; i<command_arguments.size(); i++)
 	cout << " " << command_arguments[i];
       cout << "\n";
@@ -124,332 +251,397 @@ int main(int argc, char * argv[])
 
   // Parse command arguments:
   int idx=1;
-  alist_struct H = loadFile(argv[idx++]);
+  tanner_struct G = loadTanner(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
   double R = atof(argv[idx++]);
   cout << " R = \t" << R << endl;
-  double SNR = atof(argv[idx++]);
-  cout << " SNR = \t" << SNR << endl;
+  sweep_struct sweep;
+  double SNR;
+  addSweep(sweep, "SNR", argv[idx], SNR);
+  cout << " SNR = \t" << argv[idx++] << endl;
   num_iterations = atoi(argv[idx++]);
   cout << " T = \t" << num_iterations << endl;
-  theta = atof(argv[idx++]);
-  cout << " theta = \t" << theta << endl;
+  addSweep(sweep, "theta", argv[idx], theta);
+  cout << " theta = \t" << argv[idx++] << endl;
   string logfilename(argv[idx++]);
   cout << " log = \t" << logfilename << endl;
 
-#if defined(addNoise) || defined(quantizeProbabilities)
-  noiseScale = atof(argv[idx++]);
-  cout << " noiseScale = \t" << noiseScale << endl;
-  #endif
-#ifdef quantizeSamples
-  NQ = atoi(argv[idx++]);
-  cout << " NQ = \t" << NQ << endl;
-#endif
-  #ifdef thresholdAdaptation
-  lambda = atof(argv[idx++]);
-  cout << " lambda = \t" << lambda << endl;
-  #endif
-  #ifdef weightSyndromes
-  alpha = atof(argv[idx++]);
-  cout << " alpha = \t" << alpha << endl;
-  #endif
-  #ifdef outputSmoothing
-  windowsize = atoi(argv[idx++]);
-  cout << "windowsize = \t" << windowsize << endl;
-  #endif
-  #ifdef saturateSamples
-  Ymax = atof(argv[idx++]);
-  cout << " Ymax = \t" << Ymax << endl;
-  #endif
+  if (P::addNoise || P::quantizeProbabilities)
+    {
+      addSweep(sweep, "noiseScale", argv[idx], noiseScale);
+      cout << " noiseScale = \t" << argv[idx++] << endl;
+    }
+  if (P::quantizeSamples)
+    {
+      NQ = atoi(argv[idx++]);
+      cout << " NQ = \t" << NQ << endl;
+    }
+  if (P::thresholdAdaptation)
+    {
+      addSweep(sweep, "lambda", argv[idx], lambda);
+      cout << " lambda = \t" << argv[idx++] << endl;
+    }
+  if (P::weightSyndromes)
+    {
+      addSweep(sweep, "alpha", argv[idx], alpha);
+      cout << " alpha = \t" << argv[idx++] << endl;
+    }
+  if (P::outputSmoothing)
+    {
+      windowsize = atoi(argv[idx++]);
+      cout << "windowsize = \t" << windowsize << endl;
+    }
+  if (P::saturateSamples)
+    {
+      addSweep(sweep, "Ymax", argv[idx], Ymax);
+      cout << " Ymax = \t" << argv[idx++] << endl;
+    }
 
-  ifstream codewordFile;
-  if (argc == command_arguments.size()+1)
+  codeword_stream codewords;
+  encoder_struct encoder;
+  bool useEncoder = (argc == command_arguments.size()+1) && isEncoderSource(argv[idx]);
+  if (useEncoder)
+    {
+      cout << "\nUsing random codewords from " << argv[idx] << endl;
+      encoder = openEncoder(argv[idx], G);
+    }
+  else if (argc == command_arguments.size()+1)
     {
       cout << "\nUsing codewords from " << argv[idx] << endl;
-      codewordFile.open(argv[idx],ios::in);
+      openCodewords(codewords, argv[idx], G.N);
     }
   else
     cout << "\nUsing all-zero sequence.\n";
 
-  // Compute channel parameters:
-  double N0 = pow(10.0,-SNR/10.0)/R;
-  double sigma = sqrt(N0/2.0);
-
-  // Get code parameters:
-  int dv = H.biggest_num_n;
-  int dc = H.biggest_num_m;
-
-  // Report initial status messages:
-  cout << "Simulating GDBF decoding on code with N=" << H.N << ", M=" << H.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
-  cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
-
-
-  // Declare top-level variables:
-  vector<int>    c(H.N,1);     // Bipolar codeword (all +1 in this simulation)
-  vector<double> x(H.N,1);     // Modulated codeword (all +1 in this simulation)
-  vector<double> y(x);          // Channel samples
-  vector<double> yq(H.N);       // Quantized channel samples
-  vector<int>    r(H.N);        // Received bipolar decisions (+1 or -1)
-  vector<int>    d(H.N,0);      // Decoder outputs (+1 or -1 after decoding)
-
-  #ifdef outputSmoothing
-  vector<int> dsum(H.N,0);
-  int smoothingUsed = 0;
-  #endif
-
-  vector<double> perturbation(H.N,0.0);
-  vector<double> noiseSamples(H.N,0.0);
-
-  // Declare and initialize statistics variables:
-  long errors = 0;            // Total bit errors
-  long uncodedErrors = 0;     // Bit errors in r before decoding
-  long totalBits = 0;         // Total number of bits observed
-  long totalWords = 0;        // Total number of frames observed
-  long wordErrors = 0;        // Number of word errors observed
-  long totalIterations = 0;   // Total number of iterations accumulated over all frames.
-  vector<int> error_weight_hist(H.N,0);  // Vector to serve as histogram of error-pattern weights (1 up to H.N)
-  vector<double> thetas(H.N,theta);
-
-  // NOTE: Could also do a histogram of the iteration count. It might be interesting.
-
-  // Declare and initialize message memories:
-  vector<int> check_to_sym(H.M,0);
-
-  /////////////////////////////////////////////////////////////////
-  // ------===== MAIN TEST LOOP =====-------
-  /////////////////////////////////////////////////////////////////
-  int minWordErrors = 20;
-  if (H.N > 10000) minWordErrors = 10;
-  if (H.N > 50000) minWordErrors = 5;
-  ran_seed(time(0)); //(134159);
-  int i,j;
-   while ((errors < 200) || (wordErrors < minWordErrors))
+  // Run every point of the parameter sweep in this process, keeping
+  // the graph and the workers' buffers:
+  vector<gdbf_workspace> workspaces(numThreads);
+  for (long point=0; point<sweepPoints(sweep); point++)
     {
-      string s;
-      // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
-	{
-	  getline(codewordFile, s);
-	  if (codewordFile.eof())
+      sweepSelect(sweep, point);
+      rewindCodewords(codewords);
+
+      // Compute channel parameters:
+      double N0 = pow(10.0,-SNR/10.0)/R;
+      double sigma = sqrt(N0/2.0);
+
+      // Get code parameters:
+      int dv = G.biggest_dv;
+      int dc = G.biggest_dc;
+
+      // Report initial status messages:
+      cout << "Simulating GDBF decoding on code with N=" << G.N << ", M=" << G.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
+      cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
+
+
+      // Declare and initialize statistics variables:
+      int minWordErrors = 20;
+      if (G.N > 10000) minWordErrors = 10;
+      if (G.N > 50000) minWordErrors = 5;
+      mc_engine mc(numThreads, G.N, mcStopRule(stopping, 200, minWordErrors));
+      run_timer timer = startTimer();
+      profiler prof(profiling, numThreads);
+      bool useCodewordFile = (codewords.frames > 0);
+      atomic<long> smoothingFrames(0);
+      cout << "Running " << numThreads << " worker thread(s) with seed " << seed << endl;
+
+      // With --producers, the channel runs on its own threads:
+      channel_source source = {G.N, sigma, channel, useEncoder ? &encoder : NULL, useCodewordFile ? &codewords : NULL};
+      unique_ptr<frame_pipeline> pipe;
+      if (producers > 0)
+	pipe.reset(new frame_pipeline(mc, source, producers, ringDepth, seed));
+
+      // Set up each point's workspaces. After the first point this
+      // reuses their storage and only resets the contents:
+      for (int t=0; t<numThreads; t++)
+	allocWorkspace(G, workspaces[t]);
+
+      // NOTE: Could also do a histogram of the iteration count. It might be interesting.
+
+      /////////////////////////////////////////////////////////////////
+      // ------===== MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+      // Each worker owns a workspace and a random stream, and decodes
+      // frames until the engine's stopping rule holds.
+      auto decodeFrames = [&](int tid)
+      {
+	gdbf_workspace & W = workspaces[tid];
+	vector<int>    & c  = W.c;
+	vector<double> & x  = W.x;
+	vector<double> & y  = W.y;
+	vector<double> & yq = W.yq;
+	vector<int>    & r  = W.r;
+	vector<int>    & d  = W.d;
+	vector<int>    & dsum = W.dsum;
+	vector<double> & perturbation = W.perturbation;
+	vector<double> & gauss = W.gauss;
+	vector<double> & thetas = W.thetas;
+	vector<int>    & check_to_sym = W.check_to_sym;
+	flip_state     & F = W.F;
+
+	allocation_probe probe;
+	ran_stream(seed, tid);
+	ran_normal_seed(seed, tid);
+	stage_clock stages(prof, tid);
+	int i;
+	while (!mc.stop.load())
 	  {
-	    codewordFile.clear();
-	    codewordFile.seekg(0);
-	    getline(codewordFile, s);
-	  }
-	  for (i=0; i<H.N; i++)
-	  {	    
-	    if (s[i] == '1')	      
-	      c[i] = -1;
-	    else if (s[i] == '0')
-	      c[i] = +1;
+	    double logWeight = 0.0;
+	    if (pipe)
+	      {
+		// Take the next frame from the producers, trading buffers:
+		channel_frame * F = pipelineAcquire(*pipe, tid);
+		if (F == NULL)
+		  break;
+		c.swap(F->c);
+		y.swap(F->y);
+		logWeight = F->logWeight;
+		pipelineRelease(*pipe, tid);
+	      }
 	    else
-	      cout << "Got an invalid symbol at index " << i << endl;
-	    x[i] = c[i];
-	  }
-	}
-      // Emulate AWGN transmission      
-      for (i=0; i<H.N; i++)
-	{
-	  y[i] = x[i]*(1.0+sigma*rann());
-	  yq[i] = y[i];
-	  #ifdef saturateSamples
-	  if (abs(yq[i])>Ymax)
-	    yq[i] *= Ymax/abs(yq[i]);
-	  #endif
-	  if (yq[i] > 0)
-	    r[i] = 1;
-	  else
-	    {
-	      r[i] = -1;	      
-	    }
-#ifdef quantizeSamples
-	  yq[i] = quantize(yq[i]);
-#endif
-	  if (r[i]*c[i] < 0)
-	    uncodedErrors++;
-	  d[i] = r[i];
-	  #ifdef outputSmoothing
-	  dsum[i] = 0;
-	  #endif
-	}
-
-      // Perform decoding iterations:      
-      bool satisfied;
-      int it;
-
-      #ifdef modeswitching
-      double f1, f2;
-      #endif
-
-      int mu;
-      #ifdef sequentialmode
-      mu = 0;
-      #else
-      mu=1;
-      #endif
-
-      #ifdef thresholdAdaptation
-      for (int i=0; i<H.N; i++)
-	thetas[i] = theta;
-      #endif
-
-      double noiseSigma = sigma*noiseScale;
-      
-      for (it=0; it<num_iterations; it++)
-	{      
-	  satisfied = true;
-	  
-	  
-	  // First update the check nodes:
-	  checkNodeUpdates(H,d,check_to_sym,satisfied);
-	  if (satisfied)
-	    break;
-
-	  
-	  #ifdef modeswitching
-	  if (it > Tswitch)
-	    f1 = evaluateObjectiveFunction(H,d,yq,check_to_sym);	    
-	  #endif 
-	  
-
-	  
-	  // Then perform Symbol node updates:
-	  
-	  #ifdef addNoise
-	  for (int i=0; i<H.N; i++)
-	    {
-	      #ifdef uniformNoise
-	      double newSample = sqrt(3)*noiseSigma*2.0*(ranu()-0.5);
-	      #else
-	      double newSample = noiseSigma*rann();
-	      #endif
-	      #ifdef noiseShaping
-	      perturbation[i] = newSample - noiseSamples[i];
-	      noiseSamples[i] = newSample;
-	      #else	      
-	      perturbation[i] = newSample;
-	      #endif
-	    }
-	  #endif
-	  
-
-	  symNodeUpdates(H,thetas,lambda, mu, yq, d,check_to_sym, noiseSigma, perturbation); 
-	  
-	  #ifdef modeswitching
-	  if (it > Tswitch)
-	    {
-	      f2 = evaluateObjectiveFunction(H,d,yq,check_to_sym);
-	      if (f1 >= f2)
-		mu = 0;
-	      //cout << "\tf2=" << f2 << "\t mu=" << mu << endl;
-	    }
-	  #endif
-
-	  #ifdef outputSmoothing
-	  if (it > num_iterations-windowsize)
-	    {
-	      for (int i=0; i<H.N; i++)
-		dsum[i] += d[i];
-	    }
-	  #endif
-	  
-	}
-      
-      #ifdef outputSmoothing
-      if (!satisfied)
-	for (int i=0; i<H.N; i++)
-	  {
-	    if (dsum[i] > 0)
-	      d[i] = 1;
-	    else
-	      d[i] = -1;
+	      {
+	      // Draw a fresh codeword, or load one from the codeword file:
+	      if (useEncoder)
+		{
+		  randomCodeword(encoder, ran_state, &W.acc[0], c);
+		  for (i=0; i<G.N; i++)
+		    x[i] = c[i];
+		}
+	      else if (useCodewordFile)
+		{
+		  const uint8_t * row = nextCodeword(codewords);
+		  for (i=0; i<G.N; i++)
+		    {
+		      c[i] = codewordBit(row, i) ? -1 : +1;
+		      x[i] = c[i];
+		    }
+		}
+	      // Emulate AWGN transmission
+	      ran_normals(&gauss[0], G.N);
+	      for (i=0; i<G.N; i++)
+		y[i] = x[i]*(1.0+isNoise(channel, sigma, gauss[i], logWeight));
+	      }
+
+	    int uncodedErrors = 0;
+	    for (i=0; i<G.N; i++)
+	      {
+		yq[i] = y[i];
+		if (P::saturateSamples)
+		  {
+		    if (abs(yq[i])>Ymax)
+		      yq[i] *= Ymax/abs(yq[i]);
+		  }
+		if (yq[i] > 0)
+		  r[i] = 1;
+		else
+		  {
+		    r[i] = -1;
+		  }
+		if (P::quantizeSamples)
+		  yq[i] = quantize(yq[i]);
+		if (r[i]*c[i] < 0)
+		  uncodedErrors++;
+		d[i] = r[i];
+		if (P::outputSmoothing)
+		  dsum[i] = 0;
+	      }
+
+	    // Perform decoding iterations:
+	    bool satisfied;
+	    int it;
+
+	    double f1, f2;
+
+	    int mu = P::sequentialmode ? 0 : 1;
+
+	    if (P::thresholdAdaptation)
+	      {
+		for (int i=0; i<G.N; i++)
+		  thetas[i] = theta;
+	      }
+
+	    double noiseSigma = sigma*noiseScale;
+	    stages.lap(STAGE_CHANNEL);
+
+	    // Compute the check nodes in full once; the iterations
+	    // below maintain them incrementally:
+	    gdbfCheckNodeUpdates(G,d,check_to_sym,satisfied);
+	    initFlipState(G,check_to_sym,F);
+	    stages.lap(STAGE_CHECK);
+
+	    for (it=0; it<num_iterations; it++)
+	      {
+		satisfied = (F.unsatisfied == 0);
+		if (satisfied)
+		  break;
+
+
+		if (P::modeswitching)
+		  {
+		    if (it > Tswitch)
+		      f1 = evaluateObjectiveFunction(G,d,yq,check_to_sym);
+		  }
+
+
+
+		// Then perform Symbol node updates:
+
+		if (P::addNoise)
+		  {
+		    #ifdef noiseShaping
+		    vector<double> & noiseSamples = W.noiseSamples;
+		    #endif
+		    #ifndef uniformNoise
+		    ran_normals(&gauss[0], G.N);
+		    #endif
+		    for (int i=0; i<G.N; i++)
+		      {
+			#ifdef uniformNoise
+			double newSample = sqrt(3)*noiseSigma*2.0*(ranu()-0.5);
+			#else
+			double newSample = noiseSigma*gauss[i];
+			#endif
+			#ifdef noiseShaping
+			perturbation[i] = newSample - noiseSamples[i];
+			noiseSamples[i] = newSample;
+			#else
+			perturbation[i] = newSample;
+			#endif
+		      }
+		  }
+
+
+		gdbfSymNodeUpdates<P>(G,thetas,lambda, alpha, mu, yq, d,F, noiseSigma, perturbation);
+		stages.lap(STAGE_SYMBOL);
+
+		if (P::modeswitching)
+		  {
+		    if (it > Tswitch)
+		      {
+			f2 = evaluateObjectiveFunction(G,d,yq,check_to_sym);
+			if (f1 >= f2)
+			  mu = 0;
+			//cout << "\tf2=" << f2 << "\t mu=" << mu << endl;
+		      }
+		  }
+
+		// Propagate the flips to the check nodes:
+		gdbfUpdateSyndromes(G,d,check_to_sym,F);
+		stages.lap(STAGE_SYNDROME);
+		traceIteration(trace, G, 0, it, bipolarBits(d));
+
+		if (P::outputSmoothing)
+		  {
+		    if (it > num_iterations-windowsize)
+		      {
+			for (int i=0; i<G.N; i++)
+			  dsum[i] += d[i];
+		      }
+		  }
+
+	      }
+
+	    if (P::outputSmoothing)
+	      {
+		if (!satisfied)
+		  for (int i=0; i<G.N; i++)
+		    {
+		      if (dsum[i] > 0)
+			d[i] = 1;
+		      else
+			d[i] = -1;
+		    }
+	      }
+	    // --- End of iteration --------------------------------------
+	    // -------------------------------------------------------------
+
+	    // Count number of times smoothing is used:
+	    if (P::outputSmoothing)
+	      {
+		if (it > num_iterations-windowsize)
+		  smoothingFrames++;
+	      }
+
+	    // Count remaining errors after decoding, and update the
+	    // statistics and error-weight histogram:
+	    traceFrame(trace, G, 0, it, bipolarBits(d));
+	    traceNext(trace, 1);
+	    int newErrors = countDecisionErrors(d,c);
+	    mcRecordFrame(mc, tid, newErrors, uncodedErrors, it, G.N, satisfied ? " All checks satisfied." : "",
+			  isFrameWeight(channel, logWeight, G.N));
+	    stages.lap(STAGE_IO);
+	    probe.endFrame();
 	  }
-      #endif
-      // --- End of iteration --------------------------------------
-      // -------------------------------------------------------------
-
-      // Count number of times smoothing is used:
-      #ifdef outputSmoothing
-      if (it > num_iterations-windowsize)
-	smoothingUsed++;
-      #endif
-
-      // Count remaining errors after decoding:
-      int newErrors = countDecisionErrors(d,c);
+      };
+
+      // Give a status message every 100k bits
+      mcRun(mc, decodeFrames, round(100e3/G.N));
+      if (pipe)
+	pipelineStop(*pipe);
+      /////////////////////////////////////////////////////////////////
+      // ------===== END OF MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+
+      frame_totals totals = mcTotals(mc);
+      long errors          = totals.errors;
+      long uncodedErrors   = totals.uncodedErrors;
+      long totalBits       = totals.totalBits;
+      long totalWords      = totals.totalWords;
+      long totalIterations = totals.totalIterations;
+      long smoothingUsed   = smoothingFrames.load();
 
-      if (newErrors > 0)
+      // ------------------------------------------------
+      // REPORT FINAL RESULTS:
+      cout << "\nFinal result: " << errors << " bit errs in " 
+	   << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
+	   << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
+	   << (double)uncodedErrors/totalBits << endl;      
+      mcPrintInterval(stopping, totals);
+      profileReport(prof, totals, G.E);
+      reportAllocations();
+
+      if (!resultsFile.empty())
 	{
-	  // Report the frame error to the console:
-	  cout << "Ferr with " << newErrors << " errors.";
-	  if (satisfied)
-	    cout << " All checks satisfied.\n";
-	  else
-	    cout << endl;
-
-	  // Update statistical information
-	  errors += newErrors;
-	  error_weight_hist[newErrors-1]++;
-	  wordErrors++;
-	  
+	  result_record rec;
+	  recordRun(rec, argc, argv, command_arguments, sweep, seed, numThreads);
+	  recordNumber(rec, "is_shift", channel.shift);
+	  recordNumber(rec, "is_scale", channel.scale);
+	  recordTotals(rec, totals, timer);
+	  recordProfile(rec, prof, totals, G.E);
+	  writeResultRecord(resultsFile, rec);
 	}
 
-      // Increment frame and bit counters:
-      totalWords++;
-      totalBits += H.N;
-      totalIterations += it;
-      
-      // ------------------------------------------------
-      // Give a status message every 100 frames
-      int reportInterval = round(100e3/H.N);
-      if ((totalWords % reportInterval) == 0)
+      ofstream of(logfilename.c_str(),ios::app);
+      char tab = '\t';
+      // The weighted sums are the plain error counts unless importance
+      // sampling is on:
+      of << SNR << tab << totals.weightedErrors/totalBits << tab << (double) totalIterations/totalWords << tab
+	 << totals.weightedWordErrors/totalWords << tab
+	 << totalBits << tab << totalWords << tab
+	 << num_iterations << tab << theta << tab;
+      if (P::addNoise || P::quantizeProbabilities)
+	of << noiseScale << tab; 
+      if (P::quantizeSamples)
+	of << NQ << tab;
+      if (P::thresholdAdaptation)
+	of << lambda << tab; 
+      if (P::weightSyndromes)
+	of << alpha << tab;
+      if (P::outputSmoothing)
 	{
-	  cout << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
-	       << ". Average iterations = " << (double) totalIterations/totalWords << ". Word error=" << wordErrors << ". Uncoded errors = " << uncodedErrors << ", uncBER=" << (double)uncodedErrors/totalBits
-	       << "\nError weights:\n";
-	  printHistogram(error_weight_hist);
+	  of << smoothingUsed << tab << (double) smoothingUsed/totalWords << tab;
+	  of << windowsize << tab; 
 	}
-      // ------------------------------------------------
+      if (P::saturateSamples)
+	of << Ymax << tab;
 
+      of << argv[1]
+	 << endl;
     }
-  /////////////////////////////////////////////////////////////////
-  // ------===== END OF MAIN TEST LOOP =====-------
-  /////////////////////////////////////////////////////////////////
-  
-  // ------------------------------------------------
-  // REPORT FINAL RESULTS:
-  cout << "\nFinal result: " << errors << " bit errs in " 
-       << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
-       << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
-       << (double)uncodedErrors/totalBits << endl;      
-
-  ofstream of(logfilename.c_str(),ios::app);
-  char tab = '\t';
-  of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
-     << (double) wordErrors/totalWords << tab
-     << totalBits << tab << totalWords << tab
-     << num_iterations << tab << theta << tab;
-#if defined(addNoise) || defined(quantizeProbabilities)
-  of << noiseScale << tab; 
-  #endif
-#ifdef quantizeSamples
-  of << NQ << tab;
-#endif
-  #ifdef thresholdAdaptation
-  of << lambda << tab; 
-  #endif
-  #ifdef weightSyndromes
-  of << alpha << tab;
-  #endif
-  #ifdef outputSmoothing
-  of << smoothingUsed << tab << (double) smoothingUsed/totalWords << tab;
-  of << windowsize << tab; 
-  #endif
-  #ifdef saturateSamples
-  of << Ymax << tab;
-  #endif
 
-  of << argv[1]
-     << endl;
+  closeCodewords(codewords);
+  closeTrace(trace);
+
   return 0;
 }
 /////////////////////////////////////////////////////////////////
@@ -462,6 +654,27 @@ int main(int argc, char * argv[])
 // adequate comments...
 //============================================================//
 
+void allocWorkspace(tanner_struct &G, gdbf_workspace & W)
+{
+  W.c.assign(G.N,1);
+  W.x.assign(G.N,1);
+  W.y.assign(G.N,1);
+  W.yq.assign(G.N,0.0);
+  W.r.assign(G.N,0);
+  W.d.assign(G.N,0);
+  W.dsum.assign(G.N,0);
+  W.perturbation.assign(G.N,0.0);
+  W.noiseSamples.assign(G.N,0.0);
+  W.gauss.assign(G.N,0.0);
+  W.thetas.assign(G.N,theta);
+  W.check_to_sym.assign(G.M,0);
+  W.F.S.assign(G.N,0);
+  W.F.listed.assign(G.N,0);
+  W.F.flips.reserve(G.N);
+  W.F.candidates.reserve(G.N);
+  W.acc.assign((G.M+63)/64,0);
+}
+
 void printHistogram(vector<int> & h)
 {
   for (int i=0; i<h.size(); i++)
@@ -471,7 +684,7 @@ void printHistogram(vector<int> & h)
     }
 }
 
-int countDecisionErrors(vector<int> d, vector<int> c)
+int countDecisionErrors(const vector<int> & d, const vector<int> & c)
 {
   int errs =0 ;
   for (int i=0; i<d.size(); i++)
@@ -514,119 +727,12 @@ void printErroneousMessages(vector<vector<int> > v)
     }
 }
 
-void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied)
-{
-  int msg;
-  satisfied = true;
-  for (int i=0; i<H.M; i++)
-    {
-      int prod = 1;
-      for (int j=0; j<H.num_mlist[i]; j++)
-	{
-	  int snode = H.mlist[i][j]-1;
-	  msg = sym_to_check[snode];
-	  prod *= msg;
-	}
-      if (prod < 0)
-	satisfied = false;
-      check_to_sym[i] = prod;	
-    }
-}
-
-void symNodeUpdates(alist_struct &H, vector<double> & thetas, double & lambda, int & mu, vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation)
-{
-  vector<double> E(H.N,0.0);
-  double Emin = INFINITY;
-  int mindx = -1;
-  double w = 1;
-  
-  for (int i=0; i<H.N; i++)
-    {
-      bool flip = false;
-      E[i] = d[i]*y[i];
-
-      #ifdef weightSyndromes
-      int dv = H.num_nlist[i];
-      w = alpha;//*Ymax/dv;
-      #endif
-
-      for (int j=0; j<H.num_nlist[i]; j++)
-	{
-	  int cnode = H.nlist[i][j]-1;
-	  int msg = check_to_sym[cnode];
-	  E[i] += w*msg;	  
-	}      
-      #ifdef addNoise
-      E[i] += perturbation[i]; //sigma*rann();
-      #endif
-      #ifdef quantizeProbabilities
-      double pcdf = normalCDF((-E[i]+thetas[i])/(sigma));
-      const int num_pr_levels = 8;
-      double pr_levels[num_pr_levels] = 
-	{
-             0,
-	     0.0625,
-	     0.125,
-	     0.25,
-	     0.34375,
-             0.4106,
-	     0.68359,
-	     1
-	 };
-      double min_dist=1;
-      int min_idx=0;
-      for (int j=0; j<num_pr_levels; j++) 
-	{
-          double tmp_dist = (pr_levels[j]-pcdf);
-          tmp_dist = tmp_dist*tmp_dist;
-          if (tmp_dist<min_dist) 
-	    {
-               min_dist = tmp_dist;
-               min_idx = j;
-            }
-        }
-      double rnum = ranu();
-      //printf("%d\t%f->%f\t%f\t",min_idx,pcdf,pr_levels[min_idx],rnum);
-      if (rnum < pr_levels[min_idx])    
-	{
-           flip = true;
-           d[i] = -d[i];
-	   //printf("flip.\n");
-        }
-      //else
-	      //printf("no flip.\n");
-      #else
-      if ((mu == 1) && (E[i] < thetas[i]))
-	{
-	  flip = true;
-	  d[i] = -d[i];      	    
-	}
-      if (mu == 0)	
-	if (E[i] < Emin)
-	  {
-	    flip = true;
-	    Emin = E[i];
-	    mindx = i;
-	  }
-      #endif	
-      #ifdef thresholdAdaptation
-      if (flip)
-	thetas[i] = thetas[i]; // /= lambda;
-      else
-	thetas[i] *= lambda;
-      #endif
-    }
-  if ((mu == 0)&&(mindx>=0))
-    d[mindx] = -d[mindx];
-}
-
-
-double evaluateObjectiveFunction(alist_struct &H, vector<int> & d, vector<double> & y, vector<int> & check_to_sym)
+double evaluateObjectiveFunction(tanner_struct &G, vector<int> & d, vector<double> & y, vector<int> & check_to_sym)
 {
   double f = 0;
-  for (int i=0; i<H.N; i++)
+  for (int i=0; i<G.N; i++)
     f += d[i]*y[i];
-  for (int j=0; j<H.M; j++)
+  for (int j=0; j<G.M; j++)
     f += check_to_sym[j];
 
   return f;
@@ -13,6 +13,7 @@
 #include <fstream>
 #include <cstdlib>
 #include <vector>
+#include <memory>
 #include <cmath>
 #include <sstream>
 #include <time.h>
@@ -20,7 +21,21 @@ using namespace std;
 
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
-#include "rand.h"
+#include "tanner.h"
+#include "rand_xoshiro.h"
+
+//--- Simulation support ---//
+#include "options.h"
+#include "montecarlo.h"
+#include "encoder.h"
+#include "codewords.h"
+#include "records.h"
+#include "instrument.h"
+#include "trace.h"
+#include "pipeline.h"
+#include "alloccount.h"
+#include "codekernel.h"
+#include "minsum_kernels.h"
 
 
 //============ COMPILER DIRECTIVES ==========//
@@ -30,31 +45,58 @@ using namespace std;
 // #define saturateSamples   // Clip unquantized samples at +-Ymax
 // #define normalizedMS      // Use normalized MS with parameter alpha
 // #define offsetMS          // Use offset MS with parameter delta
+// #define layered           // Use the layered (row-serial) schedule
 
 
 //============ GLOBAL PARAMETERS ============//
 int    num_iterations; // Maximum number of iterations for MLSBM (an additional phase of Gallager-A follows after this)
+double alpha = 1.0;    // Normalization factor (normalizedMS)
+double delta = 0.0;    // Offset (offsetMS)
+
+//============ WORKSPACE ====================//
+// Frame buffers and message memories for one worker, allocated once
+// per run so that the frame loop does no heap allocation. The
+// layered schedule keeps one posterior LLR per symbol in place of
+// the symbol-to-check messages.
+typedef struct {
+  vector<int>    c;             // Bipolar codeword (all +1 in this simulation)
+  vector<double> x;             // Modulated codeword (all +1 in this simulation)
+  vector<double> y;             // Channel samples
+  vector<double> yq;            // Quantized channel samples
+  vector<int>    d;             // Decoder outputs (+1 or -1 after decoding)
+  vector<int>    r;             // Received hard decision
+  vector<double> check_to_sym;  // Edge-indexed message memories
+  #ifdef layered
+  vector<double> L;
+  #else
+  vector<double> sym_to_check;
+  #endif
+  vector<int>    syndrome;      // Parity of the current decisions at each check
+  vector<uint64_t> acc;         // Encoder check-bit accumulator
+} minsum_workspace;
+
+void allocWorkspace(tanner_struct &G, minsum_workspace & W);
 
 //============ DECODING ALGORITHM PREDEFINES ===============//
-void checkNodeUpdates(alist_struct &H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym);
-void symNodeUpdates(alist_struct &H, vector<double> & y, vector<int> & d, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym);
+// The flooding node updates are in minsum_kernels.h.
 #ifdef quantizeSamples
 double quantize(double x, double Ymax, double Nq);
 #endif
 #ifdef normalizedMS
-void applyNormalization(alist_struct &H, vector<vector<double> > & check_to_sym, double alpha);
+void applyNormalization(tanner_struct &G, vector<double> & check_to_sym, double alpha);
 #endif
 #ifdef offsetMS
-void applyOffset(alist_struct &H, vector<vector<double> > & check_to_sym, double delta);
+void applyOffset(tanner_struct &G, vector<double> & check_to_sym, double delta);
+#endif
+#ifdef layered
+void layeredIteration(tanner_struct &G, vector<double> & L, vector<int> & d, vector<double> & check_to_sym, vector<int> & syndrome, bool & satisfied);
 #endif
 
 //============= SUPPORTING FUNCTION PREDEFINES =================//
-void setupSymMessages(alist_struct & H, vector<vector<double> > & sym_to_check);
-void setupCheckMessages(alist_struct & H, vector<vector<double> > & check_to_sym);
-void initializeSymMessages(alist_struct & H,  vector<vector<double> > & sym_to_check, vector<double> & y);
+void initializeSymMessages(tanner_struct & G,  vector<double> & sym_to_check, vector<double> & y);
 double sgn(double x);
 int find(int symNodes[], int len, int snode);
-int countDecisionErrors(vector<int> d, vector<int> c);
+int countDecisionErrors(const vector<int> & d, const vector<int> & c);
 
 //============= I/O PREDEFINES ============================//
 void printHistogram(vector<int> & h);
@@ -71,6 +113,19 @@ void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check
 ///////////////////////////////////////////////////////////////////////////////
 int main(int argc, char * argv[])
 {
+  // Optional flags, removed from argv before the positional arguments are counted:
+  int  numThreads = resolveThreads(extractLongOption(argc, argv, "threads", 1));
+  long seed       = extractLongOption(argc, argv, "seed", time(0));
+  stop_policy stopping = extractStopPolicy(argc, argv);
+  string      resultsFile = extractStringOption(argc, argv, "results", "");
+  bool        profiling = extractLongOption(argc, argv, "profile", 0);
+  decode_trace trace = openTrace(argc, argv, numThreads);
+  is_channel  channel  = extractISChannel(argc, argv);
+  stopping.weighted = isActive(channel);
+  int producers, ringDepth;
+  extractPipeline(argc, argv, numThreads, producers, ringDepth);
+  string      codeKernelChoice = extractStringOption(argc, argv, "code-kernel", "auto");
+
   vector<string> command_arguments(0);
   command_arguments.push_back("alist");
   command_arguments.push_back("R");
@@ -89,12 +144,12 @@ int main(int argc, char * argv[])
   command_arguments.push_back("delta");
   #endif
   command_arguments.push_back("logfilename");
-  command_arguments.push_back("[codeword filename]");
+  command_arguments.push_back("[codeword filename|random|gen file]");
 
   // Check arguments and print usage statements:
   if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
     {
-      cout << "Usage: " << argv[0];
+      cout << "Usage: " << argv[0] << " [--threads N] [--seed S]" << MC_STOP_USAGE << MC_IS_USAGE << MC_PIPE_USAGE << RESULTS_USAGE << PROFILE_USAGE << TRACE_USAGE << CODE_KERNEL_USAGE;
       for (int i=0; i<command_arguments.size(); i++)
 	cout << " " << command_arguments[i];
       cout << "\n";
@@ -103,232 +158,329 @@ int main(int argc, char * argv[])
 
   // Parse command arguments:
   int idx=1;
-  alist_struct H = loadFile(argv[idx++]);
+  tanner_struct G = loadTanner(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
   double R = atof(argv[idx++]);
   cout << " R = \t" << R << endl;
-  double SNR = atof(argv[idx++]);
-  cout << " SNR = \t" << SNR << endl;
+
+  // The flooding schedule uses the code-specialized kernels when one
+  // is linked for this code or given as a shared object:
+  const code_kernel * kernel = NULL;
+  #ifndef layered
+  kernel = selectCodeKernel(codeKernelChoice.c_str(), G);
+  if (kernel != NULL)
+    cout << " Using the code-specialized kernel for " << kernel->name << endl;
+  #endif
+  sweep_struct sweep;
+  double SNR;
+  addSweep(sweep, "SNR", argv[idx], SNR);
+  cout << " SNR = \t" << argv[idx++] << endl;
   num_iterations = atoi(argv[idx++]);
   cout << " T = \t" << num_iterations << endl;
   #ifdef saturateSamples
-  double Ymax = atof(argv[idx++]);
-  cout << "Applying sample clipping with Ymax = +/-" << Ymax << endl;
+  double Ymax;
+  addSweep(sweep, "Ymax", argv[idx], Ymax);
+  cout << "Applying sample clipping with Ymax = +/-" << argv[idx++] << endl;
   #endif
   #ifdef quantizeSamples
-  double Ymax = atof(argv[idx++]);
+  double Ymax;
+  addSweep(sweep, "Ymax", argv[idx++], Ymax);
   int Q = atoi(argv[idx++]);
   double Nq = pow(2.0,Q);
-  cout << "Applying sample quantization with Ymax = +/-" << Ymax << " on " << Q << " bits with " << Nq-1 << " non-zero levels." << endl;
+  cout << "Applying sample quantization with Ymax = +/-" << argv[idx-2] << " on " << Q << " bits with " << Nq-1 << " non-zero levels." << endl;
   #endif
   #ifdef normalizedMS
-  double alpha = atof(argv[idx++]);
-  cout << "Using normalization with alpha=" << alpha << endl;
+  addSweep(sweep, "alpha", argv[idx], alpha);
+  cout << "Using normalization with alpha=" << argv[idx++] << endl;
   #endif
   #ifdef offsetMS 
-  double delta = atof(argv[idx++]);
-  cout << "Using offset MS with delta=" << delta << endl;
+  addSweep(sweep, "delta", argv[idx], delta);
+  cout << "Using offset MS with delta=" << argv[idx++] << endl;
   #endif
 
   string logfilename(argv[idx++]);
   cout << " log = \t" << logfilename << endl;
 
-  ifstream codewordFile;
-  if (argc == command_arguments.size()+1)
+  codeword_stream codewords;
+  encoder_struct encoder;
+  bool useEncoder = (argc == command_arguments.size()+1) && isEncoderSource(argv[idx]);
+  if (useEncoder)
+    {
+      cout << "\nUsing random codewords from " << argv[idx] << endl;
+      encoder = openEncoder(argv[idx], G);
+    }
+  else if (argc == command_arguments.size()+1)
     {
       cout << "\nUsing codewords from " << argv[idx] << endl;
-      codewordFile.open(argv[idx],ios::in);
+      openCodewords(codewords, argv[idx], G.N);
     }
   else
     cout << "\nUsing all-zero sequence.\n";
 
-  // Compute channel parameters:
-  double N0 = pow(10.0,-SNR/10.0)/R;
-  double sigma = sqrt(N0/2.0);
-
-  // Get code parameters:
-  int dv = H.biggest_num_n;
-  int dc = H.biggest_num_m;
-
-  // Report initial status messages:
-  cout << "Simulating Min-Sum decoding on code with N=" << H.N << ", M=" << H.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
-  cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
-
-
-  // Declare top-level variables:
-  vector<int>    c(H.N,1);     // Bipolar codeword (all +1 in this simulation)
-  vector<double> x(H.N,1);     // Modulated codeword (all +1 in this simulation)
-  vector<double> y(x);          // Channel samples
-  vector<double> yq(H.N);       // Quantized channel samples
-  vector<int>    d(H.N,0);      // Decoder outputs (+1 or -1 after decoding)
-  vector<int>    r(H.N,0);      // Received hard decision
-
-  // Declare and initialize statistics variables:
-  long errors = 0;            // Total bit errors
-  long uncodedErrors = 0;     // Bit errors in r before decoding
-  long totalBits = 0;         // Total number of bits observed
-  long totalWords = 0;        // Total number of frames observed
-  long wordErrors = 0;        // Number of word errors observed
-  long totalIterations = 0;   // Total number of iterations accumulated over all frames.
-  vector<int> error_weight_hist(H.N,0);  // Vector to serve as histogram of error-pattern weights (1 up to H.N)
-
-  // Declare and initialize message memories:
-
-  vector<vector<double> > check_to_sym;
-  vector<vector<double> > sym_to_check;
-
-  // Allocate appropriate sizes for the message memories:                                                                                                                                                         
-  setupSymMessages(H,sym_to_check);
-  setupCheckMessages(H,check_to_sym);
-
-  /////////////////////////////////////////////////////////////////
-  // ------===== MAIN TEST LOOP =====-------
-  /////////////////////////////////////////////////////////////////
-  ran_seed(time(0)); //(134159);
-  int i,j;
-   while ((errors < 200) || (wordErrors < 40))
+  // Run every point of the parameter sweep in this process, keeping
+  // the graph and the workers' buffers:
+  vector<minsum_workspace> workspaces(numThreads);
+  for (long point=0; point<sweepPoints(sweep); point++)
     {
-      string s;
-      // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
-	{
-	  getline(codewordFile, s);
-	  if (codewordFile.eof())
+      sweepSelect(sweep, point);
+      rewindCodewords(codewords);
+
+      // Compute channel parameters:
+      double N0 = pow(10.0,-SNR/10.0)/R;
+      double sigma = sqrt(N0/2.0);
+
+      // Get code parameters:
+      int dv = G.biggest_dv;
+      int dc = G.biggest_dc;
+
+      // Report initial status messages:
+      #ifdef layered
+      cout << "Using the layered schedule." << endl;
+      #endif
+      cout << "Simulating Min-Sum decoding on code with N=" << G.N << ", M=" << G.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
+      cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
+
+
+      // Declare and initialize statistics variables:
+      mc_engine mc(numThreads, G.N, mcStopRule(stopping, 200, 40));
+      run_timer timer = startTimer();
+      profiler prof(profiling, numThreads);
+      bool useCodewordFile = (codewords.frames > 0);
+      cout << "Running " << numThreads << " worker thread(s) with seed " << seed << endl;
+
+      // With --producers, the channel runs on its own threads:
+      channel_source source = {G.N, sigma, channel, useEncoder ? &encoder : NULL, useCodewordFile ? &codewords : NULL};
+      unique_ptr<frame_pipeline> pipe;
+      if (producers > 0)
+	pipe.reset(new frame_pipeline(mc, source, producers, ringDepth, seed));
+
+      // Set up each point's workspaces. After the first point this
+      // reuses their storage and only resets the contents:
+      for (int t=0; t<numThreads; t++)
+	allocWorkspace(G, workspaces[t]);
+
+      /////////////////////////////////////////////////////////////////
+      // ------===== MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+      // Each worker owns a workspace and a random stream, and decodes
+      // frames until the engine's stopping rule holds.
+      auto decodeFrames = [&](int tid)
+      {
+	minsum_workspace & W = workspaces[tid];
+	vector<int>    & c  = W.c;
+	vector<double> & x  = W.x;
+	vector<double> & y  = W.y;
+	vector<double> & yq = W.yq;
+	vector<int>    & d  = W.d;
+	vector<int>    & r  = W.r;
+	vector<double> & check_to_sym = W.check_to_sym;
+	#ifdef layered
+	vector<double> & L = W.L;
+	#else
+	vector<double> & sym_to_check = W.sym_to_check;
+	#endif
+	vector<int>    & syndrome = W.syndrome;
+
+	allocation_probe probe;
+	ran_stream(seed, tid);
+	stage_clock stages(prof, tid);
+	int i;
+	while (!mc.stop.load())
 	  {
-	    codewordFile.clear();
-	    codewordFile.seekg(0);
-	    getline(codewordFile, s);
-	  }
-	  for (i=0; i<H.N; i++)
-	  {	    
-	    if (s[i] == '1')	      
-	      c[i] = -1;
-	    else if (s[i] == '0')
-	      c[i] = +1;
+	    double logWeight = 0.0;
+	    if (pipe)
+	      {
+		// Take the next frame from the producers, trading buffers:
+		channel_frame * F = pipelineAcquire(*pipe, tid);
+		if (F == NULL)
+		  break;
+		c.swap(F->c);
+		y.swap(F->y);
+		logWeight = F->logWeight;
+		pipelineRelease(*pipe, tid);
+	      }
 	    else
-	      cout << "Got an invalid symbol at index " << i << endl;
-	    x[i] = c[i];
+	      {
+		// Draw a fresh codeword, or load one from the codeword file:
+		if (useEncoder)
+		  {
+		    randomCodeword(encoder, ran_state, &W.acc[0], c);
+		    for (i=0; i<G.N; i++)
+		      x[i] = c[i];
+		  }
+		else if (useCodewordFile)
+		  {
+		    const uint8_t * row = nextCodeword(codewords);
+		    for (i=0; i<G.N; i++)
+		      {
+			c[i] = codewordBit(row, i) ? -1 : +1;
+			x[i] = c[i];
+		      }
+		  }
+		// Emulate AWGN transmission
+		for (i=0; i<G.N; i++)
+		  y[i] = x[i]*(1.0+isNoise(channel, sigma, rann(), logWeight));
+	      }
+
+	    int uncodedErrors = 0;
+	    for (i=0; i<G.N; i++)
+	      {
+		#ifdef quantizeSamples
+		yq[i] = quantize(y[i],Ymax,Nq);
+		#else
+		yq[i] = y[i];
+		#endif
+
+		#ifdef saturateSamples
+		if (yq[i] > Ymax)
+		  yq[i] = Ymax;
+		if (yq[i] < -Ymax)
+		  yq[i] = -Ymax;
+		#endif
+
+		if (yq[i] > 0)
+		  r[i] = 1;
+		else
+		  r[i] = -1;
+		d[i] = r[i];
+		if (r[i]*c[i] < 0)
+		  uncodedErrors++;
+	      }
+
+	    #ifdef layered
+	    for (i=0; i<G.N; i++)
+	      L[i] = yq[i];
+	    for (int e=0; e<G.E; e++)
+	      check_to_sym[e] = 0.0;
+	    #else
+	    initializeSymMessages(G, sym_to_check, yq);
+	    #endif
+	    stages.lap(STAGE_CHANNEL);
+
+
+	    // Perform decoding iterations:
+	    bool satisfied = false;
+	    int it;
+
+
+	    for (it=0; it<num_iterations; it++)
+	      {
+		#ifdef layered
+		// Process the checks one at a time, updating the posteriors in place:
+		layeredIteration(G, L, d, check_to_sym, syndrome, satisfied);
+		stages.lap(STAGE_CHECK);
+		#else
+		// First update the check nodes:
+		if (kernel != NULL)
+		  kernel->checkNodes(&sym_to_check[0], &check_to_sym[0]);
+		else
+		  minsumCheckNodeUpdates(G,sym_to_check,check_to_sym);
+
+		// Apply offset or normalization operations:
+		#ifdef normalizedMS
+		applyNormalization(G,check_to_sym,alpha);
+		#endif
+
+		#ifdef offsetMS
+		applyOffset(G,check_to_sym,delta);
+		#endif
+		stages.lap(STAGE_CHECK);
+
+		// Then perform Symbol node updates:
+		if (kernel != NULL)
+		  satisfied = (kernel->symNodes(&yq[0], &d[0], &sym_to_check[0], &check_to_sym[0], &syndrome[0]) == 0);
+		else
+		  minsumSymNodeUpdates(G, yq, d, sym_to_check, check_to_sym, syndrome, satisfied);
+		stages.lap(STAGE_SYMBOL);
+		#endif
+
+		traceIteration(trace, G, 0, it, bipolarBits(d));
+
+		// Stop once the decisions satisfy every check:
+		if (satisfied)
+		  {
+		    it++;
+		    break;
+		  }
+	      }
+
+	    // --- End of iteration --------------------------------------
+	    // -------------------------------------------------------------
+
+
+	    // Count remaining errors after decoding, and update the
+	    // statistics and error-weight histogram:
+	    traceFrame(trace, G, 0, it, bipolarBits(d));
+	    traceNext(trace, 1);
+	    int newErrors = countDecisionErrors(d,c);
+	    mcRecordFrame(mc, tid, newErrors, uncodedErrors, it, G.N, satisfied ? " All checks satisfied." : "",
+			  isFrameWeight(channel, logWeight, G.N));
+	    stages.lap(STAGE_IO);
+	    probe.endFrame();
 	  }
-	}
-      // Emulate AWGN transmission      
-      for (i=0; i<H.N; i++)
-	{
-	  y[i] = x[i]*(1.0+sigma*rann());
-
-	  #ifdef quantizeSamples
-	  yq[i] = quantize(y[i],Ymax,Nq);
-	  #else
-	  yq[i] = y[i];
-	  #endif
-
-	  #ifdef saturateSamples
-	  if (yq[i] > Ymax)
-	    yq[i] = Ymax;
-	  if (yq[i] < -Ymax)
-	    yq[i] = -Ymax;
-	  #endif
-
-	  if (yq[i] > 0)
-	    r[i] = 1;
-	  else
-	    r[i] = -1;
-	  d[i] = r[i];
-	  if (r[i]*c[i] < 0)
-	    uncodedErrors++;
-	}
+      };
+
+      // Give a status message every 5 frames
+      mcRun(mc, decodeFrames, 5);
+      if (pipe)
+	pipelineStop(*pipe);
+      /////////////////////////////////////////////////////////////////
+      // ------===== END OF MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+
+      frame_totals totals = mcTotals(mc);
+      long errors          = totals.errors;
+      long uncodedErrors   = totals.uncodedErrors;
+      long totalBits       = totals.totalBits;
+      long totalWords      = totals.totalWords;
+      long totalIterations = totals.totalIterations;
 
-      initializeSymMessages(H, sym_to_check, yq);
-
-
-      // Perform decoding iterations:      
-      int it;
-
-      
-      for (it=0; it<num_iterations; it++)
-	{      
-	  // First update the check nodes:
-	  checkNodeUpdates(H,sym_to_check,check_to_sym);
-	  
-	  // Apply offset or normalization operations:
-	  #ifdef normalizedMS
-	  applyNormalization(H,check_to_sym,alpha);
-	  #endif
-
-	  #ifdef offsetMS
-	  applyOffset(H,check_to_sym,delta);
-	  #endif
-
-	  // Then perform Symbol node updates:
-	  symNodeUpdates(H, yq, d, sym_to_check, check_to_sym);	  
-	}
-      
-      // --- End of iteration --------------------------------------
-      // -------------------------------------------------------------
-
-
-      // Count remaining errors after decoding:
-      int newErrors = countDecisionErrors(d,c);
-
-      if (newErrors > 0)
-	{
-	  // Report the frame error to the console:
-	  cout << "Ferr with " << newErrors << " errors.";
-	  cout << endl;
-
-	  // Update statistical information
-	  errors += newErrors;
-	  error_weight_hist[newErrors-1]++;
-	  wordErrors++;
-	  
-	}
-
-      // Increment frame and bit counters:
-      totalWords++;
-      totalBits += H.N;
-      totalIterations += it;
-      
       // ------------------------------------------------
-      // Give a status message every 100 frames
-      if ((totalWords % 5) == 0)
+      // REPORT FINAL RESULTS:
+      cout << "\nFinal result: " << errors << " bit errs in " 
+	   << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
+	   << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
+	   << (double)uncodedErrors/totalBits << endl;      
+      mcPrintInterval(stopping, totals);
+      profileReport(prof, totals, G.E);
+      reportAllocations();
+
+      if (!resultsFile.empty())
 	{
-	  cout << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
-	       << ". Average iterations = " << (double) totalIterations/totalWords << ". Word error=" << wordErrors << ". Uncoded errors = " << uncodedErrors << ", uncBER=" << (double)uncodedErrors/totalBits
-	       << "\nError weights:\n";
-	  printHistogram(error_weight_hist);
+	  result_record rec;
+	  recordRun(rec, argc, argv, command_arguments, sweep, seed, numThreads);
+	  recordNumber(rec, "is_shift", channel.shift);
+	  recordNumber(rec, "is_scale", channel.scale);
+	  recordString(rec, "code_kernel", (kernel != NULL) ? kernel->name : "generic");
+	  recordTotals(rec, totals, timer);
+	  recordProfile(rec, prof, totals, G.E);
+	  writeResultRecord(resultsFile, rec);
 	}
-      // ------------------------------------------------
 
+      ofstream of(logfilename.c_str(),ios::app);
+      char tab = '\t';
+      // The weighted sums are the plain error counts unless importance
+      // sampling is on:
+      of << SNR << tab << totals.weightedErrors/totalBits << tab << (double) totalIterations/totalWords << tab
+	 << totals.weightedWordErrors/totalWords << tab
+	 << num_iterations << tab;
+      #if defined(saturateSamples) || defined(quantizeSamples)
+      of << Ymax << tab;
+      #endif
+      #ifdef normalizedMS
+      of << alpha << tab;
+      #endif
+      #ifdef offsetMS
+      of << delta << tab;
+      #endif
+      of << argv[1]
+	 << endl;
+      of.close();
     }
-  /////////////////////////////////////////////////////////////////
-  // ------===== END OF MAIN TEST LOOP =====-------
-  /////////////////////////////////////////////////////////////////
-  
-  // ------------------------------------------------
-  // REPORT FINAL RESULTS:
-  cout << "\nFinal result: " << errors << " bit errs in " 
-       << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords 
-       << ". Uncoded errors = " << uncodedErrors << ", uncBER=" 
-       << (double)uncodedErrors/totalBits << endl;      
-
-  ofstream of(logfilename.c_str(),ios::app);
-  char tab = '\t';
-  of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
-     << (double) wordErrors/totalWords << tab
-     << num_iterations << tab;
-  #if defined(saturateSamples) || defined(quantizeSamples)
-  of << Ymax << tab;
-  #endif
-  #ifdef normalizedMS
-  of << alpha << tab;
-  #endif
-  #ifdef offsetMS
-  of << delta << tab;
-  #endif
-  of << argv[1]
-     << endl;
-  of.close();
 
-  freeAlist(H);
+  closeCodewords(codewords);
+  freeTanner(G);
+  closeTrace(trace);
 
   return 0;
 }
@@ -342,31 +494,30 @@ int main(int argc, char * argv[])
 // adequate comments...
 //============================================================//
 
-void  setupSymMessages(alist_struct & H, vector<vector<double> > & sym_to_check)
-{
-  for (int i=0; i<H.N; i++)
-    {
-      vector<double> initial_msgs(H.num_nlist[i],0.0);
-      sym_to_check.push_back(initial_msgs);
-    }
-}
-
-void setupCheckMessages(alist_struct & H,vector<vector<double> > & check_to_sym)
+void allocWorkspace(tanner_struct &G, minsum_workspace & W)
 {
-  for (int i=0; i<H.M; i++)
-    {
-      vector<double> initial_msgs(H.num_mlist[i],0.0);
-      check_to_sym.push_back(initial_msgs);
-    }
+  W.c.assign(G.N,1);
+  W.x.assign(G.N,1);
+  W.y.assign(G.N,1);
+  W.yq.assign(G.N,0.0);
+  W.d.assign(G.N,0);
+  W.r.assign(G.N,0);
+  W.check_to_sym.assign(G.E,0.0);
+  #ifdef layered
+  W.L.assign(G.N,0.0);
+  #else
+  W.sym_to_check.assign(G.E,0.0);
+  #endif
+  W.syndrome.assign(G.M,0);
+  W.acc.assign((G.M+63)/64,0);
 }
 
-
-void initializeSymMessages(alist_struct & H,  vector<vector<double> > & sym_to_check, vector<double> & y)
+void initializeSymMessages(tanner_struct & G,  vector<double> & sym_to_check, vector<double> & y)
 {
-  int i,j;
-  for (i=0; i<H.N; i++)
-    for (j=0; j<H.num_nlist[i]; j++)
-      sym_to_check[i][j] = y[i];
+  int i,k;
+  for (i=0; i<G.N; i++)
+    for (k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+      sym_to_check[k] = y[i];
 }
 
 
@@ -379,7 +530,7 @@ void printHistogram(vector<int> & h)
     }
 }
 
-int countDecisionErrors(vector<int> d, vector<int> c)
+int countDecisionErrors(const vector<int> & d, const vector<int> & c)
 {
   int errs =0 ;
   for (int i=0; i<d.size(); i++)
@@ -407,73 +558,80 @@ void printErroneousMessages(vector<vector<int> > v)
     }
 }
 
-void checkNodeUpdates(alist_struct &H, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym)
+#ifdef layered
+// One layered iteration. For each check in turn, the incoming
+// messages are formed from the posteriors as q = L - R, the check's
+// outgoing messages R are recomputed by min-sum (with the offset or
+// normalization applied per check), and the posteriors of its
+// symbols become q + R. The decisions and syndrome are then taken
+// from the posteriors, as in minsumSymNodeUpdates().
+void layeredIteration(tanner_struct &G, vector<double> & L, vector<int> & d, vector<double> & check_to_sym, vector<int> & syndrome, bool & satisfied)
 {
   double minMag;
   double minMag2;
-  double minIdx;
-  double msg;
+  int minIdx;
+  double q;
   double prod;
-  for (int i=0; i<H.M; i++)
+  for (int j=0; j<G.M; j++)
     {
       minMag = INFINITY;
       minMag2 = INFINITY;
+      minIdx = -1;
       prod = 1.0;
-      for (int j=0; j<H.num_mlist[i]; j++)
+      for (int e=G.check_start[j]; e<G.check_start[j+1]; e++)
 	{
-	  int snode = H.mlist[i][j]-1;
-	  int midx = find(H.nlist[snode], H.num_nlist[snode], i);
-	  msg = sym_to_check[snode][midx];
-	  prod *= sgn(msg);
-	  if (abs(msg) <= minMag)
+	  q = L[G.check_sym[e]] - check_to_sym[e];
+	  prod *= sgn(q);
+	  if (abs(q) <= minMag)
 	    {
 	      minMag2 = minMag;
-	      minMag = abs(msg);
-	      minIdx = j;
+	      minMag = abs(q);
+	      minIdx = e;
 	    }
-	  else if (abs(msg) < minMag2)
+	  else if (abs(q) < minMag2)
 	    {
-	      minMag2 = abs(msg);
+	      minMag2 = abs(q);
 	    }
 	}
-      for (int j=0; j<H.num_mlist[i]; j++)
+      for (int e=G.check_start[j]; e<G.check_start[j+1]; e++)
 	{
-	  int snode = H.mlist[i][j]-1;
-	  int midx = find(H.nlist[snode], H.num_nlist[snode], i);
-	  msg = sym_to_check[snode][midx];
-	  if (j == minIdx)
-	    check_to_sym[i][j] = prod*minMag2*sgn(msg);	
-	  else
-	    check_to_sym[i][j] = prod*minMag*sgn(msg);
+	  int i = G.check_sym[e];
+	  q = L[i] - check_to_sym[e];
+	  double mag = (e == minIdx) ? minMag2 : minMag;
+	  #ifdef normalizedMS
+	  mag /= alpha;
+	  #endif
+	  #ifdef offsetMS
+	  mag -= delta;
+	  if (mag < 0)
+	    mag = 0;
+	  #endif
+	  check_to_sym[e] = prod*sgn(q)*mag;
+	  L[i] = q + check_to_sym[e];
 	}
     }
-}
 
-void symNodeUpdates(alist_struct &H, vector<double> & y, vector<int> & d, vector<vector<double> > & sym_to_check, vector<vector<double> > & check_to_sym)
-{ 
-  for (int i=0; i<H.N; i++)
+  int unsatisfied = 0;
+  for (int j=0; j<G.M; j++)
+    syndrome[j] = 0;
+  for (int i=0; i<G.N; i++)
     {
-      double sum = y[i];
-      for (int j=0; j<H.num_nlist[i]; j++)
-	{
-	  int cnode = H.nlist[i][j]-1;
-	  int midx = find(H.mlist[cnode],H.num_mlist[cnode],i);
-	  double msg = check_to_sym[cnode][midx];
-	  sum += msg;
-	}      
-      for (int j=0; j<H.num_nlist[i]; j++) 
-	{
-	  int cnode = H.nlist[i][j]-1;  
-	  int midx = find(H.mlist[cnode],H.num_mlist[cnode],i); 
-	  double msg = check_to_sym[cnode][midx]; 
-	  sym_to_check[i][j] = sum - msg;
-	}
-      if (sum > 0)
+      if (L[i] > 0)
 	d[i] = 1;
       else
-	d[i] = -1;	
+	{
+	  d[i] = -1;
+	  for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
+	    {
+	      int j = G.sym_check[k];
+	      unsatisfied += 1 - 2*syndrome[j];
+	      syndrome[j] ^= 1;
+	    }
+	}
     }
+  satisfied = (unsatisfied == 0);
 }
+#endif
 
 
 #ifdef quantizeSamples
@@ -491,27 +649,25 @@ double quantize(double x, double Ymax, double Nq)
 
 
 #ifdef normalizedMS
-void applyNormalization(alist_struct &H, vector<vector<double> > & check_to_sym, double alpha)
+void applyNormalization(tanner_struct &G, vector<double> & check_to_sym, double alpha)
 {
-  for (int i=0; i<H.M; i++)
-      for (int j=0; j<H.num_mlist[i]; j++)
-	check_to_sym[i][j] /= alpha;
+  for (int e=0; e<G.E; e++)
+    check_to_sym[e] /= alpha;
 }
 #endif
 
 #ifdef offsetMS
-void applyOffset(alist_struct &H, vector<vector<double> > & check_to_sym, double delta)
+void applyOffset(tanner_struct &G, vector<double> & check_to_sym, double delta)
 {
-  for (int i=0; i<H.M; i++)
-      for (int j=0; j<H.num_mlist[i]; j++)
-	{
-	  double msg = check_to_sym[i][j];
-	  double mag = abs(msg) - delta;
-	  if (mag > 0)
-	    check_to_sym[i][j] = sgn(msg)*mag;
-	  else
-	    check_to_sym[i][j] = 0;
-	}
+  for (int e=0; e<G.E; e++)
+    {
+      double msg = check_to_sym[e];
+      double mag = abs(msg) - delta;
+      if (mag > 0)
+	check_to_sym[e] = sgn(msg)*mag;
+      else
+	check_to_sym[e] = 0;
+    }
 }
 #endif
 
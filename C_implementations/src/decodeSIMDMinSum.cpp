@@ -0,0 +1,406 @@
+//==============================================================
+// decodeSIMDMinSum.cpp
+//
+// Fixed-point min-sum decoder built on the frame-parallel
+// SIMD engine in simdms.h. Channel samples are quantized as in
+// decodeMinSum.cpp's quantizeSamples mode and stored as int8
+// values in units of half a quantization step, so the channel
+// values span +-(2^Q-1). Each worker decodes 64 frames at
+// once; a lane's decisions are frozen as soon as its checks
+// are all satisfied, and the batch ends when every lane has
+// stopped or T iterations have run.
+//
+// The offset (-D offsetMS) is rounded to whole half-steps and
+// the normalization (-D normalizedMS) is applied as a multiply
+// by round(16/alpha)/16, so results are close to, but not
+// identical with, the double-precision decoders.
+//==============================================================
+
+
+//--- Standard C++ headers ---//
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <vector>
+#include <cmath>
+#include <sstream>
+#include <time.h>
+using namespace std;
+
+//--- Borrowed from Radford Neal's source code ---//
+#include "alist.h"
+#include "tanner.h"
+#include "rand_xoshiro.h"
+
+//--- Simulation support ---//
+#include "options.h"
+#include "montecarlo.h"
+#include "encoder.h"
+#include "codewords.h"
+#include "records.h"
+#include "trace.h"
+#include "simdms.h"
+#include "alloccount.h"
+
+
+//============ COMPILER DIRECTIVES ==========//
+// These are set in the Makefile but also
+// documented here:
+// #define normalizedMS      // Use normalized MS with parameter alpha
+// #define offsetMS          // Use offset MS with parameter delta
+
+
+//============ GLOBAL PARAMETERS ============//
+int    num_iterations; // Maximum number of iterations
+
+//============ WORKSPACE ====================//
+// Frame rows and counters for one worker, allocated once per run so
+// that the frame loop does no heap allocation:
+typedef struct {
+  simdms_frames  F;
+  vector<int8_t> c;              // Codeword rows, -1 where the bipolar symbol is -1
+  vector<int>    uncodedErrors;  // Per lane
+  vector<int>    newErrors;
+  vector<int>    iterations;
+  vector<uint64_t> acc;          // Encoder check-bit accumulator
+  vector<int>    cw;             // One encoded codeword, bipolar
+} simd_workspace;
+
+void allocWorkspace(tanner_struct &G, simd_workspace & W);
+
+//============= SUPPORTING FUNCTION PREDEFINES =================//
+double quantize(double x, double Ymax, double Nq);
+double sgn(double x);
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// -----===== MAIN BODY ======------
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char * argv[])
+{
+  // Optional flags, removed from argv before the positional arguments are counted:
+  int    numThreads = resolveThreads(extractLongOption(argc, argv, "threads", 1));
+  long   seed       = extractLongOption(argc, argv, "seed", time(0));
+  stop_policy stopping = extractStopPolicy(argc, argv);
+  string      resultsFile = extractStringOption(argc, argv, "results", "");
+  string isa        = extractStringOption(argc, argv, "isa", "");
+  decode_trace trace = openTrace(argc, argv, numThreads);
+
+  vector<string> command_arguments(0);
+  command_arguments.push_back("alist");
+  command_arguments.push_back("R");
+  command_arguments.push_back("SNR");
+  command_arguments.push_back("T");
+  command_arguments.push_back("Ymax");
+  command_arguments.push_back("Q");
+  #ifdef normalizedMS
+  command_arguments.push_back("alpha");
+  #endif
+  #ifdef offsetMS
+  command_arguments.push_back("delta");
+  #endif
+  command_arguments.push_back("logfilename");
+  command_arguments.push_back("[codeword filename|random|gen file]");
+
+  // Check arguments and print usage statements:
+  if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
+    {
+      cout << "Usage: " << argv[0] << " [--threads N] [--seed S] [--isa avx512|avx2|sse41|generic]" << MC_STOP_USAGE << RESULTS_USAGE << TRACE_USAGE;
+      for (int i=0; i<command_arguments.size(); i++)
+	cout << " " << command_arguments[i];
+      cout << "\n";
+      return 0;
+    }
+
+  // Parse command arguments:
+  int idx=1;
+  tanner_struct G = loadTanner(argv[idx++]);
+  cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
+  double R = atof(argv[idx++]);
+  cout << " R = \t" << R << endl;
+  sweep_struct sweep;
+  double SNR;
+  addSweep(sweep, "SNR", argv[idx], SNR);
+  cout << " SNR = \t" << argv[idx++] << endl;
+  num_iterations = atoi(argv[idx++]);
+  cout << " T = \t" << num_iterations << endl;
+  double Ymax;
+  addSweep(sweep, "Ymax", argv[idx++], Ymax);
+  int Q = atoi(argv[idx++]);
+  double Nq = pow(2.0,Q);
+  cout << "Applying sample quantization with Ymax = +/-" << argv[idx-2] << " on " << Q << " bits with " << Nq-1 << " non-zero levels." << endl;
+  if (Q > 7)
+    {
+      cout << "Q must be at most 7 for int8 messages." << endl;
+      return 1;
+    }
+
+  #ifdef normalizedMS
+  double alpha;
+  addSweep(sweep, "alpha", argv[idx], alpha);
+  cout << "Using normalization with alpha=" << argv[idx++] << endl;
+  #endif
+  #ifdef offsetMS
+  double delta;
+  addSweep(sweep, "delta", argv[idx], delta);
+  cout << "Using offset MS with delta=" << argv[idx++] << endl;
+  #endif
+
+  string logfilename(argv[idx++]);
+  cout << " log = \t" << logfilename << endl;
+
+  codeword_stream codewords;
+  encoder_struct encoder;
+  bool useEncoder = (argc == command_arguments.size()+1) && isEncoderSource(argv[idx]);
+  if (useEncoder)
+    {
+      cout << "\nUsing random codewords from " << argv[idx] << endl;
+      encoder = openEncoder(argv[idx], G);
+    }
+  else if (argc == command_arguments.size()+1)
+    {
+      cout << "\nUsing codewords from " << argv[idx] << endl;
+      openCodewords(codewords, argv[idx], G.N);
+    }
+  else
+    cout << "\nUsing all-zero sequence.\n";
+
+  simdms_kernel K = selectSimdKernel(isa.c_str());
+  cout << "Using the " << K.name << " kernel on " << SIMDMS_LANES << " frames at a time." << endl;
+
+  // Run every point of the parameter sweep in this process, keeping
+  // the graph and the workers' buffers:
+  vector<simd_workspace> workspaces(numThreads);
+  for (long point=0; point<sweepPoints(sweep); point++)
+    {
+      sweepSelect(sweep, point);
+      rewindCodewords(codewords);
+
+      // Fixed-point unit is half a quantization step:
+      double unit = Ymax/(Nq-1);
+      simdms_params P;
+      P.offset = 0;
+      P.scale = 16;
+      #ifdef normalizedMS
+      P.scale = (int) lround(16.0/alpha);
+      cout << "Applying alpha=" << alpha << " as " << P.scale << "/16" << endl;
+      #endif
+      #ifdef offsetMS
+      P.offset = (int) lround(delta/unit);
+      cout << "Applying delta=" << delta << " as " << P.offset << " half-steps" << endl;
+      #endif
+
+      // Compute channel parameters:
+      double N0 = pow(10.0,-SNR/10.0)/R;
+      double sigma = sqrt(N0/2.0);
+
+      // Get code parameters:
+      int dv = G.biggest_dv;
+      int dc = G.biggest_dc;
+
+      // Report initial status messages:
+      cout << "Simulating fixed-point Min-Sum decoding on code with N=" << G.N << ", M=" << G.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
+      cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
+
+
+      // Declare and initialize statistics variables:
+      mc_engine mc(numThreads, G.N, mcStopRule(stopping, 200, 40));
+      run_timer timer = startTimer();
+      bool useCodewordFile = (codewords.frames > 0);
+      cout << "Running " << numThreads << " worker thread(s) with seed " << seed << endl;
+
+      // Set up each point's workspaces. After the first point this
+      // reuses their storage and only resets the contents:
+      for (int t=0; t<numThreads; t++)
+	allocWorkspace(G, workspaces[t]);
+
+      /////////////////////////////////////////////////////////////////
+      // ------===== MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+      // Each worker decodes batches of SIMDMS_LANES frames with its own
+      // workspace and random stream until the stopping rule holds.
+      auto decodeFrames = [&](int tid)
+      {
+	const int L = SIMDMS_LANES;
+	simd_workspace & W = workspaces[tid];
+	simdms_frames  & F = W.F;
+	vector<int8_t> & c = W.c;
+	vector<int>    & uncodedErrors = W.uncodedErrors;
+	vector<int>    & newErrors = W.newErrors;
+	vector<int>    & iterations = W.iterations;
+
+	allocation_probe probe;
+	ran_stream(seed, tid);
+	int i, l;
+	while (!mc.stop.load())
+	  {
+	    // Load the codewords and emulate AWGN transmission, one lane at a time:
+	    for (l=0; l<L; l++)
+	      {
+		if (useEncoder)
+		  {
+		    randomCodeword(encoder, ran_state, &W.acc[0], W.cw);
+		    for (i=0; i<G.N; i++)
+		      c[i*L+l] = (W.cw[i] < 0) ? -1 : 0;
+		  }
+		else if (useCodewordFile)
+		  {
+		    const uint8_t * row = nextCodeword(codewords);
+		    for (i=0; i<G.N; i++)
+		      c[i*L+l] = codewordBit(row, i) ? -1 : 0;
+		  }
+		uncodedErrors[l] = 0;
+		for (i=0; i<G.N; i++)
+		  {
+		    double x = c[i*L+l] ? -1.0 : 1.0;
+		    double y = x*(1.0+sigma*rann());
+		    long q = lround(quantize(y,Ymax,Nq)/unit);
+		    F.ch[i*L+l] = (int8_t) q;
+		    if ((q > 0) != (x > 0))
+		      uncodedErrors[l]++;
+		  }
+	      }
+
+	    initSimdFrames(G, F);
+
+	    // Perform decoding iterations, freezing each lane once its
+	    // decisions satisfy every check:
+	    uint64_t stopped = 0;
+	    for (l=0; l<L; l++)
+	      iterations[l] = num_iterations;
+	    for (int it=0; it<num_iterations; it++)
+	      {
+		uint64_t unsatisfied = K.iterate(G, F, P);
+		if (trace.file != NULL)
+		  for (uint64_t m = ~stopped; m; m &= m-1)
+		    {
+		      l = __builtin_ctzll(m);
+		      traceIteration(trace, G, l, it, [&F, l](int i) { return F.d[i*SIMDMS_LANES+l] != 0; });
+		    }
+		for (uint64_t m = ~unsatisfied & ~stopped; m; m &= m-1)
+		  {
+		    l = __builtin_ctzll(m);
+		    iterations[l] = it+1;
+		    F.done[l] = -1;
+		  }
+		stopped |= ~unsatisfied;
+		if (stopped == ~(uint64_t)0)
+		  break;
+	      }
+
+	    // Count remaining errors in each lane, and update the
+	    // statistics and error-weight histogram:
+	    for (l=0; l<L; l++)
+	      newErrors[l] = 0;
+	    for (i=0; i<G.N; i++)
+	      for (l=0; l<L; l++)
+		if (F.d[i*L+l] != c[i*L+l])
+		  newErrors[l]++;
+	    if (trace.file != NULL)
+	      {
+		for (l=0; l<L; l++)
+		  traceFrame(trace, G, l, iterations[l], [&F, l](int i) { return F.d[i*SIMDMS_LANES+l] != 0; });
+		traceNext(trace, L);
+	      }
+	    for (l=0; l<L; l++)
+	      mcRecordFrame(mc, tid, newErrors[l], uncodedErrors[l], iterations[l], G.N, ((stopped >> l) & 1) ? " All checks satisfied." : "");
+	    probe.endFrame();
+	  }
+      };
+
+      // Give a status message every 5 batches
+      mcRun(mc, decodeFrames, 5*SIMDMS_LANES);
+      /////////////////////////////////////////////////////////////////
+      // ------===== END OF MAIN TEST LOOP =====-------
+      /////////////////////////////////////////////////////////////////
+
+      frame_totals totals = mcTotals(mc);
+      long errors          = totals.errors;
+      long uncodedErrors   = totals.uncodedErrors;
+      long totalBits       = totals.totalBits;
+      long totalWords      = totals.totalWords;
+      long wordErrors      = totals.wordErrors;
+      long totalIterations = totals.totalIterations;
+
+      // ------------------------------------------------
+      // REPORT FINAL RESULTS:
+      cout << "\nFinal result: " << errors << " bit errs in "
+	   << totalWords << " words, BER=" << (double)errors/totalBits << ". Average iterations = " << (double) totalIterations/totalWords
+	   << ". Uncoded errors = " << uncodedErrors << ", uncBER="
+	   << (double)uncodedErrors/totalBits << endl;
+      mcPrintInterval(stopping, totals);
+      reportAllocations();
+
+      if (!resultsFile.empty())
+	{
+	  result_record rec;
+	  recordRun(rec, argc, argv, command_arguments, sweep, seed, numThreads);
+	  recordString(rec, "isa", K.name);
+	  recordTotals(rec, totals, timer);
+	  writeResultRecord(resultsFile, rec);
+	}
+
+      ofstream of(logfilename.c_str(),ios::app);
+      char tab = '\t';
+      of << SNR << tab << (double)errors/totalBits << tab << (double) totalIterations/totalWords << tab
+	 << (double) wordErrors/totalWords << tab
+	 << num_iterations << tab;
+      of << Ymax << tab;
+      #ifdef normalizedMS
+      of << alpha << tab;
+      #endif
+      #ifdef offsetMS
+      of << delta << tab;
+      #endif
+      of << argv[1]
+	 << endl;
+      of.close();
+
+      for (int t=0; t<numThreads; t++)
+	freeSimdFrames(workspaces[t].F);
+    }
+
+  closeCodewords(codewords);
+  freeTanner(G);
+  closeTrace(trace);
+
+  return 0;
+}
+/////////////////////////////////////////////////////////////////
+// ------===== END OF MAIN BODY =====-------
+/////////////////////////////////////////////////////////////////
+
+
+//============================================================//
+// Functions follow in no particular order.
+//============================================================//
+
+void allocWorkspace(tanner_struct &G, simd_workspace & W)
+{
+  W.F = allocSimdFrames(G);
+  W.c.assign(G.N*SIMDMS_LANES,0);
+  W.uncodedErrors.assign(SIMDMS_LANES,0);
+  W.newErrors.assign(SIMDMS_LANES,0);
+  W.iterations.assign(SIMDMS_LANES,0);
+  W.acc.assign((G.M+63)/64,0);
+  W.cw.assign(G.N,1);
+}
+
+double quantize(double x, double Ymax, double Nq)
+{
+  if (abs(x) > Ymax)
+    return sgn(x)*Ymax;
+
+  double qval =  sgn(x)*(floor(abs(x)*(Nq-1)/(2.0*Ymax)) + 0.0)*(2*Ymax/(Nq-1));
+  if (qval == 0.0)
+    qval = sgn(x)*2.0*Ymax/(Nq-1);
+  return qval;
+}
+
+double sgn(double x)
+{
+  if (x >= 0.0)
+    return 1.0;
+  return -1.0;
+}
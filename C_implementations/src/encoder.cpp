@@ -0,0 +1,362 @@
+/*==========================================================================================
+** encoder.cpp
+
+** Description:
+   Systematic encoder. See encoder.h.
+
+   Neal's .gen layout (4-byte little-endian integers):
+     magic ('G'<<8)+0x80, type byte ('d', 's' or 'm'), M, N, cols[N]
+   followed by, for each type:
+     dense   the M x (N-M) generator in mod2dense form: rows, columns,
+             then each column as (rows+31)/32 32-bit words;
+     mixed   the inverse of H's M x M check-column block, in mod2dense
+             form;
+     sparse  rows[M], then the LU factors of that block, L (M x M)
+             and U (M x N), each in mod2sparse form: rows, columns,
+             then for every non-empty row -(row+1) and its columns+1,
+             ending with 0.
+   Mixed and sparse generators are turned into the same parity columns
+   as dense ones, by encoding each information bit alone the way
+   Neal's encode does.
+==============================================================================================*/
+
+
+#include "encoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+using namespace std;
+
+#define GEN_MAGIC  (('G'<<8) + 0x80)
+
+static void checkEncoder(const encoder_struct & E, tanner_struct & G);
+
+
+bool isEncoderSource(const char * name)
+{
+  size_t len = strlen(name);
+  return (strcmp(name, "random") == 0) || ((len > 4) && (strcmp(name+len-4, ".gen") == 0));
+}
+
+
+encoder_struct openEncoder(const char * name, tanner_struct & G)
+{
+  encoder_struct E = (strcmp(name, "random") == 0) ? deriveEncoder(G) : loadGenerator(name, G);
+  checkEncoder(E, G);
+  printf("Encoding random codewords with K=%d information bits and R=%d check bits.\n", E.K, E.R);
+  return E;
+}
+
+
+// Reduce H to row-echelon form over GF(2), taking pivots column by
+// column. Rows are bit-packed, so eliminating a column XORs whole
+// words. A pivot row is zero left of its pivot, so only the words
+// from the pivot onward need to be XORed.
+encoder_struct deriveEncoder(tanner_struct & G)
+{
+  int rowWords = (G.N + 63)/64;
+  vector<uint64_t> H((size_t)G.M*rowWords, 0);
+  for (int i=0; i<G.M; i++)
+    for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
+      H[(size_t)i*rowWords + G.check_sym[e]/64] ^= (uint64_t)1 << (G.check_sym[e] % 64);
+
+  vector<int> pivots;
+  vector<char> isPivot(G.N, 0);
+  int r = 0;
+  for (int j=0; (j<G.N) && (r<G.M); j++)
+    {
+      int w = j/64;
+      uint64_t bit = (uint64_t)1 << (j % 64);
+      int p = r;
+      while ((p < G.M) && !(H[(size_t)p*rowWords + w] & bit))
+	p++;
+      if (p == G.M)
+	continue;
+      uint64_t * pivotRow = &H[(size_t)p*rowWords];
+      if (p != r)
+	for (int k=w; k<rowWords; k++)
+	  swap(pivotRow[k], H[(size_t)r*rowWords + k]);
+      pivotRow = &H[(size_t)r*rowWords];
+      for (int i=0; i<G.M; i++)
+	{
+	  uint64_t * row = &H[(size_t)i*rowWords];
+	  if ((i != r) && (row[w] & bit))
+	    for (int k=w; k<rowWords; k++)
+	      row[k] ^= pivotRow[k];
+	}
+      pivots.push_back(j);
+      isPivot[j] = 1;
+      r++;
+    }
+  if (r < G.M)
+    printf("Note: H has %d redundant checks.\n", G.M - r);
+
+  encoder_struct E;
+  E.N = G.N;
+  E.R = r;
+  E.K = G.N - r;
+  E.words = (r + 63)/64;
+  E.cols = pivots;
+  for (int j=0; j<G.N; j++)
+    if (!isPivot[j])
+      E.cols.push_back(j);
+
+  // Row r of the reduced H gives check bit cols[r] as the sum of the
+  // information bits it covers, so transpose those bits into columns:
+  E.parity.assign((size_t)E.K*E.words, 0);
+  for (int k=0; k<E.K; k++)
+    {
+      int j = E.cols[E.R + k];
+      uint64_t * col = &E.parity[(size_t)k*E.words];
+      for (int i=0; i<E.R; i++)
+	if (H[(size_t)i*rowWords + j/64] & ((uint64_t)1 << (j % 64)))
+	  col[i/64] |= (uint64_t)1 << (i % 64);
+    }
+  return E;
+}
+
+
+static int readInt(FILE * f, const char * fileName)
+{
+  unsigned char b[4];
+  if (fread(b, 1, 4, f) != 4)
+    {
+      fprintf(stderr, "loadGenerator: %s is truncated\n", fileName);
+      exit(1);
+    }
+  return (int) ((uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24));
+}
+
+
+// A rows x columns matrix in mod2dense form, as columns of
+// (rows+63)/64 64-bit words:
+static vector<uint64_t> readDense(FILE * f, const char * fileName, int rows, int columns)
+{
+  int r = readInt(f, fileName);
+  int c = readInt(f, fileName);
+  if ((r != rows) || (c != columns))
+    {
+      fprintf(stderr, "loadGenerator: %s holds a %dx%d matrix, expected %dx%d\n", fileName, r, c, rows, columns);
+      exit(1);
+    }
+  int words = (rows + 63)/64;
+  int words32 = (rows + 31)/32;
+  vector<uint64_t> m((size_t)columns*words, 0);
+  for (int k=0; k<columns; k++)
+    for (int w=0; w<words32; w++)
+      m[(size_t)k*words + w/2] |= (uint64_t)(uint32_t)readInt(f, fileName) << (32*(w % 2));
+  return m;
+}
+
+
+// A rows x columns matrix in mod2sparse form, as the column indices
+// of each row:
+static vector<vector<int> > readSparse(FILE * f, const char * fileName, int rows, int columns)
+{
+  int r = readInt(f, fileName);
+  int c = readInt(f, fileName);
+  if ((r != rows) || (c != columns))
+    {
+      fprintf(stderr, "loadGenerator: %s holds a %dx%d matrix, expected %dx%d\n", fileName, r, c, rows, columns);
+      exit(1);
+    }
+  vector<vector<int> > m(rows);
+  int row = -1;
+  for (int v=readInt(f, fileName); v!=0; v=readInt(f, fileName))
+    {
+      if (v < 0)
+	row = -v - 1;
+      else if ((row >= 0) && (row < rows) && (v <= columns))
+	m[row].push_back(v - 1);
+      else
+	{
+	  fprintf(stderr, "loadGenerator: %s has a bad sparse matrix entry\n", fileName);
+	  exit(1);
+	}
+    }
+  return m;
+}
+
+
+// Parity columns from a sparse generator. For each information bit
+// alone, as in Neal's sparse_encode: x is H times the source bits,
+// L y = x is solved by forward substitution over the rows in rows[]
+// order, and U z = y by backward substitution, giving check bit
+// cols[i] as z[cols[i]].
+static void sparseParity(FILE * f, const char * fileName, tanner_struct & G, encoder_struct & E)
+{
+  int M = E.R;
+  vector<int> rows(M);
+  for (int i=0; i<M; i++)
+    rows[i] = readInt(f, fileName);
+  vector<vector<int> > L = readSparse(f, fileName, M, M);
+  vector<vector<int> > U = readSparse(f, fileName, M, E.N);
+
+  vector<char> x(M), y(M), z(E.N);
+  E.parity.assign((size_t)E.K*E.words, 0);
+  for (int k=0; k<E.K; k++)
+    {
+      int source = E.cols[M + k];
+      fill(x.begin(), x.end(), 0);
+      fill(z.begin(), z.end(), 0);
+      z[source] = 1;
+      for (int e=G.sym_start[source]; e<G.sym_start[source+1]; e++)
+	x[G.sym_check[e]] ^= 1;
+
+      bool solved = true;
+      for (int i=0; i<M; i++)
+	{
+	  const vector<int> & row = L[rows[i]];
+	  int b = x[rows[i]];
+	  bool diagonal = false;
+	  for (size_t t=0; t<row.size(); t++)
+	    if (row[t] == i)
+	      diagonal = true;
+	    else
+	      b ^= y[row[t]];
+	  solved = solved && (diagonal || !b);
+	  y[i] = diagonal ? b : 0;
+	}
+      for (int i=M-1; i>=0; i--)
+	{
+	  const vector<int> & row = U[i];
+	  int ii = E.cols[i];
+	  int b = y[i];
+	  bool diagonal = false;
+	  for (size_t t=0; t<row.size(); t++)
+	    if (row[t] == ii)
+	      diagonal = true;
+	    else
+	      b ^= z[row[t]];
+	  solved = solved && (diagonal || !b);
+	  z[ii] = diagonal ? b : 0;
+	}
+      if (!solved)
+	{
+	  fprintf(stderr, "loadGenerator: the LU factors in %s do not solve for information bit %d\n", fileName, k);
+	  exit(1);
+	}
+
+      uint64_t * col = &E.parity[(size_t)k*E.words];
+      for (int i=0; i<M; i++)
+	if (z[E.cols[i]])
+	  col[i/64] |= (uint64_t)1 << (i % 64);
+    }
+}
+
+
+encoder_struct loadGenerator(const char * fileName, tanner_struct & G)
+{
+  FILE * f = fopen(fileName, "rb");
+  if (f == NULL)
+    {
+      fprintf(stderr, "loadGenerator: cannot open %s\n", fileName);
+      exit(1);
+    }
+  int magic = readInt(f, fileName);
+  int type = fgetc(f);
+  if (magic != GEN_MAGIC)
+    {
+      fprintf(stderr, "loadGenerator: %s is not a generator matrix file\n", fileName);
+      exit(1);
+    }
+  if ((type != 'd') && (type != 'm') && (type != 's'))
+    {
+      fprintf(stderr, "loadGenerator: %s has unknown generator type '%c'\n", fileName, type);
+      exit(1);
+    }
+
+  encoder_struct E;
+  int M = readInt(f, fileName);
+  E.N = readInt(f, fileName);
+  if ((M != G.M) || (E.N != G.N))
+    {
+      fprintf(stderr, "loadGenerator: %s is for a %dx%d code, but H is %dx%d\n", fileName, M, E.N, G.M, G.N);
+      exit(1);
+    }
+  E.R = M;
+  E.K = E.N - M;
+  E.words = (E.R + 63)/64;
+  E.cols.resize(E.N);
+  for (int j=0; j<E.N; j++)
+    E.cols[j] = readInt(f, fileName);
+
+  if (type == 'd')
+    E.parity = readDense(f, fileName, E.R, E.K);
+  else if (type == 'm')
+    {
+      // Check bit i is row i of the inverse times H's column of the
+      // information bit, so the parity column is the XOR of the
+      // inverse's columns for the checks on that bit:
+      vector<uint64_t> inverse = readDense(f, fileName, E.R, E.R);
+      E.parity.assign((size_t)E.K*E.words, 0);
+      for (int k=0; k<E.K; k++)
+	{
+	  int j = E.cols[E.R + k];
+	  for (int e=G.sym_start[j]; e<G.sym_start[j+1]; e++)
+	    for (int w=0; w<E.words; w++)
+	      E.parity[(size_t)k*E.words + w] ^= inverse[(size_t)G.sym_check[e]*E.words + w];
+	}
+    }
+  else
+    sparseParity(f, fileName, G, E);
+  fclose(f);
+  return E;
+}
+
+
+void randomCodeword(const encoder_struct & E, xoshiro_state & rng, uint64_t * acc, vector<int> & c)
+{
+  const int K = E.K, R = E.R, words = E.words;
+  const int * cols = &E.cols[0];
+  const uint64_t * parity = E.parity.data();
+  int * out = &c[0];
+  for (int w=0; w<words; w++)
+    acc[w] = 0;
+
+  // Take the information bits 64 at a time, and XOR in the parity
+  // column of each one that is set:
+  for (int k=0; k<K; k+=64)
+    {
+      uint64_t b = xoshiro_next(rng);
+      int n = (K - k < 64) ? K - k : 64;
+      if (n < 64)
+	b &= ((uint64_t)1 << n) - 1;
+      for (int j=0; j<n; j++)
+	out[cols[R+k+j]] = 1 - 2*(int)((b >> j) & 1);
+      while (b)
+	{
+	  int j = __builtin_ctzll(b);
+	  b &= b - 1;
+	  const uint64_t * col = parity + (size_t)(k+j)*words;
+	  for (int w=0; w<words; w++)
+	    acc[w] ^= col[w];
+	}
+    }
+
+  for (int i=0; i<R; i++)
+    out[cols[i]] = 1 - 2*(int)((acc[i/64] >> (i % 64)) & 1);
+}
+
+
+// Encode one word and confirm that it satisfies every check of H:
+static void checkEncoder(const encoder_struct & E, tanner_struct & G)
+{
+  xoshiro_state rng;
+  xoshiro_seed(rng, 1, 0);
+  vector<uint64_t> acc(E.words);
+  vector<int> c(E.N);
+  randomCodeword(E, rng, &acc[0], c);
+  for (int i=0; i<G.M; i++)
+    {
+      int parity = 1;
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
+	parity *= c[G.check_sym[e]];
+      if (parity < 0)
+	{
+	  fprintf(stderr, "Encoder does not match H: check %d fails\n", i+1);
+	  exit(1);
+	}
+    }
+}
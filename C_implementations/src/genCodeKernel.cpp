@@ -0,0 +1,175 @@
+/* genCodeKernel
+   Writes the source of a min-sum kernel specialized for the code of
+   an alist file (see codekernel.h). The edge tables become constant
+   arrays, of 16-bit indices when the code is small enough, and the
+   checks and symbols are split into runs of consecutive nodes of
+   equal degree, handled by the templates of codekernel_minsum.h.
+
+   The name identifies the kernel in the decoders' messages and
+   defaults to the alist's file name without ".alist".
+*/
+
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+#include "tanner.h"
+#include "codekernel.h"
+
+using namespace std;
+
+
+typedef struct {
+  int count;   // Number of nodes in the run
+  int first;   // First node
+  int edge0;   // First edge
+} node_run;
+
+// Runs of consecutive nodes of equal degree, by degree:
+static map<int, vector<node_run> > degreeRuns(const int * start, int nodes)
+{
+  map<int, vector<node_run> > runs;
+  int i = 0;
+  while (i < nodes)
+    {
+      int degree = start[i+1] - start[i];
+      node_run r = {0, i, start[i]};
+      while ((i < nodes) && (start[i+1] - start[i] == degree))
+	{
+	  r.count++;
+	  i++;
+	}
+      if (degree > 0)
+	runs[degree].push_back(r);
+    }
+  return runs;
+}
+
+
+static void writeTable(FILE * f, const char * type, const char * name, const int * v, int n)
+{
+  fprintf(f, "static const %s %s[%d] = {", type, name, n);
+  for (int k=0; k<n; k++)
+    fprintf(f, "%s%d%s", (k % 16) ? " " : "\n  ", v[k], (k+1 < n) ? "," : "");
+  fprintf(f, "\n};\n\n");
+}
+
+
+static void writeRunTable(FILE * f, const char * name, int degree, const vector<node_run> & runs)
+{
+  fprintf(f, "static const int %s_%d[%d][3] = {", name, degree, (int) runs.size());
+  for (size_t k=0; k<runs.size(); k++)
+    fprintf(f, "%s{%d, %d, %d}%s", (k % 6) ? " " : "\n  ", runs[k].count, runs[k].first, runs[k].edge0,
+	    (k+1 < runs.size()) ? "," : "");
+  fprintf(f, "\n};\n");
+}
+
+
+int main(int argc, char * argv[])
+{
+  if ((argc != 3) && (argc != 4))
+    {
+      cout << "Usage: " << argv[0] << " alist outfile.cpp [name]" << endl;
+      return 0;
+    }
+
+  string name;
+  if (argc == 4)
+    name = argv[3];
+  else
+    {
+      name = argv[1];
+      name = name.substr(name.rfind('/') + 1);
+      if ((name.size() > 6) && (name.compare(name.size()-6, 6, ".alist") == 0))
+	name.erase(name.size()-6);
+    }
+
+  tanner_struct G = loadTanner(argv[1]);
+  FILE * f = fopen(argv[2], "w");
+  if (f == NULL)
+    {
+      fprintf(stderr, "Cannot write %s\n", argv[2]);
+      exit(1);
+    }
+
+  // Every entry of the tables is an edge or a check, below E:
+  const char * index = (G.E <= 65536) ? "uint16_t" : "int";
+  map<int, vector<node_run> > checkRuns = degreeRuns(G.check_start, G.M);
+  map<int, vector<node_run> > symRuns   = degreeRuns(G.sym_start, G.N);
+
+  fprintf(f, "/*==========================================================================================\n");
+  fprintf(f, "** codekernel_%s.cpp\n\n", name.c_str());
+  fprintf(f, "** Description:\n");
+  fprintf(f, "   Min-sum kernel specialized for %s (N=%d, M=%d, E=%d), written by\n", name.c_str(), G.N, G.M, G.E);
+  fprintf(f, "   genCodeKernel from %s. Do not edit; see codekernel.h.\n", argv[1]);
+  fprintf(f, "==============================================================================================*/\n\n");
+  fprintf(f, "#include \"codekernel_minsum.h\"\n\n");
+
+  writeTable(f, index, "check_edge", G.check_edge, G.E);
+  writeTable(f, index, "sym_edge", G.sym_edge, G.E);
+  writeTable(f, index, "sym_check", G.sym_check, G.E);
+
+  // Degrees with a single run get constant arguments, the others
+  // loop over a table of runs:
+  for (map<int, vector<node_run> >::iterator r=checkRuns.begin(); r!=checkRuns.end(); r++)
+    if (r->second.size() > 1)
+      writeRunTable(f, "check_runs", r->first, r->second);
+  for (map<int, vector<node_run> >::iterator r=symRuns.begin(); r!=symRuns.end(); r++)
+    if (r->second.size() > 1)
+      writeRunTable(f, "sym_runs", r->first, r->second);
+
+  fprintf(f, "\nstatic void checkNodes(const double * sym_to_check, double * check_to_sym)\n{\n");
+  for (map<int, vector<node_run> >::iterator r=checkRuns.begin(); r!=checkRuns.end(); r++)
+    {
+      int dc = r->first;
+      if (r->second.size() == 1)
+	fprintf(f, "  minsumCheckRun<%d>(%d, %d, check_edge + %d, sym_to_check, check_to_sym);\n",
+		dc, r->second[0].count, r->second[0].edge0, r->second[0].edge0);
+      else
+	{
+	  fprintf(f, "  for (int r=0; r<%d; r++)\n", (int) r->second.size());
+	  fprintf(f, "    minsumCheckRun<%d>(check_runs_%d[r][0], check_runs_%d[r][2], check_edge + check_runs_%d[r][2],\n",
+		  dc, dc, dc, dc);
+	  fprintf(f, "\t\t      sym_to_check, check_to_sym);\n");
+	}
+    }
+  fprintf(f, "}\n\n");
+
+  fprintf(f, "static int symNodes(const double * y, int * d, double * sym_to_check, const double * check_to_sym, int * syndrome)\n{\n");
+  fprintf(f, "  for (int j=0; j<%d; j++)\n    syndrome[j] = 0;\n", G.M);
+  fprintf(f, "  int unsatisfied = 0;\n");
+  for (map<int, vector<node_run> >::iterator r=symRuns.begin(); r!=symRuns.end(); r++)
+    {
+      int dv = r->first;
+      if (r->second.size() == 1)
+	fprintf(f, "  unsatisfied += minsumSymRun<%d>(%d, %d, %d, sym_edge + %d, sym_check + %d,\n"
+		"\t\t\t\t  y, d, sym_to_check, check_to_sym, syndrome);\n",
+		dv, r->second[0].count, r->second[0].first, r->second[0].edge0, r->second[0].edge0, r->second[0].edge0);
+      else
+	{
+	  fprintf(f, "  for (int r=0; r<%d; r++)\n", (int) r->second.size());
+	  fprintf(f, "    unsatisfied += minsumSymRun<%d>(sym_runs_%d[r][0], sym_runs_%d[r][1], sym_runs_%d[r][2],\n",
+		  dv, dv, dv, dv);
+	  fprintf(f, "\t\t\t\t    sym_edge + sym_runs_%d[r][2], sym_check + sym_runs_%d[r][2],\n", dv, dv);
+	  fprintf(f, "\t\t\t\t    y, d, sym_to_check, check_to_sym, syndrome);\n");
+	}
+    }
+  fprintf(f, "  return unsatisfied;\n}\n\n");
+
+  // Linked kernels register themselves, shared ones are looked up by
+  // loadCodeKernel():
+  fprintf(f, "#ifdef CODE_KERNEL_SHARED\nextern \"C\" const code_kernel sharedCodeKernel =\n#else\nstatic const code_kernel kernel =\n#endif\n");
+  fprintf(f, "  { \"%s\", %d, %d, %d, 0x%016llxULL, checkNodes, symNodes };\n\n", name.c_str(), G.N, G.M, G.E,
+	  (unsigned long long) tannerSignature(G));
+  fprintf(f, "#ifndef CODE_KERNEL_SHARED\nstatic code_kernel_registrar registrar(&kernel);\n#endif\n");
+  fclose(f);
+
+  cout << "Wrote the " << name << " kernel (N=" << G.N << ", M=" << G.M << ", E=" << G.E << ", "
+       << checkRuns.size() << " check degrees, " << symRuns.size() << " symbol degrees) to " << argv[2] << endl;
+  freeTanner(G);
+  return 0;
+}
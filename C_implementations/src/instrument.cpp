@@ -0,0 +1,69 @@
+/*==========================================================================================
+** instrument.cpp
+
+** Description:
+   Stage timing for the decoders. See instrument.h.
+==============================================================================================*/
+
+
+#include "instrument.h"
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+using namespace std;
+
+static const char * stageNames[PROFILE_STAGES] = { "channel", "check", "symbol", "syndrome", "io" };
+
+
+profiler::profiler(bool on, int numThreads)
+  : enabled(on), threads(numThreads), start(chrono::steady_clock::now())
+{
+}
+
+
+static double stageSeconds(const profiler & P, int s)
+{
+  double seconds = 0.0;
+  for (size_t t=0; t<P.threads.size(); t++)
+    seconds += P.threads[t].seconds[s];
+  return seconds;
+}
+
+
+static double wallSeconds(const profiler & P)
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - P.start).count();
+}
+
+
+void profileReport(const profiler & P, const frame_totals & t, int E)
+{
+  if (!P.enabled)
+    return;
+  double wall = wallSeconds(P);
+  double total = 0.0;
+  for (int s=0; s<PROFILE_STAGES; s++)
+    total += stageSeconds(P, s);
+
+  cout << "Profile: " << t.totalWords/wall << " frames/s, " << t.totalIterations/wall << " iterations/s, "
+       << (double) t.totalIterations*E/wall << " edge updates/s" << endl;
+  cout << "Worker time:";
+  for (int s=0; s<PROFILE_STAGES; s++)
+    cout << " " << stageNames[s] << " " << fixed << setprecision(1)
+	 << ((total > 0.0) ? 100.0*stageSeconds(P, s)/total : 0.0) << "%";
+  cout << defaultfloat << setprecision(6) << endl;
+}
+
+
+// The stage columns are always present, so that records made with and
+// without --profile can share a CSV file; they are null when off.
+void recordProfile(result_record & R, const profiler & P, const frame_totals & t, int E)
+{
+  string key;
+  recordNumber(R, "edge_updates_per_s", (double) t.totalIterations*E/wallSeconds(P));
+  for (int s=0; s<PROFILE_STAGES; s++)
+    {
+      key = string(stageNames[s]) + "_s";
+      recordNumber(R, key.c_str(), P.enabled ? stageSeconds(P, s) : NAN);
+    }
+}
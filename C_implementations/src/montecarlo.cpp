@@ -0,0 +1,207 @@
+/*==========================================================================================
+** montecarlo.cpp
+
+** Description:
+   Multithreaded Monte Carlo frame engine. See montecarlo.h.
+==============================================================================================*/
+
+
+#include "montecarlo.h"
+#include "options.h"
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+using namespace std;
+
+
+mc_engine::mc_engine(int threads, int N, stop_rule rule)
+  : numThreads(threads), counters(threads), stop(false), done(rule), error_weight_hist(N,0)
+{
+  for (int t=0; t<numThreads; t++)
+    {
+      counters[t].errors = 0;
+      counters[t].uncodedErrors = 0;
+      counters[t].totalBits = 0;
+      counters[t].totalWords = 0;
+      counters[t].wordErrors = 0;
+      counters[t].totalIterations = 0;
+      counters[t].weightedErrors = 0.0;
+      counters[t].weightedErrors2 = 0.0;
+      counters[t].weightedWordErrors = 0.0;
+      counters[t].weightedWordErrors2 = 0.0;
+    }
+}
+
+
+// A request for 0 threads means one per available core.
+int resolveThreads(long requested)
+{
+  if (requested > 0)
+    return requested;
+  int n = thread::hardware_concurrency();
+  return (n > 0) ? n : 1;
+}
+
+
+// The policy's error counts are filled in later by mcStopRule(), from
+// the defaults of the decoder that uses it.
+stop_policy extractStopPolicy(int & argc, char * argv[])
+{
+  stop_policy P = defaultStopPolicy(0, 0);
+  P.precision  = extractDoubleOption(argc, argv, "rel-precision", P.precision);
+  P.confidence = extractDoubleOption(argc, argv, "confidence", P.confidence);
+  P.maxFrames  = extractLongOption(argc, argv, "max-frames", P.maxFrames);
+  P.ferFloor   = extractDoubleOption(argc, argv, "fer-floor", P.ferFloor);
+  if ((P.confidence <= 0.0) || (P.confidence >= 1.0) || (P.precision < 0.0))
+    {
+      cerr << "Need 0 < confidence < 1 and precision >= 0" << endl;
+      exit(1);
+    }
+  return P;
+}
+
+
+// The defaults leave the channel unbiased.
+is_channel extractISChannel(int & argc, char * argv[])
+{
+  is_channel ch;
+  ch.shift = extractDoubleOption(argc, argv, "is-shift", 0.0);
+  ch.scale = extractDoubleOption(argc, argv, "is-scale", 1.0);
+  if ((ch.scale <= 0.0) || (ch.shift < 0.0) || (ch.shift >= 1.0))
+    {
+      cerr << "Need is-scale > 0 and 0 <= is-shift < 1" << endl;
+      exit(1);
+    }
+  if (isActive(ch))
+    cout << "Importance sampling with noise shift " << ch.shift << " and scale " << ch.scale << endl;
+  return ch;
+}
+
+
+stop_rule mcStopRule(stop_policy P, long minErrors, long minWordErrors)
+{
+  P.minErrors = minErrors;
+  P.minWordErrors = minWordErrors;
+  double z = confidenceZ(P.confidence);
+  // Biased error counts say nothing about the accuracy of a weighted
+  // estimate, so weighted runs always use a precision target:
+  if (P.weighted && (P.precision == 0.0))
+    P.precision = 0.1;
+  if (P.weighted)
+    return [P, z](const frame_totals & t)
+      { return stopReachedWeighted(P, z, t.errors, t.wordErrors, t.totalWords, t.weightedWordErrors, t.weightedWordErrors2); };
+  return [P, z](const frame_totals & t)
+    { return stopReached(P, z, t.errors, t.wordErrors, t.totalWords); };
+}
+
+
+void mcPrintInterval(const stop_policy & P, const frame_totals & t)
+{
+  double z = confidenceZ(P.confidence);
+  if (P.weighted)
+    {
+      double fer, ferVar, ber, berVar;
+      weightedEstimate(t.weightedWordErrors, t.weightedWordErrors2, t.totalWords, fer, ferVar);
+      weightedEstimate(t.weightedErrors, t.weightedErrors2, t.totalWords, ber, berVar);
+      int N = t.totalBits/t.totalWords;
+      cout << "Importance-sampled BER=" << ber/N << " (std. error " << sqrt(berVar)/N << ")" << endl;
+      cout << "Importance-sampled FER=" << fer << " (std. error " << sqrt(ferVar) << "), " << 100*P.confidence
+	   << "% interval [" << fmax(fer - z*sqrt(ferVar), 0.0) << ", " << fer + z*sqrt(ferVar) << "]" << endl;
+      return;
+    }
+  double lower, upper;
+  wilsonInterval(t.wordErrors, t.totalWords, z, lower, upper);
+  cout << "FER=" << (double) t.wordErrors/t.totalWords << ", " << 100*P.confidence
+       << "% interval [" << lower << ", " << upper << "]" << endl;
+}
+
+
+frame_totals mcTotals(mc_engine & mc)
+{
+  frame_totals t = {0, 0, 0, 0, 0, 0, 0.0, 0.0, 0.0, 0.0};
+  for (int k=0; k<mc.numThreads; k++)
+    {
+      worker_counters & c = mc.counters[k];
+      t.errors          += c.errors.load(memory_order_relaxed);
+      t.uncodedErrors   += c.uncodedErrors.load(memory_order_relaxed);
+      t.totalBits       += c.totalBits.load(memory_order_relaxed);
+      t.totalWords      += c.totalWords.load(memory_order_relaxed);
+      t.wordErrors      += c.wordErrors.load(memory_order_relaxed);
+      t.totalIterations += c.totalIterations.load(memory_order_relaxed);
+      t.weightedErrors      += c.weightedErrors.load(memory_order_relaxed);
+      t.weightedErrors2     += c.weightedErrors2.load(memory_order_relaxed);
+      t.weightedWordErrors  += c.weightedWordErrors.load(memory_order_relaxed);
+      t.weightedWordErrors2 += c.weightedWordErrors2.load(memory_order_relaxed);
+    }
+  return t;
+}
+
+
+void mcRecordFrame(mc_engine & mc, int tid, int newErrors, int uncodedErrors, int iterations, int N, const char * note, double weight)
+{
+  worker_counters & c = mc.counters[tid];
+
+  if (newErrors > 0)
+    {
+      lock_guard<mutex> guard(mc.lock);
+      // Report the frame error to the console:
+      cout << "Ferr with " << newErrors << " errors." << note << endl;
+      mc.error_weight_hist[newErrors-1]++;
+      c.errors.store(c.errors.load(memory_order_relaxed) + newErrors, memory_order_relaxed);
+      c.wordErrors.store(c.wordErrors.load(memory_order_relaxed) + 1, memory_order_relaxed);
+      c.weightedErrors.store(c.weightedErrors.load(memory_order_relaxed) + weight*newErrors, memory_order_relaxed);
+      c.weightedErrors2.store(c.weightedErrors2.load(memory_order_relaxed) + weight*weight*newErrors*newErrors, memory_order_relaxed);
+      c.weightedWordErrors.store(c.weightedWordErrors.load(memory_order_relaxed) + weight, memory_order_relaxed);
+      c.weightedWordErrors2.store(c.weightedWordErrors2.load(memory_order_relaxed) + weight*weight, memory_order_relaxed);
+    }
+
+  // Only this thread writes its counters, so plain load/store suffices:
+  c.uncodedErrors.store(c.uncodedErrors.load(memory_order_relaxed) + uncodedErrors, memory_order_relaxed);
+  c.totalBits.store(c.totalBits.load(memory_order_relaxed) + N, memory_order_relaxed);
+  c.totalIterations.store(c.totalIterations.load(memory_order_relaxed) + iterations, memory_order_relaxed);
+  c.totalWords.store(c.totalWords.load(memory_order_relaxed) + 1, memory_order_release);
+
+  frame_totals t = mcTotals(mc);
+  if (mc.done(t))
+    mc.stop.store(true);
+}
+
+
+void mcRun(mc_engine & mc, function<void(int)> worker, long reportInterval)
+{
+  vector<thread> workers;
+  for (int t=0; t<mc.numThreads; t++)
+    workers.push_back(thread(worker, t));
+
+  // Give a status message each time another reportInterval frames complete:
+  long nextReport = reportInterval;
+  while (!mc.stop.load())
+    {
+      this_thread::sleep_for(chrono::milliseconds(20));
+      frame_totals t = mcTotals(mc);
+      if ((reportInterval > 0) && (t.totalWords >= nextReport))
+	{
+	  mcPrintIncremental(mc, t);
+	  nextReport = (t.totalWords/reportInterval + 1)*reportInterval;
+	}
+    }
+
+  for (int t=0; t<mc.numThreads; t++)
+    workers[t].join();
+}
+
+
+void mcPrintIncremental(mc_engine & mc, frame_totals & t)
+{
+  lock_guard<mutex> guard(mc.lock);
+  cout << "\nIncremental result: " << t.errors << " bit errs in " << t.totalWords << " words, BER=" << (double)t.errors/t.totalBits
+       << ". Average iterations = " << (double) t.totalIterations/t.totalWords << ". Word error=" << t.wordErrors << ". Uncoded errors = " << t.uncodedErrors << ", uncBER=" << (double)t.uncodedErrors/t.totalBits
+       << "\nError weights:\n";
+  for (int i=0; i<mc.error_weight_hist.size(); i++)
+    {
+      if (mc.error_weight_hist[i] > 0)
+	cout << i+1 << ":\t" << mc.error_weight_hist[i] << endl;
+    }
+}
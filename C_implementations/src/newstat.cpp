@@ -41,7 +41,10 @@ using namespace std;
 
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
-#include "rand_gsl.h"
+#include "rand_philox.h"
+#include "tanner.h"
+#include "codewords.h"
+#include "options.h"
 
 
 //============ GLOBAL PARAMETERS ============//
@@ -58,18 +61,16 @@ int maxphase=7;
 int NF=10;
 int NR= 10;
 
-char timeString[80];  
-
 
 //============ DECODING ALGORITHM PREDEFINES ===============//
-void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied);
-void symNodeUpdates(alist_struct &H, vector<double> &  thetas, double & lambda, int & mu,  vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation);
-double evaluateObjectiveFunction(alist_struct &H, vector<int> & d, vector<double> & y, vector<int> & check_to_sym); 
+void checkNodeUpdates(tanner_struct &G, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied);
+void symNodeUpdates(tanner_struct &G, vector<double> &  thetas, double & lambda, int & mu,  vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation);
+double evaluateObjectiveFunction(tanner_struct &G, vector<int> & d, vector<double> & y, vector<int> & check_to_sym); 
 
 
 //============= SUPPORTING FUNCTION PREDEFINES =================//
 int find(int symNodes[], int len, int snode);
-int countDecisionErrors(vector<int> d, vector<int> c);
+int countDecisionErrors(const vector<int> & d, const vector<int> & c);
 
 
 //============= I/O PREDEFINES ============================//
@@ -80,7 +81,6 @@ void printVector(vector<double> v);
 void printErroneousMessages(vector<vector<int> > v);
 void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check_to_sym, vector<vector<int> > & sym_to_check, vector<int> & c, vector<int> & d, int fid);
 void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check_to_sym, vector<vector<int> > & sym_to_check, vector<int> & c, vector<int> & d, vector<double> & y, vector<int> & yq, vector<int> & r, int fid, int it);
-void recordRanState(int framenum, const gsl_rng * r);
 
 
 
@@ -89,6 +89,9 @@ void recordRanState(int framenum, const gsl_rng * r);
 ///////////////////////////////////////////////////////////////////////////////
 int main(int argc, char * argv[])
 {
+  // Optional flags, removed from argv before the positional arguments are counted:
+  long seed = extractLongOption(argc, argv, "seed", time(0));
+
   vector<string> command_arguments(0);
   command_arguments.push_back("alist");
   command_arguments.push_back("R");
@@ -121,7 +124,7 @@ int main(int argc, char * argv[])
   // Check arguments and print usage statements:
   if ((argc != command_arguments.size()) && (argc != command_arguments.size()+1))
     {
-      cout << "Usage: " << argv[0];
+      cout << "Usage: " << argv[0] << " [--seed S]";
       for (int i=0; i<command_arguments.size(); i++)
 	cout << " " << command_arguments[i];
       cout << "\n";
@@ -130,7 +133,7 @@ int main(int argc, char * argv[])
 
   // Parse command arguments:
   int idx=1;
-  alist_struct H = loadFile(argv[idx++]);
+  tanner_struct G = loadTanner(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
   double R = atof(argv[idx++]);
   cout << " R = \t" << R << endl;
@@ -171,54 +174,46 @@ int main(int argc, char * argv[])
   //maxphase = atoi(argv[idx++]);
   //cout << " maxphase = \t" << maxphase << endl;
 //#endif
-  ifstream codewordFile;
+  codeword_stream codewords;
   if (argc == command_arguments.size()+1)
     {
       cout << "\nUsing codewords from " << argv[idx] << endl;
-      codewordFile.open(argv[idx],ios::in);
+      openCodewords(codewords, argv[idx], G.N);
     }
   else
     cout << "\nUsing all-zero sequence.\n";
 
-  // Get Date/Time String:
-  time_t rawtime;
-  struct tm * timeinfo;
-  time (&rawtime);
-  timeinfo = localtime(&rawtime);
-
-  strftime(timeString,80,"%d-%m-%Y",timeinfo);
-
   // Compute channel parameters:
   double N0 = pow(10.0,-SNR/10.0)/R;
   double sigma = sqrt(N0/2.0);
 
   // Get code parameters:
-  int dv = H.biggest_num_n;
-  int dc = H.biggest_num_m;
+  int dv = G.biggest_dv;
+  int dc = G.biggest_dc;
 
   // Report initial status messages:
-  cout << "Simulating GDBF decoding on code with N=" << H.N << ", M=" << H.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
+  cout << "Simulating GDBF decoding on code with N=" << G.N << ", M=" << G.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
   cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
 
 
   // Declare top-level variables:
-  vector<int>    c(H.N,1);     // Bipolar codeword (all +1 in this simulation)
-  vector<double> x(H.N,1);     // Modulated codeword (all +1 in this simulation)
+  vector<int>    c(G.N,1);     // Bipolar codeword (all +1 in this simulation)
+  vector<double> x(G.N,1);     // Modulated codeword (all +1 in this simulation)
   vector<double> y(x);          // Channel samples
-  vector<double> yq(H.N);       // Quantized channel samples
-  vector<int>    r(H.N);        // Received bipolar decisions (+1 or -1)
-  vector<int>    d(H.N,0);      // Decoder outputs (+1 or -1 after decoding)
+  vector<double> yq(G.N);       // Quantized channel samples
+  vector<int>    r(G.N);        // Received bipolar decisions (+1 or -1)
+  vector<int>    d(G.N,0);      // Decoder outputs (+1 or -1 after decoding)
 
 #ifdef outputSmoothing
-  vector<int> dsum(H.N,0);
+  vector<int> dsum(G.N,0);
   int smoothingUsed = 0;
 #endif
 //#ifdef redecode	
   int a,a1,a2,phase;
   vector<int> phase_hist(maxphase,0);  // Histogram for redecode phases
 //#endif
-  vector<double> perturbation(H.N,0.0);
-  vector<double> noiseSamples(H.N,0.0);
+  vector<double> perturbation(G.N,0.0);
+  vector<double> noiseSamples(G.N,0.0);
 
   // Declare and initialize statistics variables:
   long errors = 0;            // Total bit errors
@@ -227,46 +222,38 @@ int main(int argc, char * argv[])
   long totalWords = 0;        // Total number of frames observed
   long wordErrors = 0;        // Number of word errors observed
   long totalIterations = 0;   // Total number of iterations accumulated over all frames.
-  vector<int> error_weight_hist(H.N,0);  // Vector to serve as histogram of error-pattern weights (1 up to H.N)
-  vector<double> thetas(H.N,theta);
+  vector<int> error_weight_hist(G.N,0);  // Vector to serve as histogram of error-pattern weights (1 up to G.N)
+  vector<double> thetas(G.N,theta);
 
   // NOTE: Could also do a histogram of the iteration count. It might be interesting.
 
   // Declare and initialize message memories:
-  vector<int> check_to_sym(H.M,0);
+  vector<int> check_to_sym(G.M,0);
 
   /////////////////////////////////////////////////////////////////
   // ------===== MAIN TEST LOOP =====-------
   /////////////////////////////////////////////////////////////////
   int minWordErrors = 20;
-  if (H.N > 10000) minWordErrors = 10;
-  if (H.N > 50000) minWordErrors = 5;
-  ran_seed(time(0)); //(134159);
+  if (G.N > 10000) minWordErrors = 10;
+  if (G.N > 50000) minWordErrors = 5;
+  // Every frame's noise is keyed by (seed, frame, phase, iteration),
+  // so replayGDBF can regenerate any logged frame from the seed and
+  // the frame number:
+  ran_seed(seed);
+  cout << "Random seed " << seed << endl;
   int i,j;
   int framenum=0;
   //while ((errors < 200) || (wordErrors < minWordErrors))
     while (totalWords < NF)
     {
-      recordRanState(framenum, rng_engine);
-      string s;
+      ran_frame(framenum, 0, 0);
       // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
+      if (codewords.frames > 0)
 	{
-	  getline(codewordFile, s);
-	  if (codewordFile.eof())
+	  const uint8_t * row = nextCodeword(codewords);
+	  for (i=0; i<G.N; i++)
 	    {
-	      codewordFile.clear();
-	      codewordFile.seekg(0);
-	      getline(codewordFile, s);
-	    }
-	  for (i=0; i<H.N; i++)
-	    {	    
-	      if (s[i] == '1')	      
-		c[i] = -1;
-	      else if (s[i] == '0')
-		c[i] = +1;
-	      else
-		cout << "Got an invalid symbol at index " << i << endl;
+	      c[i] = codewordBit(row, i) ? -1 : +1;
 	      x[i] = c[i];
 	    }
 	}
@@ -276,7 +263,7 @@ int main(int argc, char * argv[])
       int newErrors;
 
       // Emulate AWGN transmission      
-      for (i=0; i<H.N; i++)
+      for (i=0; i<G.N; i++)
 	{
 	  y[i] = x[i]*(1.0+sigma*rann());
 
@@ -307,7 +294,7 @@ int main(int argc, char * argv[])
       int phase_iterations = num_iterations;
       while(phase < NR)
 	{
-	  for (i=0; i<H.N; i++)
+	  for (i=0; i<G.N; i++)
 	    {
 	      d[i]=r[i];
 #ifdef outputSmoothing
@@ -329,7 +316,7 @@ int main(int argc, char * argv[])
 #endif
 
 #ifdef thresholdAdaptation
-	  for (int i=0; i<H.N; i++)
+	  for (int i=0; i<G.N; i++)
 	    thetas[i] = theta;
 #endif
 
@@ -344,14 +331,14 @@ int main(int argc, char * argv[])
 	  
 	  
 		// First update the check nodes:
-		checkNodeUpdates(H,d,check_to_sym,satisfied);
+		checkNodeUpdates(G,d,check_to_sym,satisfied);
 		if (satisfied)
 		  break;
 
 	  
 #ifdef modeswitching
 		if (it > Tswitch)
-		  f1 = evaluateObjectiveFunction(H,d,yq,check_to_sym);	    
+		  f1 = evaluateObjectiveFunction(G,d,yq,check_to_sym);	    
 #endif 
 	  
 
@@ -359,7 +346,8 @@ int main(int argc, char * argv[])
 		// Then perform Symbol node updates:
 	  
 #ifdef addNoise
-		for (int i=0; i<H.N; i++)
+		ran_frame(framenum, phase+1, it);
+		for (int i=0; i<G.N; i++)
 		  {
 #ifdef uniformNoise
 		    double newSample = sqrt(3)*noiseSigma*2.0*(ranu()-0.5);
@@ -376,12 +364,12 @@ int main(int argc, char * argv[])
 #endif
 	  
 
-		symNodeUpdates(H,thetas,lambda, mu, yq, d,check_to_sym, noiseSigma, perturbation); 
+		symNodeUpdates(G,thetas,lambda, mu, yq, d,check_to_sym, noiseSigma, perturbation); 
 	  
 #ifdef modeswitching
 		if (it > Tswitch)
 		  {
-		    f2 = evaluateObjectiveFunction(H,d,yq,check_to_sym);
+		    f2 = evaluateObjectiveFunction(G,d,yq,check_to_sym);
 		    if (f1 >= f2)
 		      mu = 0;
 		    //cout << "\tf2=" << f2 << "\t mu=" << mu << endl;
@@ -391,7 +379,7 @@ int main(int argc, char * argv[])
 #ifdef outputSmoothing
 		if (it > num_iterations-windowsize)
 		  {
-		    for (int i=0; i<H.N; i++)
+		    for (int i=0; i<G.N; i++)
 		      dsum[i] += d[i];
 		  }
 #endif
@@ -400,7 +388,7 @@ int main(int argc, char * argv[])
       
 #ifdef outputSmoothing
 	  if (!satisfied)
-	    for (int i=0; i<H.N; i++)
+	    for (int i=0; i<G.N; i++)
 	      {
 		if (dsum[i] > 0)
 		  d[i] = 1;
@@ -460,12 +448,12 @@ int main(int argc, char * argv[])
 
 
       // Increment frame and bit counters:
-      totalBits += H.N; 
+      totalBits += G.N; 
       //      totalIterations += it;
       totalWords++;
       // ------------------------------------------------
       // Give a status message every 100 frames
-      int reportInterval = round(100e3/H.N);
+      int reportInterval = round(100e3/G.N);
       if ((totalWords % reportInterval) == 0)
 	{
 	  cout << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
@@ -544,7 +532,7 @@ void printHistogram(vector<int> & h)
     }
 }
 
-int countDecisionErrors(vector<int> d, vector<int> c)
+int countDecisionErrors(const vector<int> & d, const vector<int> & c)
 {
   int errs =0 ;
   for (int i=0; i<d.size(); i++)
@@ -572,17 +560,16 @@ void printErroneousMessages(vector<vector<int> > v)
     }
 }
 
-void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied)
+void checkNodeUpdates(tanner_struct &G, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied)
 {
   int msg;
   satisfied = true;
-  for (int i=0; i<H.M; i++)
+  for (int i=0; i<G.M; i++)
     {
       int prod = 1;
-      for (int j=0; j<H.num_mlist[i]; j++)
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
 	{
-	  int snode = H.mlist[i][j]-1;
-	  msg = sym_to_check[snode];
+	  msg = sym_to_check[G.check_sym[e]];
 	  prod *= msg;
 	}
       if (prod < 0)
@@ -591,42 +578,40 @@ void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> &
     }
 }
 
-void symNodeUpdates(alist_struct &H, vector<double> & thetas, double & lambda, int & mu, vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation)
+void symNodeUpdates(tanner_struct &G, vector<double> & thetas, double & lambda, int & mu, vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation)
 {
-  vector<double> E(H.N,0.0);
   double Emin = INFINITY;
   int mindx = -1;
   double w = 1;
   
-  for (int i=0; i<H.N; i++)
+  for (int i=0; i<G.N; i++)
     {
       bool flip = false;
-      E[i] = d[i]*y[i];
+      double E = d[i]*y[i];
 
 #ifdef weightSyndromes
-      int dv = H.num_nlist[i];
+      int dv = G.sym_start[i+1]-G.sym_start[i];
       w = alpha*Ymax/dv;
 #endif
 
-      for (int j=0; j<H.num_nlist[i]; j++)
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
 	{
-	  int cnode = H.nlist[i][j]-1;
-	  int msg = check_to_sym[cnode];
-	  E[i] += w*msg;	  
+	  int msg = check_to_sym[G.sym_check[k]];
+	  E += w*msg;	  
 	}      
 #ifdef addNoise
-      E[i] += perturbation[i]; //sigma*rann();
+      E += perturbation[i]; //sigma*rann();
 #endif
-      if ((mu == 1) && (E[i] < thetas[i]))
+      if ((mu == 1) && (E < thetas[i]))
 	{
 	  flip = true;
 	  d[i] = -d[i];      	    
 	}
       if (mu == 0)	
-	if (E[i] < Emin)
+	if (E < Emin)
 	  {
 	    flip = true;
-	    Emin = E[i];
+	    Emin = E;
 	    mindx = i;
 	  }	
 #ifdef thresholdAdaptation
@@ -641,12 +626,12 @@ void symNodeUpdates(alist_struct &H, vector<double> & thetas, double & lambda, i
 }
 
 
-double evaluateObjectiveFunction(alist_struct &H, vector<int> & d, vector<double> & y, vector<int> & check_to_sym)
+double evaluateObjectiveFunction(tanner_struct &G, vector<int> & d, vector<double> & y, vector<int> & check_to_sym)
 {
   double f = 0;
-  for (int i=0; i<H.N; i++)
+  for (int i=0; i<G.N; i++)
     f += d[i]*y[i];
-  for (int j=0; j<H.M; j++)
+  for (int j=0; j<G.M; j++)
     f += check_to_sym[j];
 
   return f;
@@ -779,13 +764,3 @@ void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check
 #endif
 }
 
-
-void recordRanState(int framenum, const gsl_rng * r)
-{
-  stringstream ss("");
-  ss << "tmp/" << timeString  << "_RanState_" << framenum << ".state";
-  FILE * state = fopen(ss.str().c_str(),"w+");
-  
-  gsl_rng_fwrite (state, r);
-  fclose(state);
-}
@@ -0,0 +1,146 @@
+/*==========================================================================================
+** options.cpp
+
+** Description:
+   Helpers for optional "--name value" command line flags.
+   See options.h.
+==============================================================================================*/
+
+
+#include "options.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+using namespace std;
+
+// Finds "--name value" in argv, removes both entries and returns the
+// value, or NULL if the flag is absent.
+static const char * takeOption(int & argc, char * argv[], const char * name)
+{
+  for (int i=1; i<argc; i++)
+    {
+      if ((argv[i][0] != '-') || (argv[i][1] != '-') || (strcmp(argv[i]+2, name) != 0))
+	continue;
+      if (i+1 >= argc)
+	{
+	  fprintf(stderr, "Option --%s requires a value\n", name);
+	  exit(1);
+	}
+      const char * value = argv[i+1];
+      for (int j=i; j+2<=argc; j++)
+	argv[j] = argv[j+2];
+      argc -= 2;
+      return value;
+    }
+  return NULL;
+}
+
+
+long extractLongOption(int & argc, char * argv[], const char * name, long defaultValue)
+{
+  const char * value = takeOption(argc, argv, name);
+  if (value == NULL)
+    return defaultValue;
+  return atol(value);
+}
+
+double extractDoubleOption(int & argc, char * argv[], const char * name, double defaultValue)
+{
+  const char * value = takeOption(argc, argv, name);
+  if (value == NULL)
+    return defaultValue;
+  return atof(value);
+}
+
+string extractStringOption(int & argc, char * argv[], const char * name, const char * defaultValue)
+{
+  const char * value = takeOption(argc, argv, name);
+  if (value == NULL)
+    return string(defaultValue);
+  return string(value);
+}
+
+
+static double parseSweepValue(const char * name, const char * text, char ** end)
+{
+  double v = strtod(text, end);
+  if (*end == text)
+    {
+      fprintf(stderr, "Invalid value \"%s\" for %s\n", text, name);
+      exit(1);
+    }
+  return v;
+}
+
+void addSweep(sweep_struct & S, const char * name, const char * arg, double & target)
+{
+  sweep_param P;
+  P.name = name;
+  P.target = &target;
+
+  char * end;
+  double first = parseSweepValue(name, arg, &end);
+  if (*end == ':')
+    {
+      double step = parseSweepValue(name, end+1, &end);
+      if (*end != ':')
+	{
+	  fprintf(stderr, "Range for %s must be start:step:stop\n", name);
+	  exit(1);
+	}
+      double last = parseSweepValue(name, end+1, &end);
+      if ((step == 0.0) || ((last - first)/step < 0.0))
+	{
+	  fprintf(stderr, "Step %g does not lead from %g to %g for %s\n", step, first, last, name);
+	  exit(1);
+	}
+      // Allow for rounding in the step so that stop itself is included:
+      long n = (long) floor((last - first)/step + 1e-9) + 1;
+      for (long k=0; k<n; k++)
+	P.values.push_back(first + k*step);
+    }
+  else
+    {
+      P.values.push_back(first);
+      while (*end == ',')
+	P.values.push_back(parseSweepValue(name, end+1, &end));
+    }
+  if (*end != '\0')
+    {
+      fprintf(stderr, "Invalid value \"%s\" for %s\n", arg, name);
+      exit(1);
+    }
+
+  target = P.values[0];
+  S.push_back(P);
+}
+
+long sweepPoints(const sweep_struct & S)
+{
+  long n = 1;
+  for (size_t k=0; k<S.size(); k++)
+    n *= S[k].values.size();
+  return n;
+}
+
+// The first registered parameter varies slowest.
+void sweepSelect(sweep_struct & S, long point)
+{
+  long total = sweepPoints(S);
+  long index = point;
+  for (size_t k=S.size(); k-- > 0; )
+    {
+      long n = S[k].values.size();
+      *S[k].target = S[k].values[index % n];
+      index /= n;
+    }
+  if (total == 1)
+    return;
+  printf("\n===== Sweep point %ld of %ld:", point+1, total);
+  for (size_t k=0; k<S.size(); k++)
+    if (S[k].values.size() > 1)
+      printf(" %s=%g", S[k].name.c_str(), *S[k].target);
+  printf(" =====\n");
+  fflush(stdout);
+}
@@ -0,0 +1,31 @@
+/* packCodewords
+   Converts a text codeword file (one codeword of '0' and '1'
+   characters per line, like the data.enc files in codes) to the packed
+   binary format that the simulators map directly. See codewords.h.
+*/
+
+
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+#include "codewords.h"
+
+using namespace std;
+
+
+int main(int argc, char * argv[])
+{
+  if (argc != 3)
+    {
+      cout << "Usage: " << argv[0] << " infile.enc outfile" << endl;
+      return 0;
+    }
+
+  int N = 0;
+  vector<uint8_t> rows;
+  long frames = packTextCodewords(argv[1], N, rows);
+  writePackedCodewords(argv[2], N, frames, rows);
+  cout << "Packed " << frames << " codewords of length " << N << " into " << argv[2]
+       << " (" << rows.size() << " bytes)" << endl;
+  return 0;
+}
@@ -0,0 +1,184 @@
+/*==========================================================================================
+** pipeline.cpp
+
+** Description:
+   Pipelined channel frame source. See pipeline.h.
+==============================================================================================*/
+
+
+#include "pipeline.h"
+#include "options.h"
+#include "rand_xoshiro.h"
+#include "rand_normal.h"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+static void producerLoop(frame_pipeline & P, int p);
+
+// Waiting threads yield for a while, then sleep, so that a spinning
+// thread does not starve the one it waits for when cores are scarce.
+static void backOff(int & spins)
+{
+  if (spins++ < 64)
+    this_thread::yield();
+  else
+    this_thread::sleep_for(chrono::microseconds(20));
+}
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+
+void makeChannelFrame(const channel_source & S, channel_frame & F)
+{
+  int i;
+  if (S.encoder != NULL)
+    randomCodeword(*S.encoder, ran_state, &F.acc[0], F.c);
+  else if (S.codewords != NULL)
+    {
+      const uint8_t * row = nextCodeword(*S.codewords);
+      for (i=0; i<S.N; i++)
+	F.c[i] = codewordBit(row, i) ? -1 : +1;
+    }
+
+  // Emulate AWGN transmission, drawing the deviates into y first:
+  double * y = &F.y[0];
+  F.logWeight = 0.0;
+  ran_normals(y, S.N);
+  for (i=0; i<S.N; i++)
+    y[i] = F.c[i]*(1.0+isNoise(S.channel, S.sigma, y[i], F.logWeight));
+}
+
+
+// A depth below 2 would leave a producer and its decoder taking turns.
+// Each ring has one producer, so producers beyond numThreads would
+// have no ring to fill.
+void extractPipeline(int & argc, char * argv[], int numThreads, int & producers, int & depth)
+{
+  producers = extractLongOption(argc, argv, "producers", 0);
+  depth = extractLongOption(argc, argv, "ring-depth", 4);
+  if ((producers < 0) || (producers > numThreads) || (depth < 2))
+    {
+      cerr << "Need 0 <= producers <= threads (" << numThreads << ") and ring-depth >= 2" << endl;
+      exit(1);
+    }
+}
+
+
+frame_pipeline::frame_pipeline(mc_engine & engine, const channel_source & S, int numProducers, int ringDepth, long ranSeed)
+  : mc(engine), source(S), depth(ringDepth), seed(ranSeed), rings(engine.numThreads), counters(numProducers)
+{
+  int words = (S.encoder != NULL) ? S.encoder->words : 1;
+  for (int t=0; t<mc.numThreads; t++)
+    {
+      rings[t].slots.resize(depth);
+      for (int k=0; k<depth; k++)
+	{
+	  channel_frame & F = rings[t].slots[k];
+	  F.c.assign(S.N, +1);
+	  F.y.assign(S.N, 0.0);
+	  F.acc.assign(words, 0);
+	  F.logWeight = 0.0;
+	}
+    }
+  for (int p=0; p<numProducers; p++)
+    {
+      counters[p].frames = 0;
+      counters[p].busySeconds = 0.0;
+      counters[p].waitSeconds = 0.0;
+    }
+  for (int p=0; p<numProducers; p++)
+    producers.push_back(thread(producerLoop, ref(*this), p));
+}
+
+
+// Fill every ring that has room, round robin, until the engine stops.
+static void producerLoop(frame_pipeline & P, int p)
+{
+  producer_counters & C = P.counters[p];
+  int numProducers = P.counters.size();
+  ran_stream(P.seed, P.mc.numThreads + p);
+  ran_normal_seed(P.seed, P.mc.numThreads + p);
+  int spins = 0;
+  while (!P.mc.stop.load(memory_order_relaxed))
+    {
+      bool filled = false;
+      for (int t=p; t<P.mc.numThreads; t+=numProducers)
+	{
+	  frame_ring & R = P.rings[t];
+	  long head = R.head.load(memory_order_relaxed);
+	  if (head - R.tail.load(memory_order_acquire) >= P.depth)
+	    continue;
+	  auto start = chrono::steady_clock::now();
+	  makeChannelFrame(P.source, R.slots[head % P.depth]);
+	  C.busySeconds += secondsSince(start);
+	  C.frames++;
+	  R.head.store(head + 1, memory_order_release);
+	  filled = true;
+	}
+      if (filled)
+	spins = 0;
+      else
+	{
+	  auto start = chrono::steady_clock::now();
+	  backOff(spins);
+	  C.waitSeconds += secondsSince(start);
+	}
+    }
+}
+
+
+channel_frame * pipelineAcquire(frame_pipeline & P, int tid)
+{
+  frame_ring & R = P.rings[tid];
+  long tail = R.tail.load(memory_order_relaxed);
+  if (R.head.load(memory_order_acquire) == tail)
+    {
+      auto start = chrono::steady_clock::now();
+      int spins = 0;
+      while (R.head.load(memory_order_acquire) == tail)
+	{
+	  if (P.mc.stop.load(memory_order_relaxed))
+	    return NULL;
+	  backOff(spins);
+	}
+      R.waitSeconds += secondsSince(start);
+    }
+  return &R.slots[tail % P.depth];
+}
+
+
+void pipelineRelease(frame_pipeline & P, int tid)
+{
+  frame_ring & R = P.rings[tid];
+  R.tail.store(R.tail.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+
+// The workers have been joined by mcRun(), so their wait times are
+// final once the producers are joined too.
+void pipelineStop(frame_pipeline & P)
+{
+  for (size_t p=0; p<P.producers.size(); p++)
+    P.producers[p].join();
+
+  long frames = 0;
+  double busy = 0.0, wait = 0.0, decoderWait = 0.0;
+  for (size_t p=0; p<P.counters.size(); p++)
+    {
+      frames += P.counters[p].frames;
+      busy += P.counters[p].busySeconds;
+      wait += P.counters[p].waitSeconds;
+    }
+  for (int t=0; t<P.mc.numThreads; t++)
+    decoderWait += P.rings[t].waitSeconds;
+
+  cout << "Channel stage: " << frames << " frames from " << P.counters.size() << " producers, "
+       << ((frames > 0) ? 1e6*busy/frames : 0.0) << " us per frame, "
+       << ((busy + wait > 0.0) ? 100.0*wait/(busy + wait) : 0.0) << "% of producer time waiting on full rings" << endl;
+  cout << "Decode stage: " << P.mc.numThreads << " workers waited " << decoderWait << " s in total on empty rings" << endl;
+}
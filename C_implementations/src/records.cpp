@@ -0,0 +1,254 @@
+/*==========================================================================================
+** records.cpp
+
+** Description:
+   Self-describing result records. See records.h.
+
+   The Makefile defines GIT_REVISION from "git describe" when this
+   file is compiled.
+==============================================================================================*/
+
+
+#include "records.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/resource.h>
+using namespace std;
+
+#ifndef GIT_REVISION
+#define GIT_REVISION "unknown"
+#endif
+
+
+static double cpuSeconds()
+{
+  struct rusage u;
+  getrusage(RUSAGE_SELF, &u);
+  return u.ru_utime.tv_sec + u.ru_stime.tv_sec + 1e-6*(u.ru_utime.tv_usec + u.ru_stime.tv_usec);
+}
+
+
+run_timer startTimer()
+{
+  run_timer T;
+  T.start = chrono::steady_clock::now();
+  T.cpuStart = cpuSeconds();
+  return T;
+}
+
+
+void recordString(result_record & R, const char * key, const string & value)
+{
+  R.keys.push_back(key);
+  R.values.push_back(value);
+  R.quoted.push_back(true);
+}
+
+
+// Non-finite values (e.g. a rate over zero frames) become JSON nulls.
+void recordNumber(result_record & R, const char * key, double value)
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.10g", value);
+  R.keys.push_back(key);
+  R.values.push_back(isfinite(value) ? buf : "null");
+  R.quoted.push_back(false);
+}
+
+
+void recordCount(result_record & R, const char * key, long value)
+{
+  R.keys.push_back(key);
+  R.values.push_back(to_string(value));
+  R.quoted.push_back(false);
+}
+
+
+// Usage names such as "[codeword filename|random|gen file]" are cut
+// down to their first word.
+static string fieldName(const string & name)
+{
+  size_t start = (name[0] == '[') ? 1 : 0;
+  size_t end = name.find_first_of(" |]", start);
+  return name.substr(start, (end == string::npos) ? string::npos : end - start);
+}
+
+
+static bool isNumber(const char * s)
+{
+  char * end;
+  double v = strtod(s, &end);
+  return (*s != '\0') && (*end == '\0') && isfinite(v);
+}
+
+
+void recordHeader(result_record & R, const char * program, long seed, int threads)
+{
+  char host[256] = "unknown";
+  gethostname(host, sizeof(host) - 1);
+  char when[32];
+  time_t now = time(0);
+  strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  const char * base = strrchr(program, '/');
+
+  recordString(R, "program", base ? base+1 : program);
+  recordString(R, "revision", GIT_REVISION);
+  recordString(R, "host", host);
+  recordString(R, "time", when);
+  recordCount(R, "seed", seed);
+  recordCount(R, "threads", threads);
+}
+
+
+void recordRun(result_record & R, int argc, char * argv[], const vector<string> & names,
+	       const sweep_struct & sweep, long seed, int threads)
+{
+  recordHeader(R, argv[0], seed, threads);
+  for (int i=1; (i<argc) && (i-1 < (int) names.size()); i++)
+    {
+      string key = fieldName(names[i-1]);
+      bool swept = false;
+      for (size_t k=0; k<sweep.size(); k++)
+	if (sweep[k].name == key)
+	  {
+	    recordNumber(R, key.c_str(), *sweep[k].target);
+	    swept = true;
+	  }
+      if (!swept)
+	{
+	  R.keys.push_back(key);
+	  R.values.push_back(argv[i]);
+	  R.quoted.push_back(!isNumber(argv[i]));
+	}
+    }
+}
+
+
+// The weighted sums equal the plain counts unless importance sampling
+// is on, so ber and fer are the estimates either way.
+void recordTotals(result_record & R, const frame_totals & t, const run_timer & T)
+{
+  double wall = chrono::duration<double>(chrono::steady_clock::now() - T.start).count();
+  double cpu = cpuSeconds() - T.cpuStart;
+
+  recordCount(R, "frames", t.totalWords);
+  recordCount(R, "frame_errors", t.wordErrors);
+  recordCount(R, "bits", t.totalBits);
+  recordCount(R, "bit_errors", t.errors);
+  recordCount(R, "uncoded_bit_errors", t.uncodedErrors);
+  recordCount(R, "iterations", t.totalIterations);
+  recordNumber(R, "ber", t.weightedErrors/t.totalBits);
+  recordNumber(R, "fer", t.weightedWordErrors/t.totalWords);
+  recordNumber(R, "uncoded_ber", (double) t.uncodedErrors/t.totalBits);
+  recordNumber(R, "avg_iterations", (double) t.totalIterations/t.totalWords);
+  recordNumber(R, "wall_s", wall);
+  recordNumber(R, "cpu_s", cpu);
+  recordNumber(R, "frames_per_s", t.totalWords/wall);
+  recordNumber(R, "iterations_per_s", t.totalIterations/wall);
+}
+
+
+static string csvField(const string & s)
+{
+  if (s.find_first_of(",\"\n\r") == string::npos)
+    return s;
+  string q = "\"";
+  for (size_t i=0; i<s.size(); i++)
+    {
+      if (s[i] == '"')
+	q += '"';
+      q += s[i];
+    }
+  return q + "\"";
+}
+
+
+static string jsonString(const string & s)
+{
+  string q = "\"";
+  for (size_t i=0; i<s.size(); i++)
+    {
+      unsigned char ch = s[i];
+      if ((ch == '"') || (ch == '\\'))
+	{
+	  q += '\\';
+	  q += ch;
+	}
+      else if (ch < 0x20)
+	{
+	  char buf[8];
+	  snprintf(buf, sizeof(buf), "\\u%04x", ch);
+	  q += buf;
+	}
+      else
+	q += ch;
+    }
+  return q + "\"";
+}
+
+
+// Returns the file's first line, without its newline.
+static string firstLine(int fd)
+{
+  string line;
+  char buf[4096];
+  ssize_t n;
+  off_t offset = 0;
+  while ((n = pread(fd, buf, sizeof(buf), offset)) > 0)
+    {
+      char * nl = (char *) memchr(buf, '\n', n);
+      line.append(buf, nl ? nl - buf : n);
+      if (nl)
+	break;
+      offset += n;
+    }
+  return line;
+}
+
+
+void writeResultRecord(const string & fileName, const result_record & R)
+{
+  bool csv = (fileName.size() > 4) && (fileName.compare(fileName.size()-4, 4, ".csv") == 0);
+  string header, line;
+  for (size_t k=0; k<R.keys.size(); k++)
+    {
+      if (csv)
+	{
+	  header += (k ? "," : "") + csvField(R.keys[k]);
+	  line += (k ? "," : "") + csvField(R.values[k]);
+	}
+      else
+	line += (k ? ", " : "{") + jsonString(R.keys[k]) + ": "
+	  + (R.quoted[k] ? jsonString(R.values[k]) : R.values[k]);
+    }
+  line += csv ? "\n" : "}\n";
+
+  int fd = open(fileName.c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+  if ((fd < 0) || (flock(fd, LOCK_EX) != 0))
+    {
+      fprintf(stderr, "Cannot open results file %s\n", fileName.c_str());
+      if (fd >= 0)
+	close(fd);
+      return;
+    }
+  if (csv)
+    {
+      if (lseek(fd, 0, SEEK_END) == 0)
+	line = header + "\n" + line;
+      else if (firstLine(fd) != header)
+	{
+	  fprintf(stderr, "%s has different columns; result record not written\n", fileName.c_str());
+	  close(fd);
+	  return;
+	}
+    }
+  if (write(fd, line.data(), line.size()) != (ssize_t) line.size())
+    fprintf(stderr, "Cannot write results file %s\n", fileName.c_str());
+  close(fd);
+}
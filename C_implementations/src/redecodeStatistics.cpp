@@ -43,6 +43,7 @@ using namespace std;
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
 #include "rand.h"
+#include "tanner.h"
 
 
 //============ GLOBAL PARAMETERS ============//
@@ -59,9 +60,9 @@ int    NR = 100;
 int    NF = 30000;
 
 //============ DECODING ALGORITHM PREDEFINES ===============//
-void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied);
-void symNodeUpdates(alist_struct &H, vector<double> &  thetas, double & lambda, int & mu,  vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation);
-double evaluateObjectiveFunction(alist_struct &H, vector<int> & d, vector<double> & y, vector<int> & check_to_sym); 
+void checkNodeUpdates(tanner_struct &G, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied);
+void symNodeUpdates(tanner_struct &G, vector<double> &  thetas, double & lambda, int & mu,  vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation);
+double evaluateObjectiveFunction(tanner_struct &G, vector<int> & d, vector<double> & y, vector<int> & check_to_sym); 
 
 //============= SUPPORTING FUNCTION PREDEFINES =================//
 int find(int symNodes[], int len, int snode);
@@ -121,7 +122,7 @@ int main(int argc, char * argv[])
 
   // Parse command arguments:
   int idx=1;
-  alist_struct H = loadFile(argv[idx++]);
+  tanner_struct G = loadTanner(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
   double R = atof(argv[idx++]);
   cout << " R = \t" << R << endl;
@@ -173,29 +174,29 @@ int main(int argc, char * argv[])
   double sigma = sqrt(N0/2.0);
 
   // Get code parameters:
-  int dv = H.biggest_num_n;
-  int dc = H.biggest_num_m;
+  int dv = G.biggest_dv;
+  int dc = G.biggest_dc;
 
   // Report initial status messages:
-  cout << "Simulating GDBF decoding on code with N=" << H.N << ", M=" << H.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
+  cout << "Simulating GDBF decoding on code with N=" << G.N << ", M=" << G.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
   cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
 
 
   // Declare top-level variables:
-  vector<int>    c(H.N,1);     // Bipolar codeword (all +1 in this simulation)
-  vector<double> x(H.N,1);     // Modulated codeword (all +1 in this simulation)
+  vector<int>    c(G.N,1);     // Bipolar codeword (all +1 in this simulation)
+  vector<double> x(G.N,1);     // Modulated codeword (all +1 in this simulation)
   vector<double> y(x);          // Channel samples
-  vector<double> yq(H.N);       // Quantized channel samples
-  vector<int>    r(H.N);        // Received bipolar decisions (+1 or -1)
-  vector<int>    d(H.N,0);      // Decoder outputs (+1 or -1 after decoding)
+  vector<double> yq(G.N);       // Quantized channel samples
+  vector<int>    r(G.N);        // Received bipolar decisions (+1 or -1)
+  vector<int>    d(G.N,0);      // Decoder outputs (+1 or -1 after decoding)
 
 #ifdef outputSmoothing
-  vector<int> dsum(H.N,0);
+  vector<int> dsum(G.N,0);
   int smoothingUsed = 0;
 #endif
 
-  vector<double> perturbation(H.N,0.0);
-  vector<double> noiseSamples(H.N,0.0);
+  vector<double> perturbation(G.N,0.0);
+  vector<double> noiseSamples(G.N,0.0);
 
   // Declare and initialize statistics variables:
   long errors = 0;            // Total bit errors
@@ -204,11 +205,11 @@ int main(int argc, char * argv[])
   long totalWords = 0;        // Total number of frames observed
   long wordErrors = 0;        // Number of word errors observed
   long totalIterations = 0;   // Total number of iterations accumulated over all frames.
-  vector<int> error_weight_hist(H.N,0);  // Vector to serve as histogram of error-pattern weights (1 up to H.N)
-  vector<double> thetas(H.N,theta);
+  vector<int> error_weight_hist(G.N,0);  // Vector to serve as histogram of error-pattern weights (1 up to G.N)
+  vector<double> thetas(G.N,theta);
 
   // Declare and initialize message memories:
-  vector<int> check_to_sym(H.M,0);
+  vector<int> check_to_sym(G.M,0);
 
   /////////////////////////////////////////////////////////////////
   // ------===== MAIN TEST LOOP =====-------
@@ -228,7 +229,7 @@ int main(int argc, char * argv[])
 	      codewordFile.seekg(0);
 	      getline(codewordFile, s);
 	    }
-	  for (i=0; i<H.N; i++)
+	  for (i=0; i<G.N; i++)
 	    {	    
 	      if (s[i] == '1')	      
 		c[i] = -1;
@@ -240,7 +241,7 @@ int main(int argc, char * argv[])
 	    }
 	}
       // Emulate AWGN transmission      
-      for (i=0; i<H.N; i++)
+      for (i=0; i<G.N; i++)
 	{
 	  y[i] = x[i]*(1.0+sigma*rann());
 	  yq[i] = y[i];
@@ -271,7 +272,7 @@ int main(int argc, char * argv[])
       while (phase<NR) {	
 	// Reset initial state:
 	// Note that the noise perturbation state is not reset
-	for (int i=0; i<H.N; i++)
+	for (int i=0; i<G.N; i++)
 	  {
 	    d[i] = r[i];
 #ifdef outputSmoothing
@@ -293,7 +294,7 @@ int main(int argc, char * argv[])
 #endif
 
 #ifdef thresholdAdaptation
-	for (int i=0; i<H.N; i++)
+	for (int i=0; i<G.N; i++)
 	  thetas[i] = theta;
 #endif
 
@@ -305,14 +306,14 @@ int main(int argc, char * argv[])
 	  
 	  
 	    // First update the check nodes:
-	    checkNodeUpdates(H,d,check_to_sym,satisfied);
+	    checkNodeUpdates(G,d,check_to_sym,satisfied);
 	    if (satisfied)
 	      break;
 
 	  
 #ifdef modeswitching
 	    if (it > Tswitch)
-	      f1 = evaluateObjectiveFunction(H,d,yq,check_to_sym);	    
+	      f1 = evaluateObjectiveFunction(G,d,yq,check_to_sym);	    
 #endif 
 	  
 
@@ -320,7 +321,7 @@ int main(int argc, char * argv[])
 	    // Then perform Symbol node updates:
 	  
 #ifdef addNoise
-	    for (int i=0; i<H.N; i++)
+	    for (int i=0; i<G.N; i++)
 	      {
 #ifdef uniformNoise
 		double newSample = sqrt(3)*noiseSigma*2.0*(ranu()-0.5);
@@ -337,12 +338,12 @@ int main(int argc, char * argv[])
 #endif
 	  
 
-	    symNodeUpdates(H,thetas,lambda, mu, yq, d,check_to_sym, noiseSigma, perturbation); 
+	    symNodeUpdates(G,thetas,lambda, mu, yq, d,check_to_sym, noiseSigma, perturbation); 
 	  
 #ifdef modeswitching
 	    if (it > Tswitch)
 	      {
-		f2 = evaluateObjectiveFunction(H,d,yq,check_to_sym);
+		f2 = evaluateObjectiveFunction(G,d,yq,check_to_sym);
 		if (f1 >= f2)
 		  mu = 0;
 		//cout << "\tf2=" << f2 << "\t mu=" << mu << endl;
@@ -352,7 +353,7 @@ int main(int argc, char * argv[])
 #ifdef outputSmoothing
 	    if (it > num_iterations-windowsize)
 	      {
-		for (int i=0; i<H.N; i++)
+		for (int i=0; i<G.N; i++)
 		  dsum[i] += d[i];
 	      }
 #endif
@@ -361,7 +362,7 @@ int main(int argc, char * argv[])
       
 #ifdef outputSmoothing
 	if (!satisfied)
-	  for (int i=0; i<H.N; i++)
+	  for (int i=0; i<G.N; i++)
 	    {
 	      if (dsum[i] > 0)
 		d[i] = 1;
@@ -410,7 +411,7 @@ int main(int argc, char * argv[])
 
       // Increment frame and bit counters:
       totalWords++;
-      totalBits += H.N;
+      totalBits += G.N;
       totalIterations += it;
       
       // ------------------------------------------------
@@ -512,17 +513,16 @@ void printErroneousMessages(vector<vector<int> > v)
     }
 }
 
-void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied)
+void checkNodeUpdates(tanner_struct &G, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied)
 {
   int msg;
   satisfied = true;
-  for (int i=0; i<H.M; i++)
+  for (int i=0; i<G.M; i++)
     {
       int prod = 1;
-      for (int j=0; j<H.num_mlist[i]; j++)
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
 	{
-	  int snode = H.mlist[i][j]-1;
-	  msg = sym_to_check[snode];
+	  msg = sym_to_check[G.check_sym[e]];
 	  prod *= msg;
 	}
       if (prod < 0)
@@ -531,27 +531,26 @@ void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> &
     }
 }
 
-void symNodeUpdates(alist_struct &H, vector<double> & thetas, double & lambda, int & mu, vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation)
+void symNodeUpdates(tanner_struct &G, vector<double> & thetas, double & lambda, int & mu, vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation)
 {
-  vector<double> E(H.N,0.0);
+  vector<double> E(G.N,0.0);
   double Emin = INFINITY;
   int mindx = -1;
   double w = 1;
   
-  for (int i=0; i<H.N; i++)
+  for (int i=0; i<G.N; i++)
     {
       bool flip = false;
       E[i] = d[i]*y[i];
 
 #ifdef weightSyndromes
-      int dv = H.num_nlist[i];
+      int dv = G.sym_start[i+1]-G.sym_start[i];
       w = alpha*Ymax/dv;
 #endif
 
-      for (int j=0; j<H.num_nlist[i]; j++)
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
 	{
-	  int cnode = H.nlist[i][j]-1;
-	  int msg = check_to_sym[cnode];
+	  int msg = check_to_sym[G.sym_check[k]];
 	  E[i] += w*msg;	  
 	}      
 #ifdef addNoise
@@ -581,12 +580,12 @@ void symNodeUpdates(alist_struct &H, vector<double> & thetas, double & lambda, i
 }
 
 
-double evaluateObjectiveFunction(alist_struct &H, vector<int> & d, vector<double> & y, vector<int> & check_to_sym)
+double evaluateObjectiveFunction(tanner_struct &G, vector<int> & d, vector<double> & y, vector<int> & check_to_sym)
 {
   double f = 0;
-  for (int i=0; i<H.N; i++)
+  for (int i=0; i<G.N; i++)
     f += d[i]*y[i];
-  for (int j=0; j<H.M; j++)
+  for (int j=0; j<G.M; j++)
     f += check_to_sym[j];
 
   return f;
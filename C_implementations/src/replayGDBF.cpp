@@ -41,7 +41,9 @@ using namespace std;
 
 //--- Borrowed from Radford Neal's source code ---//
 #include "alist.h"
-#include "rand_gsl.h"
+#include "rand_philox.h"
+#include "tanner.h"
+#include "codewords.h"
 
 
 //============ GLOBAL PARAMETERS ============//
@@ -62,14 +64,14 @@ char timeString[80];
 
 
 //============ DECODING ALGORITHM PREDEFINES ===============//
-void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied);
-void symNodeUpdates(alist_struct &H, vector<double> &  thetas, double & lambda, int & mu,  vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation);
-double evaluateObjectiveFunction(alist_struct &H, vector<int> & d, vector<double> & y, vector<int> & check_to_sym); 
+void checkNodeUpdates(tanner_struct &G, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied);
+void symNodeUpdates(tanner_struct &G, vector<double> &  thetas, double & lambda, int & mu,  vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation);
+double evaluateObjectiveFunction(tanner_struct &G, vector<int> & d, vector<double> & y, vector<int> & check_to_sym); 
 
 
 //============= SUPPORTING FUNCTION PREDEFINES =================//
 int find(int symNodes[], int len, int snode);
-int countDecisionErrors(vector<int> d, vector<int> c);
+int countDecisionErrors(const vector<int> & d, const vector<int> & c);
 
 
 //============= I/O PREDEFINES ============================//
@@ -80,8 +82,6 @@ void printVector(vector<double> v);
 void printErroneousMessages(vector<vector<int> > v);
 void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check_to_sym, vector<vector<int> > & sym_to_check, vector<int> & c, vector<int> & d, int fid);
 void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check_to_sym, vector<vector<int> > & sym_to_check, vector<int> & c, vector<int> & d, vector<double> & y, vector<int> & yq, vector<int> & r, int fid, int it);
-void recordRanState(int framenum, const gsl_rng * r);
-int loadRanState(string fname, gsl_rng * r);
 
 
 
@@ -97,7 +97,8 @@ int main(int argc, char * argv[])
   command_arguments.push_back("T");
   command_arguments.push_back("NR");
   command_arguments.push_back("theta");
-  command_arguments.push_back("statefilename");
+  command_arguments.push_back("seed");
+  command_arguments.push_back("frame");
   command_arguments.push_back("logfilename");
 #ifdef addNoise
   command_arguments.push_back("noiseScale");
@@ -131,7 +132,7 @@ int main(int argc, char * argv[])
 
   // Parse command arguments:
   int idx=1;
-  alist_struct H = loadFile(argv[idx++]);
+  tanner_struct G = loadTanner(argv[idx++]);
   cout << "PARAMETERS: \n alist = \t" << argv[1] << endl;
   double R = atof(argv[idx++]);
   cout << " R = \t" << R << endl;
@@ -143,8 +144,10 @@ int main(int argc, char * argv[])
   cout << " NR = \t" << NR << endl;
   theta = atof(argv[idx++]);
   cout << " theta = \t" << theta << endl;
-  string statefilename(argv[idx++]);
-  cout << " state = \t" << statefilename << endl;
+  long seed = atol(argv[idx++]);
+  cout << " seed = \t" << seed << endl;
+  long frame = atol(argv[idx++]);
+  cout << " frame = \t" << frame << endl;
   string logfilename(argv[idx++]);
   cout << " log = \t" << logfilename << endl;
 
@@ -172,11 +175,11 @@ int main(int argc, char * argv[])
   //maxphase = atoi(argv[idx++]);
   //cout << " maxphase = \t" << maxphase << endl;
 //#endif
-  ifstream codewordFile;
+  codeword_stream codewords;
   if (argc == command_arguments.size()+1)
     {
       cout << "\nUsing codewords from " << argv[idx] << endl;
-      codewordFile.open(argv[idx],ios::in);
+      openCodewords(codewords, argv[idx], G.N);
     }
   else
     cout << "\nUsing all-zero sequence.\n";
@@ -194,32 +197,32 @@ int main(int argc, char * argv[])
   double sigma = sqrt(N0/2.0);
 
   // Get code parameters:
-  int dv = H.biggest_num_n;
-  int dc = H.biggest_num_m;
+  int dv = G.biggest_dv;
+  int dc = G.biggest_dc;
 
   // Report initial status messages:
-  cout << "Simulating GDBF decoding on code with N=" << H.N << ", M=" << H.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
+  cout << "Simulating GDBF decoding on code with N=" << G.N << ", M=" << G.M << ", R=" << R << ", dv=" << dv << ", dc=" << dc << endl;
   cout << "\nParameters are:\n\tSNR\t" << SNR << "\n\tN0\t" << N0 << "\n\tsigma\t" << sigma << endl;
 
 
   // Declare top-level variables:
-  vector<int>    c(H.N,1);     // Bipolar codeword (all +1 in this simulation)
-  vector<double> x(H.N,1);     // Modulated codeword (all +1 in this simulation)
+  vector<int>    c(G.N,1);     // Bipolar codeword (all +1 in this simulation)
+  vector<double> x(G.N,1);     // Modulated codeword (all +1 in this simulation)
   vector<double> y(x);          // Channel samples
-  vector<double> yq(H.N);       // Quantized channel samples
-  vector<int>    r(H.N);        // Received bipolar decisions (+1 or -1)
-  vector<int>    d(H.N,0);      // Decoder outputs (+1 or -1 after decoding)
+  vector<double> yq(G.N);       // Quantized channel samples
+  vector<int>    r(G.N);        // Received bipolar decisions (+1 or -1)
+  vector<int>    d(G.N,0);      // Decoder outputs (+1 or -1 after decoding)
 
 #ifdef outputSmoothing
-  vector<int> dsum(H.N,0);
+  vector<int> dsum(G.N,0);
   int smoothingUsed = 0;
 #endif
 //#ifdef redecode	
   int a,a1,a2,phase;
   vector<int> phase_hist(maxphase,0);  // Histogram for redecode phases
 //#endif
-  vector<double> perturbation(H.N,0.0);
-  vector<double> noiseSamples(H.N,0.0);
+  vector<double> perturbation(G.N,0.0);
+  vector<double> noiseSamples(G.N,0.0);
 
   // Declare and initialize statistics variables:
   long errors = 0;            // Total bit errors
@@ -228,51 +231,36 @@ int main(int argc, char * argv[])
   long totalWords = 0;        // Total number of frames observed
   long wordErrors = 0;        // Number of word errors observed
   long totalIterations = 0;   // Total number of iterations accumulated over all frames.
-  vector<int> error_weight_hist(H.N,0);  // Vector to serve as histogram of error-pattern weights (1 up to H.N)
-  vector<double> thetas(H.N,theta);
+  vector<int> error_weight_hist(G.N,0);  // Vector to serve as histogram of error-pattern weights (1 up to G.N)
+  vector<double> thetas(G.N,theta);
 
   // NOTE: Could also do a histogram of the iteration count. It might be interesting.
 
   // Declare and initialize message memories:
-  vector<int> check_to_sym(H.M,0);
+  vector<int> check_to_sym(G.M,0);
 
   /////////////////////////////////////////////////////////////////
   // ------===== MAIN TEST LOOP =====-------
   /////////////////////////////////////////////////////////////////
   int minWordErrors = 20;
-  if (H.N > 10000) minWordErrors = 10;
-  if (H.N > 50000) minWordErrors = 5;
-  ran_seed(time(0)); //(134159);
+  if (G.N > 10000) minWordErrors = 10;
+  if (G.N > 50000) minWordErrors = 5;
+  // Regenerate the noise that redecodeStatistics drew for this frame:
+  ran_seed(seed);
   int i,j;
-  int framenum=0;
+  int framenum=frame;
   //while ((errors < 200) || (wordErrors < minWordErrors))
   //    while (totalWords < NF)
     {
-      int ready = loadRanState(statefilename, rng_engine);
-      if (ready!=0)
+      ran_frame(framenum, 0, 0);
+      // If a codeword file is specified, take the frame's codeword,
+      // cycling through the file as redecodeStatistics does:
+      if (codewords.frames > 0)
 	{
-	  cout << "Failed to load ran state.\n";
-	  return 1;
-	}
-      string s;
-      // If a codeword file is specified, load codewords from the file:
-      if (argc == command_arguments.size()+1)
-	{
-	  getline(codewordFile, s);
-	  if (codewordFile.eof())
+	  const uint8_t * row = codewordRow(codewords, frame);
+	  for (i=0; i<G.N; i++)
 	    {
-	      codewordFile.clear();
-	      codewordFile.seekg(0);
-	      getline(codewordFile, s);
-	    }
-	  for (i=0; i<H.N; i++)
-	    {	    
-	      if (s[i] == '1')	      
-		c[i] = -1;
-	      else if (s[i] == '0')
-		c[i] = +1;
-	      else
-		cout << "Got an invalid symbol at index " << i << endl;
+	      c[i] = codewordBit(row, i) ? -1 : +1;
 	      x[i] = c[i];
 	    }
 	}
@@ -282,7 +270,7 @@ int main(int argc, char * argv[])
       int newErrors;
 
       // Emulate AWGN transmission      
-      for (i=0; i<H.N; i++)
+      for (i=0; i<G.N; i++)
 	{
 	  y[i] = x[i]*(1.0+sigma*rann());
 
@@ -316,7 +304,7 @@ int main(int argc, char * argv[])
 	  ss << "tmp/" << timeString  << "_" << logfilename << "_" << phase << ".trace";
 	  ofstream tracefile(ss.str().c_str(),ios::out);
 
-	  for (i=0; i<H.N; i++)
+	  for (i=0; i<G.N; i++)
 	    {
 	      d[i]=r[i];
 #ifdef outputSmoothing
@@ -327,7 +315,7 @@ int main(int argc, char * argv[])
 	  int mu=1;
 
 #ifdef thresholdAdaptation
-	  for (int i=0; i<H.N; i++)
+	  for (int i=0; i<G.N; i++)
 	    thetas[i] = theta;
 #endif
 
@@ -342,14 +330,15 @@ int main(int argc, char * argv[])
 	  
 	  
 		// First update the check nodes:
-		checkNodeUpdates(H,d,check_to_sym,satisfied);
+		checkNodeUpdates(G,d,check_to_sym,satisfied);
 		if (satisfied)
 		  break;
 
 		// Then perform Symbol node updates:
 	  
 #ifdef addNoise
-		for (int i=0; i<H.N; i++)
+		ran_frame(framenum, phase+1, it);
+		for (int i=0; i<G.N; i++)
 		  {
 		    double newSample = noiseSigma*rann();
 		    perturbation[i] = newSample;
@@ -357,13 +346,13 @@ int main(int argc, char * argv[])
 #endif
 	  
 
-		symNodeUpdates(H,thetas,lambda, mu, yq, d,check_to_sym, noiseSigma, perturbation); 
+		symNodeUpdates(G,thetas,lambda, mu, yq, d,check_to_sym, noiseSigma, perturbation); 
 	  
 
 #ifdef outputSmoothing
 		if (it > num_iterations-windowsize)
 		  {
-		    for (int i=0; i<H.N; i++)
+		    for (int i=0; i<G.N; i++)
 		      dsum[i] += d[i];
 		  }
 #endif
@@ -377,7 +366,7 @@ int main(int argc, char * argv[])
 
 #ifdef outputSmoothing
 	  if (!satisfied)
-	    for (int i=0; i<H.N; i++)
+	    for (int i=0; i<G.N; i++)
 	      {
 		if (dsum[i] > 0)
 		  d[i] = 1;
@@ -437,12 +426,12 @@ int main(int argc, char * argv[])
 
 
       // Increment frame and bit counters:
-      totalBits += H.N; 
+      totalBits += G.N; 
       //      totalIterations += it;
       totalWords++;
       // ------------------------------------------------
       // Give a status message every 100 frames
-      int reportInterval = round(100e3/H.N);
+      int reportInterval = round(100e3/G.N);
       if ((totalWords % reportInterval) == 0)
 	{
 	  cout << "\nIncremental result: " << errors << " bit errs in " << totalWords << " words, BER=" << (double)errors/totalBits 
@@ -521,7 +510,7 @@ void printHistogram(vector<int> & h)
     }
 }
 
-int countDecisionErrors(vector<int> d, vector<int> c)
+int countDecisionErrors(const vector<int> & d, const vector<int> & c)
 {
   int errs =0 ;
   for (int i=0; i<d.size(); i++)
@@ -549,17 +538,16 @@ void printErroneousMessages(vector<vector<int> > v)
     }
 }
 
-void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied)
+void checkNodeUpdates(tanner_struct &G, vector<int> & sym_to_check, vector<int> & check_to_sym, bool & satisfied)
 {
   int msg;
   satisfied = true;
-  for (int i=0; i<H.M; i++)
+  for (int i=0; i<G.M; i++)
     {
       int prod = 1;
-      for (int j=0; j<H.num_mlist[i]; j++)
+      for (int e=G.check_start[i]; e<G.check_start[i+1]; e++)
 	{
-	  int snode = H.mlist[i][j]-1;
-	  msg = sym_to_check[snode];
+	  msg = sym_to_check[G.check_sym[e]];
 	  prod *= msg;
 	}
       if (prod < 0)
@@ -568,42 +556,40 @@ void checkNodeUpdates(alist_struct &H, vector<int> & sym_to_check, vector<int> &
     }
 }
 
-void symNodeUpdates(alist_struct &H, vector<double> & thetas, double & lambda, int & mu, vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation)
+void symNodeUpdates(tanner_struct &G, vector<double> & thetas, double & lambda, int & mu, vector<double> & y, vector<int> & d, vector<int> & check_to_sym, double & sigma, vector<double> & perturbation)
 {
-  vector<double> E(H.N,0.0);
   double Emin = INFINITY;
   int mindx = -1;
   double w = 1;
   
-  for (int i=0; i<H.N; i++)
+  for (int i=0; i<G.N; i++)
     {
       bool flip = false;
-      E[i] = d[i]*y[i];
+      double E = d[i]*y[i];
 
 #ifdef weightSyndromes
-      int dv = H.num_nlist[i];
+      int dv = G.sym_start[i+1]-G.sym_start[i];
       w = alpha*Ymax/dv;
 #endif
 
-      for (int j=0; j<H.num_nlist[i]; j++)
+      for (int k=G.sym_start[i]; k<G.sym_start[i+1]; k++)
 	{
-	  int cnode = H.nlist[i][j]-1;
-	  int msg = check_to_sym[cnode];
-	  E[i] += w*msg;	  
+	  int msg = check_to_sym[G.sym_check[k]];
+	  E += w*msg;	  
 	}      
 #ifdef addNoise
-      E[i] += perturbation[i]; //sigma*rann();
+      E += perturbation[i]; //sigma*rann();
 #endif
-      if ((mu == 1) && (E[i] < thetas[i]))
+      if ((mu == 1) && (E < thetas[i]))
 	{
 	  flip = true;
 	  d[i] = -d[i];      	    
 	}
       if (mu == 0)	
-	if (E[i] < Emin)
+	if (E < Emin)
 	  {
 	    flip = true;
-	    Emin = E[i];
+	    Emin = E;
 	    mindx = i;
 	  }	
 #ifdef thresholdAdaptation
@@ -618,12 +604,12 @@ void symNodeUpdates(alist_struct &H, vector<double> & thetas, double & lambda, i
 }
 
 
-double evaluateObjectiveFunction(alist_struct &H, vector<int> & d, vector<double> & y, vector<int> & check_to_sym)
+double evaluateObjectiveFunction(tanner_struct &G, vector<int> & d, vector<double> & y, vector<int> & check_to_sym)
 {
   double f = 0;
-  for (int i=0; i<H.N; i++)
+  for (int i=0; i<G.N; i++)
     f += d[i]*y[i];
-  for (int j=0; j<H.M; j++)
+  for (int j=0; j<G.M; j++)
     f += check_to_sym[j];
 
   return f;
@@ -756,24 +742,3 @@ void writeErroneousMessagesToFile(alist_struct & H, vector<vector<int> > & check
 #endif
 }
 
-
-void recordRanState(int framenum, const gsl_rng * r)
-{
-  stringstream ss("");
-  ss << "tmp/" << timeString  << "_RanState_" << framenum << ".state";
-  FILE * state = fopen(ss.str().c_str(),"w+");
-  
-  gsl_rng_fwrite (state, r);
-  fclose(state);
-}
-
-
-int loadRanState(string fname, gsl_rng * r)
-{
-  FILE * state = fopen(fname.c_str(),"r");
-  
-  int outcome;
-  outcome = gsl_rng_fread(state, r);
-  fclose(state);
-  return outcome;
-}
@@ -0,0 +1,109 @@
+/*==========================================================================================
+** simdms.cpp
+
+** Description:
+   Frame-parallel fixed-point min-sum engine: buffers, run-time
+   kernel selection and the baseline (generic) kernel. See simdms.h.
+==============================================================================================*/
+
+
+#define SIMDMS_ITERATION simdmsIterationGeneric
+#define SIMDMS_WIDTH     16
+#include "simdms_kernel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static int8_t * allocRows(int rows)
+{
+  void * p = aligned_alloc(64, (size_t)rows*SIMDMS_LANES);
+  if (p == NULL)
+    {
+      fprintf(stderr, "allocSimdFrames: out of memory\n");
+      exit(1);
+    }
+  memset(p, 0, (size_t)rows*SIMDMS_LANES);
+  return (int8_t *) p;
+}
+
+
+simdms_frames allocSimdFrames(tanner_struct & G)
+{
+  simdms_frames F;
+  F.ch   = allocRows(G.N);
+  F.c2v  = allocRows(G.E);
+  F.v2c  = allocRows(G.E);
+  F.d    = allocRows(G.N);
+  F.par  = allocRows(G.M);
+  F.done = allocRows(1);
+  return F;
+}
+
+
+void freeSimdFrames(simdms_frames & F)
+{
+  free(F.ch);
+  free(F.c2v);
+  free(F.v2c);
+  free(F.d);
+  free(F.par);
+  free(F.done);
+}
+
+
+// Starts a new batch from the channel LLRs in F.ch: the symbols send
+// their channel values, the decisions are the received hard
+// decisions and no lane is frozen.
+void initSimdFrames(tanner_struct & G, simdms_frames & F)
+{
+  for (int e=0; e<G.E; e++)
+    memcpy(F.v2c + (size_t)e*SIMDMS_LANES, F.ch + (size_t)G.check_sym[e]*SIMDMS_LANES, SIMDMS_LANES);
+  for (size_t n=0; n<(size_t)G.N*SIMDMS_LANES; n++)
+    F.d[n] = (F.ch[n] <= 0) ? -1 : 0;
+  memset(F.done, 0, SIMDMS_LANES);
+}
+
+
+bool simdIsaSupported(const char * isa)
+{
+  __builtin_cpu_init();
+  if (strcmp(isa, "avx512") == 0)
+    return __builtin_cpu_supports("avx512bw");
+  if (strcmp(isa, "avx2") == 0)
+    return __builtin_cpu_supports("avx2");
+  if (strcmp(isa, "sse41") == 0)
+    return __builtin_cpu_supports("sse4.1");
+  return strcmp(isa, "generic") == 0;
+}
+
+
+// Kernels in order of preference. An empty or NULL isa takes the
+// first one the CPU supports; a named one must also be supported.
+simdms_kernel selectSimdKernel(const char * isa)
+{
+  const int num_kernels = 4;
+  simdms_kernel kernels[num_kernels] = {
+    { "avx512",  simdmsIterationAVX512 },
+    { "avx2",    simdmsIterationAVX2 },
+    { "sse41",   simdmsIterationSSE41 },
+    { "generic", simdmsIterationGeneric }
+  };
+
+  bool any = (isa == NULL) || (isa[0] == '\0');
+  for (int k=0; k<num_kernels; k++)
+    {
+      if (!any && strcmp(isa, kernels[k].name))
+	continue;
+      if (simdIsaSupported(kernels[k].name))
+	return kernels[k];
+      if (any)
+	continue;
+      fprintf(stderr, "selectSimdKernel: this CPU does not support %s\n", isa);
+      exit(1);
+    }
+  if (!any)
+    fprintf(stderr, "selectSimdKernel: unknown instruction set %s\n", isa);
+  exit(1);
+}
@@ -0,0 +1,12 @@
+/*==========================================================================================
+** simdms_avx2.cpp
+
+** Description:
+   AVX2 build of the fixed-point min-sum iteration (see simdms.h).
+   Compiled with the matching -m flags; only called after
+   selectSimdKernel() has checked that the CPU supports them.
+==============================================================================================*/
+
+#define SIMDMS_ITERATION simdmsIterationAVX2
+#define SIMDMS_WIDTH     32
+#include "simdms_kernel.h"
@@ -0,0 +1,12 @@
+/*==========================================================================================
+** simdms_avx512.cpp
+
+** Description:
+   AVX-512BW build of the fixed-point min-sum iteration (see simdms.h).
+   Compiled with the matching -m flags; only called after
+   selectSimdKernel() has checked that the CPU supports them.
+==============================================================================================*/
+
+#define SIMDMS_ITERATION simdmsIterationAVX512
+#define SIMDMS_WIDTH     64
+#include "simdms_kernel.h"
@@ -0,0 +1,12 @@
+/*==========================================================================================
+** simdms_sse41.cpp
+
+** Description:
+   SSE4.1 build of the fixed-point min-sum iteration (see simdms.h).
+   Compiled with the matching -m flags; only called after
+   selectSimdKernel() has checked that the CPU supports them.
+==============================================================================================*/
+
+#define SIMDMS_ITERATION simdmsIterationSSE41
+#define SIMDMS_WIDTH     16
+#include "simdms_kernel.h"
@@ -0,0 +1,245 @@
+/*==========================================================================================
+** tanner.cpp
+
+** Description:
+   Builds the flat (CSR) Tanner graph from a loaded alist_struct,
+   and maintains the binary graph cache used by loadTanner().
+   See tanner.h for the layout of the edge arrays.
+
+   Cache file layout (native byte order, int = 32 bits):
+     tanner_cache_header
+     check_start[M+1] check_sym[E] check_edge[E]
+     sym_start[N+1]   sym_check[E] sym_edge[E]
+==============================================================================================*/
+
+
+#include "tanner.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+#define TANNER_CACHE_MAGIC   "TANNER1"
+#define TANNER_CACHE_ENDIAN  0x01020304
+
+typedef struct {
+  char magic[8];
+  int  endian;             /* TANNER_CACHE_ENDIAN as written by the host */
+  int  int_size;
+  int  N, M, E;
+  int  biggest_dv, biggest_dc;
+  long long src_size;      /* size and mtime of the alist the cache was built from */
+  long long src_mtime;
+} tanner_cache_header;
+
+static size_t cacheLength(int N, int M, int E);
+static int mapCache(const char * cacheName, struct stat & src, tanner_struct & G);
+static void writeCache(const char * cacheName, struct stat & src, tanner_struct & G);
+
+tanner_struct buildTanner(alist_struct & H)
+{
+  tanner_struct G;
+  int i, j, e, k;
+
+  G.N = H.N;
+  G.M = H.M;
+  G.map_base = NULL;
+  G.map_len = 0;
+  G.biggest_dv = 0;
+  G.biggest_dc = 0;
+
+  // Degree prefix sums give the offsets for both orderings:
+  G.check_start = (int *) malloc((G.M+1)*sizeof(int));
+  G.sym_start   = (int *) malloc((G.N+1)*sizeof(int));
+  G.check_start[0] = 0;
+  for (i=0; i<G.M; i++)
+    {
+      G.check_start[i+1] = G.check_start[i] + H.num_mlist[i];
+      if (H.num_mlist[i] > G.biggest_dc)
+	G.biggest_dc = H.num_mlist[i];
+    }
+  G.sym_start[0] = 0;
+  for (i=0; i<G.N; i++)
+    {
+      G.sym_start[i+1] = G.sym_start[i] + H.num_nlist[i];
+      if (H.num_nlist[i] > G.biggest_dv)
+	G.biggest_dv = H.num_nlist[i];
+    }
+  G.E = G.check_start[G.M];
+  if (G.sym_start[G.N] != G.E)
+    {
+      fprintf(stderr, "buildTanner: row weights sum to %d but column weights sum to %d\n", G.E, G.sym_start[G.N]);
+      exit(1);
+    }
+
+  G.check_sym  = (int *) malloc(G.E*sizeof(int));
+  G.check_edge = (int *) malloc(G.E*sizeof(int));
+  G.sym_check  = (int *) malloc(G.E*sizeof(int));
+  G.sym_edge   = (int *) malloc(G.E*sizeof(int));
+
+  // Copy neighbour lists in their alist order:
+  for (i=0; i<G.M; i++)
+    for (j=0; j<H.num_mlist[i]; j++)
+      G.check_sym[G.check_start[i]+j] = H.mlist[i][j]-1;
+  for (i=0; i<G.N; i++)
+    for (j=0; j<H.num_nlist[i]; j++)
+      G.sym_check[G.sym_start[i]+j] = H.nlist[i][j]-1;
+
+  // Pair each check-major edge with its symbol-major twin. This is
+  // the only place the neighbour lists are searched.
+  for (i=0; i<G.M; i++)
+    for (e=G.check_start[i]; e<G.check_start[i+1]; e++)
+      {
+	int snode = G.check_sym[e];
+	int match = -1;
+	for (k=G.sym_start[snode]; k<G.sym_start[snode+1]; k++)
+	  if (G.sym_check[k] == i)
+	    match = k;
+	if (match < 0)
+	  {
+	    fprintf(stderr, "buildTanner: check %d lists symbol %d, but symbol %d does not list check %d\n", i+1, snode+1, snode+1, i+1);
+	    exit(1);
+	  }
+	G.check_edge[e] = match;
+	G.sym_edge[match] = e;
+      }
+
+  return G;
+}
+
+
+tanner_struct loadTanner(const char * fileName)
+{
+  tanner_struct G;
+  struct stat src;
+  string cacheName = string(fileName) + ".csr";
+
+  if (stat(fileName, &src) != 0)
+    {
+      fprintf(stderr, "loadTanner: cannot stat %s\n", fileName);
+      exit(1);
+    }
+
+  if (mapCache(cacheName.c_str(), src, G))
+    return G;
+
+  // Cache missing or stale: parse the alist and refresh the cache.
+  alist_struct H = loadFile(fileName);
+  G = buildTanner(H);
+  freeAlist(H);
+  writeCache(cacheName.c_str(), src, G);
+  return G;
+}
+
+
+static size_t cacheLength(int N, int M, int E)
+{
+  return sizeof(tanner_cache_header) + ((size_t)(M+1) + (size_t)(N+1) + 4*(size_t)E)*sizeof(int);
+}
+
+
+static int mapCache(const char * cacheName, struct stat & src, tanner_struct & G)
+{
+  tanner_cache_header hdr;
+  struct stat st;
+  int fd = open(cacheName, O_RDONLY);
+  if (fd < 0)
+    return 0;
+  if ((fstat(fd, &st) != 0) || (read(fd, &hdr, sizeof(hdr)) != sizeof(hdr)))
+    {
+      close(fd);
+      return 0;
+    }
+  if ((memcmp(hdr.magic, TANNER_CACHE_MAGIC, sizeof(hdr.magic)) != 0)
+      || (hdr.endian != TANNER_CACHE_ENDIAN) || (hdr.int_size != sizeof(int))
+      || (hdr.src_size != (long long)src.st_size) || (hdr.src_mtime != (long long)src.st_mtime)
+      || ((size_t)st.st_size != cacheLength(hdr.N, hdr.M, hdr.E)))
+    {
+      close(fd);
+      return 0;
+    }
+
+  void * base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return 0;
+
+  G.N = hdr.N;
+  G.M = hdr.M;
+  G.E = hdr.E;
+  G.biggest_dv = hdr.biggest_dv;
+  G.biggest_dc = hdr.biggest_dc;
+  G.map_base = base;
+  G.map_len = st.st_size;
+
+  int * p = (int *) ((char *) base + sizeof(tanner_cache_header));
+  G.check_start = p;  p += G.M+1;
+  G.check_sym   = p;  p += G.E;
+  G.check_edge  = p;  p += G.E;
+  G.sym_start   = p;  p += G.N+1;
+  G.sym_check   = p;  p += G.E;
+  G.sym_edge    = p;
+  return 1;
+}
+
+
+static void writeCache(const char * cacheName, struct stat & src, tanner_struct & G)
+{
+  tanner_cache_header hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, TANNER_CACHE_MAGIC, sizeof(hdr.magic));
+  hdr.endian = TANNER_CACHE_ENDIAN;
+  hdr.int_size = sizeof(int);
+  hdr.N = G.N;
+  hdr.M = G.M;
+  hdr.E = G.E;
+  hdr.biggest_dv = G.biggest_dv;
+  hdr.biggest_dc = G.biggest_dc;
+  hdr.src_size = src.st_size;
+  hdr.src_mtime = src.st_mtime;
+
+  // Write to a private temporary and rename it into place, so a
+  // concurrent reader never maps a partially written cache.
+  char tmpName[4096];
+  snprintf(tmpName, sizeof(tmpName), "%s.%d.tmp", cacheName, (int) getpid());
+  FILE * f = fopen(tmpName, "wb");
+  if (f == NULL)
+    {
+      fprintf(stderr, "loadTanner: could not write graph cache %s\n", cacheName);
+      return;
+    }
+  int ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+  ok = ok && (fwrite(G.check_start, sizeof(int), G.M+1, f) == (size_t)(G.M+1));
+  ok = ok && (fwrite(G.check_sym,   sizeof(int), G.E,   f) == (size_t)G.E);
+  ok = ok && (fwrite(G.check_edge,  sizeof(int), G.E,   f) == (size_t)G.E);
+  ok = ok && (fwrite(G.sym_start,   sizeof(int), G.N+1, f) == (size_t)(G.N+1));
+  ok = ok && (fwrite(G.sym_check,   sizeof(int), G.E,   f) == (size_t)G.E);
+  ok = ok && (fwrite(G.sym_edge,    sizeof(int), G.E,   f) == (size_t)G.E);
+  ok = (fclose(f) == 0) && ok;
+  if (!ok || (rename(tmpName, cacheName) != 0))
+    {
+      fprintf(stderr, "loadTanner: could not write graph cache %s\n", cacheName);
+      unlink(tmpName);
+    }
+}
+
+
+void freeTanner(tanner_struct G)
+{
+  if (G.map_base != NULL)
+    {
+      munmap(G.map_base, G.map_len);
+      return;
+    }
+  free(G.check_start);
+  free(G.check_sym);
+  free(G.check_edge);
+  free(G.sym_start);
+  free(G.sym_check);
+  free(G.sym_edge);
+}
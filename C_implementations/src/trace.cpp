@@ -0,0 +1,109 @@
+/*==========================================================================================
+** trace.cpp
+
+** Description:
+   Decoding traces for golden-trace regression checks. See trace.h.
+==============================================================================================*/
+
+
+#include "trace.h"
+#include "options.h"
+#include <cstdlib>
+#include <string>
+using namespace std;
+
+
+decode_trace openTrace(int & argc, char * argv[], int numThreads)
+{
+  decode_trace T;
+  T.file = NULL;
+  T.frame = 0;
+  string fileName = extractStringOption(argc, argv, "trace", "");
+  if (fileName.empty())
+    return T;
+  if (numThreads != 1)
+    {
+      fprintf(stderr, "--trace needs a single worker thread\n");
+      exit(1);
+    }
+  T.file = fopen(fileName.c_str(), "w");
+  if (T.file == NULL)
+    {
+      fprintf(stderr, "Cannot write trace file %s\n", fileName.c_str());
+      exit(1);
+    }
+  return T;
+}
+
+
+void closeTrace(decode_trace & T)
+{
+  if (T.file != NULL)
+    fclose(T.file);
+  T.file = NULL;
+}
+
+
+// FNV-1a over the bytes of the packed words:
+static uint64_t hashBits(const vector<uint64_t> & words)
+{
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t k=0; k<words.size(); k++)
+    for (int b=0; b<64; b+=8)
+      {
+	h ^= (words[k] >> b) & 0xff;
+	h *= 1099511628211ULL;
+      }
+  return h;
+}
+
+
+static void writeLine(decode_trace & T, const tanner_struct & G, int lane, const char * label, int it,
+		      const decision_bits & bit)
+{
+  T.packed.assign((G.N + 63)/64, 0);
+  for (int i=0; i<G.N; i++)
+    if (bit(i))
+      T.packed[i/64] |= 1ULL << (i % 64);
+  uint64_t decisions = hashBits(T.packed);
+
+  // The syndrome follows from the decisions, so that decoders which
+  // keep their own are checked against it:
+  vector<uint64_t> word(T.packed);
+  T.packed.assign((G.M + 63)/64, 0);
+  int unsatisfied = 0;
+  for (int m=0; m<G.M; m++)
+    {
+      int parity = 0;
+      for (int e=G.check_start[m]; e<G.check_start[m+1]; e++)
+	parity ^= (word[G.check_sym[e]/64] >> (G.check_sym[e] % 64)) & 1;
+      if (parity)
+	{
+	  T.packed[m/64] |= 1ULL << (m % 64);
+	  unsatisfied++;
+	}
+    }
+
+  fprintf(T.file, "%ld %s%d %016llx %016llx %d\n", T.frame + lane, label, it,
+	  (unsigned long long) decisions, (unsigned long long) hashBits(T.packed), unsatisfied);
+}
+
+
+void traceIteration(decode_trace & T, const tanner_struct & G, int lane, int it, const decision_bits & bit)
+{
+  if (T.file != NULL)
+    writeLine(T, G, lane, "", it, bit);
+}
+
+
+void traceFrame(decode_trace & T, const tanner_struct & G, int lane, int iterations, const decision_bits & bit)
+{
+  if (T.file != NULL)
+    writeLine(T, G, lane, "end ", iterations, bit);
+}
+
+
+void traceNext(decode_trace & T, int lanes)
+{
+  T.frame += lanes;
+}
@@ -0,0 +1,35 @@
+/*==========================================================================================
+** rand_normal.h
+
+** Description:
+   Batch Gaussian generator. ran_normals() fills a buffer with
+   independent standard normal deviates using the 128-layer Ziggurat
+   method (Marsaglia & Tsang, in Doornik's ZIGNOR form), which needs
+   one table lookup and one multiply for about 99% of samples and no
+   cos/sqrt/log. The uniforms come from RAN_NORMAL_LANES interleaved
+   xoshiro256** generators, laid out so that the compiler vectorizes
+   them; the AVX2 build is selected at run time where available.
+
+   Each thread has its own state. ran_normal_seed(s,k) seeds it from
+   s and places the calling thread on stream k, with every lane of
+   every stream 2^128 draws apart; an unseeded thread behaves as if
+   seeded with (0,0). rannb() returns single deviates from a small
+   per-thread pool that is refilled in batches, for callers that need
+   one at a time.
+==============================================================================================*/
+
+#ifndef RAND_NORMAL_H
+#define RAND_NORMAL_H
+
+#include <stdint.h>
+
+#define RAN_NORMAL_LANES 8
+
+void   ran_normal_seed(uint64_t seed, int stream);
+void   ran_normals(double * out, long n);    // n standard normals
+void   ran_normals_f(float * out, long n);
+double ran_normal_pooled();
+
+#define rannb() ran_normal_pooled()          /* From standard Normal, batched */
+
+#endif
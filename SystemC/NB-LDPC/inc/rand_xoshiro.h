@@ -0,0 +1,149 @@
+/* rand_xoshiro.h - Random number generators. */
+/* Formatted to be compatible with Neal's
+   rand.h but using a xoshiro256** generator
+   (Blackman & Vigna) with one state per thread.
+
+   ran_stream(s,k) seeds the calling thread's
+   generator from s and then applies k jumps of
+   2^128 draws, so threads that share a seed s
+   but use different k draw from non-overlapping
+   streams. ran_seed(s) is ran_stream(s,0).
+
+   Original rand.h copyright message:
+   Copyright (c) 1992 by Radford M. Neal
+*/
+
+#ifndef RAND_XOSHIRO_H
+#define RAND_XOSHIRO_H
+
+#include <stdint.h>
+#include <math.h>
+
+typedef struct {
+  uint64_t s[4];
+  int      have_spare;   /* rann() produces deviates in pairs */
+  double   spare;
+} xoshiro_state;
+
+inline thread_local xoshiro_state ran_state;
+
+static inline uint64_t xoshiro_rotl(const uint64_t x, int k)
+{
+  return (x << k) | (x >> (64 - k));
+}
+
+static inline uint64_t xoshiro_next(xoshiro_state & st)
+{
+  const uint64_t result = xoshiro_rotl(st.s[1] * 5, 7) * 9;
+  const uint64_t t = st.s[1] << 17;
+  st.s[2] ^= st.s[0];
+  st.s[3] ^= st.s[1];
+  st.s[1] ^= st.s[2];
+  st.s[0] ^= st.s[3];
+  st.s[2] ^= t;
+  st.s[3] = xoshiro_rotl(st.s[3], 45);
+  return result;
+}
+
+/* Equivalent to 2^128 calls to xoshiro_next() */
+static inline void xoshiro_jump(xoshiro_state & st)
+{
+  static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+				   0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+  uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  for (int i = 0; i < 4; i++)
+    for (int b = 0; b < 64; b++)
+      {
+	if (JUMP[i] & ((uint64_t)1 << b))
+	  {
+	    s0 ^= st.s[0];
+	    s1 ^= st.s[1];
+	    s2 ^= st.s[2];
+	    s3 ^= st.s[3];
+	  }
+	xoshiro_next(st);
+      }
+  st.s[0] = s0;
+  st.s[1] = s1;
+  st.s[2] = s2;
+  st.s[3] = s3;
+}
+
+/* Expand a seed with splitmix64 (never yields the all-zero state) */
+static inline void xoshiro_seed(xoshiro_state & st, uint64_t seed, int stream)
+{
+  for (int i = 0; i < 4; i++)
+    {
+      uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      st.s[i] = z ^ (z >> 31);
+    }
+  for (int k = 0; k < stream; k++)
+    xoshiro_jump(st);
+  st.have_spare = 0;
+}
+
+/* Uniform from [0,1) using the top 53 bits */
+static inline double xoshiro_uniform(xoshiro_state & st)
+{
+  return (xoshiro_next(st) >> 11) * (1.0/9007199254740992.0);
+}
+
+/* Uniform from (0,1) */
+static inline double xoshiro_uniform_pos(xoshiro_state & st)
+{
+  return ((xoshiro_next(st) >> 11) + 0.5) * (1.0/9007199254740992.0);
+}
+
+/* Standard normal by the polar method, keeping the second deviate */
+static inline double xoshiro_normal(xoshiro_state & st)
+{
+  if (st.have_spare)
+    {
+      st.have_spare = 0;
+      return st.spare;
+    }
+  double u, v, s;
+  do
+    {
+      u = 2.0*xoshiro_uniform(st) - 1.0;
+      v = 2.0*xoshiro_uniform(st) - 1.0;
+      s = u*u + v*v;
+    }
+  while ((s >= 1.0) || (s == 0.0));
+  s = sqrt(-2.0*log(s)/s);
+  st.spare = v*s;
+  st.have_spare = 1;
+  return u*s;
+}
+
+
+/* SET RANDOM NUMBER SEED. */
+
+#define ran_seed(s) xoshiro_seed(ran_state, (s), 0)
+
+#define ran_stream(s,k) xoshiro_seed(ran_state, (s), (k))
+
+
+/* GENERATE RANDOM NUMBERS. */
+
+#define ranf() \
+  xoshiro_uniform(ran_state)                  /* Uniform from interval [0,1) */
+
+#define ranu() \
+  xoshiro_uniform_pos(ran_state)              /* Uniform from (0,1) */
+
+#define rani(n) \
+  ( (int) (ranf()*(n)) )		    /* Uniform from 0, 1, ..., (n-1) */
+
+#define rann() \
+  xoshiro_normal(ran_state)                   /* From standard Norml */
+
+#define rane() \
+  (-log(ranu()))		                  /* From exponential */
+
+#define ranc() \
+  (tan(3.141592654*(ranu()-0.5)))		                      /* From Cauchy */
+
+#endif
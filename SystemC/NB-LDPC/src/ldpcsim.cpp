@@ -87,15 +87,51 @@ int sc_main(int argc, char * argv[])
 }
 
 
+//===================================
+// OPTIONAL STOPPING FLAGS:
+//===================================
+// Removes "--rel-precision P", "--confidence C", "--max-frames F" and
+// "--fer-floor X" from argv (see stoprule.h). Without them the
+// simulation stops after 31 frame errors and 251 bit errors.
+void get_stop_flags(int & argc, char * argv[])
+{
+  p.stop = defaultStopPolicy(251, 31);
+  int k = 1;
+  while (k+1 < argc)
+  {
+    string flag(argv[k]);
+    double value = atof(argv[k+1]);
+    if (flag == "--rel-precision")
+      p.stop.precision = value;
+    else if (flag == "--confidence")
+      p.stop.confidence = value;
+    else if (flag == "--max-frames")
+      p.stop.maxFrames = (long) value;
+    else if (flag == "--fer-floor")
+      p.stop.ferFloor = value;
+    else
+    {
+      k++;
+      continue;
+    }
+    for (int j=k; j+2<=argc; j++)
+      argv[j] = argv[j+2];
+    argc -= 2;
+  }
+  p.stopZ = confidenceZ(p.stop.confidence);
+}
+
 //===================================
 // READ PARAMETERS FROM COMMAND LINE:
 //===================================
 void get_arguments(int argc, char * argv[])
 {
+  get_stop_flags(argc, argv);
   if (argc != 13)
   {
     cout << "Usage: \n\t"
 	 << argv[0]
+	 << " [--rel-precision P] [--confidence C] [--max-frames F] [--fer-floor X]"
 	 << " <alist_fname> "
 	 << "<stim_fname> "
 	 << "<code_rate> "
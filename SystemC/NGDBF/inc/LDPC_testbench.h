@@ -32,6 +32,7 @@ using namespace std;
 #include "ldpcsim.h"
 #include "nodes.h"
 #include "rand.h"
+#include "rand_normal.h"
 
 
 ///////////////////////////////////////////////////////////////
@@ -57,7 +58,7 @@ public:
   //===========================================
   SC_HAS_PROCESS(LDPC_testbench);
  LDPC_testbench(sc_module_name name) : sc_module(name), y("y",p.N), d("d",p.N), finished("stop"), ready("ready"),
-    c(p.N), x(p.N), rx(p.N), codewordFile(p.stimfilename,ios::in)
+    c(p.N), x(p.N), rx(p.N), noise(p.N), codewordFile(p.stimfilename,ios::in)
     {
       init_object();
       SC_METHOD(update);
@@ -74,6 +75,7 @@ public:
   vector<int>		c;   // Codeword bits
   vector<int>		x;   // Antipodal modulated symbols in {+1,-1}
   vector<double>	rx;  // Received signal (modulated plus AWGN)	
+  vector<double>	noise; // Standard normal deviates for one frame
 
   int errors;
   int word_errors;
@@ -118,7 +120,7 @@ public:
 	    codewordFile.seekg(0);
 	  }
 
-	if ((word_errors > 30)&&(errors > 250))
+	if (stopReached(p.stop, p.stopZ, errors, word_errors, total_words))
 	  {
 	    cout << "At SNR=" << p.SNR << ", BER=";
 	    cout << (double)errors/totalbits << " FER=" << (double)word_errors/total_words;
@@ -141,10 +143,11 @@ public:
 
 			
 	// Transmit, add noise and receive:
+	ran_normals(&noise[0], p.N);
 	for (i=0; i<p.N; i++)
 	  {
 	    x[i] = (1 - 2.0*c[i]);
-	    rx[i] = x[i] + p.sigma*rann();
+	    rx[i] = x[i] + p.sigma*noise[i];
 	    y[i].write(rx[i]);
 	  }					      		
       }
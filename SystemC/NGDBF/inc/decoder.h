@@ -21,6 +21,7 @@
 #include "ldpcsim.h"
 #include "nodes.h"
 #include "rand.h"
+#include "rand_normal.h"
 
 #define SMOOTHED true
 
@@ -183,8 +184,8 @@ struct checknode_creator
   void behavior()
   {
     // Generate a single Gaussian random number and shift it into
-    // the symbol node array:
-    rnd_source.write(quantize(p.sigma*rann()));
+    // the symbol node array. rannb() hands it out of a batch:
+    rnd_source.write(quantize(p.sigma*rannb()));
 
     // --------------------------
     // RESET behavior:
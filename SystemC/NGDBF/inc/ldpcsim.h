@@ -19,6 +19,7 @@
 using namespace std;
 
 #include "alist.h"
+#include "stoprule.h"
 
 // ===================================================================
 // Type for internal messages between check nodes and symbol nodes:
@@ -34,6 +35,8 @@ typedef struct
 {
   // Stopping and reporting parameters:
   int iterations_per_frame;  // Maximum iterations per frame
+  stop_policy stop;          // When to end the simulation (see stoprule.h)
+  double stopZ;              // Normal quantile for stop.confidence
   int total_clock_cycles;    // Maximum iterations between incremental progress reports
 
   // Structural parameters:
@@ -4,6 +4,18 @@
 
   This is a simple program for sweeping across decoder parameters to
   identify best performance.
+
+  The grid is read from a spec file (see grid_PEGReg504x1008.txt) in
+  which each swept parameter is a single value, a list "a,b,c" or an
+  inclusive range "start:step:stop". Every point runs as a separate
+  ldpcsim.x process, with at most --jobs of them at a time (default:
+  one per core). A process logs to its own temporary result file; when
+  it exits, its record is appended to the shared result file in one
+  write, so an interrupted search never leaves a partial line. Points
+  whose parameters are already recorded in the result file are
+  skipped, so a search can be stopped and restarted.
+
+  Usage: optimization_search [--jobs N] gridfile
   ========================================================================*/
 
 #include <iostream>
@@ -11,65 +23,299 @@
 #include <sstream>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <cmath>
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 using namespace std;
 
-int main()
+typedef struct {
+  int    precision;
+  double SNR;
+  double Ymax;
+  double theta;
+  double lambda;
+  double alpha;
+} grid_point;
+
+// Format a value as ldpcsim.x writes it, so that points can be
+// matched against existing records as text:
+template <typename T> string fmt(T v)
 {
-  int maxIterations = 300;
-  int maxClocks = 10000;
-  
-  int startPrecision = 5;
-  int endPrecision = 5;
-  
-  double startYmax = 1.75;
-  double endYmax = 1.75;
-  double stepYmax = 0.01;
-
-  double minSNR = 2.00;
-  double maxSNR = 3.5;
-  double SNRstep = 0.25;
-  
-  double startLambda = 0.985;
-  double endLambda = 0.985;
-  double stepLambda = 0.005;
-
-  double initial_theta = -0.8;
-  double final_theta = -0.8;
-  double theta_step = 0.1;
-
-  double alpha = 1.5;
-
-  string simID("M-NGDBF_300_local_adaptation_sample_reuse_smoothed_delayed12");
-  string result_filename("M-NGDBF_300_local_adaptation_sample_reuse_smoothed_delayed12.dat");
-  string alist_filename("../codes/PegReg/PEGReg504x1008.alist");
-  string data_filename("../codes/PegReg/data.enc");
-  double Rate = 0.5;
-
-  string command_name("./ldpcsim.x");
-  
-
-  for (int precision=startPrecision; precision <= endPrecision; precision++)
-    for (double SNR=minSNR; SNR<=maxSNR; SNR+=SNRstep)
-      {     
-	for (double Ymax=startYmax; Ymax <= endYmax; Ymax += stepYmax)
-	  for (double theta=initial_theta; theta<=final_theta; theta+=theta_step) {
-	    for (double lambda=startLambda; lambda<=endLambda; lambda+=stepLambda)
-	      {
+  stringstream ss;
+  ss << v;
+  return ss.str();
+}
 
-		stringstream command_string;
-		command_string << command_name << " " << alist_filename << " " << data_filename << " "
-			       << Rate << " " << SNR << " " << maxIterations << " " << maxClocks << " " 
-			       << lambda << " " << theta << " " << precision << " "  << Ymax << " " 
-			       << alpha << " " << simID << "; sleep 1";
-		cout << "Executing " << command_string.str() << endl;
-      
-		system(command_string.str().c_str());      	  
-	      }
-      
-	  }
-      }
-  return 0;
+string pointKey(const grid_point & g)
+{
+  return fmt(g.SNR) + " " + fmt(g.theta) + " " + fmt(g.lambda) + " "
+    + fmt(g.precision) + " " + fmt(g.Ymax) + " " + fmt(g.alpha);
+}
+
+// A single value, a list "a,b,c", or an inclusive range "start:step:stop":
+vector<double> parseValues(const string & name, const string & text)
+{
+  vector<double> values;
+  double first, step, last;
+  char c1, c2;
+  stringstream ss(text);
+  if ((text.find(':') != string::npos) && (ss >> first >> c1 >> step >> c2 >> last) && (c1 == ':') && (c2 == ':'))
+    {
+      if ((step == 0.0) || ((last - first)/step < 0.0))
+	{
+	  cerr << "Bad range " << text << " for " << name << endl;
+	  exit(1);
+	}
+      long n = (long) floor((last - first)/step + 1e-9) + 1;
+      for (long k=0; k<n; k++)
+	values.push_back(first + k*step);
+      return values;
+    }
+  stringstream ls(text);
+  string item;
+  while (getline(ls, item, ','))
+    {
+      char * end;
+      double v = strtod(item.c_str(), &end);
+      if ((end == item.c_str()) || (*end != '\0'))
+	{
+	  cerr << "Bad value " << item << " for " << name << endl;
+	  exit(1);
+	}
+      values.push_back(v);
+    }
+  return values;
+}
+
+map<string,string> readSpec(const char * fname)
+{
+  map<string,string> spec;
+  ifstream f(fname);
+  if (!f.is_open())
+    {
+      cerr << "Could not open grid spec " << fname << endl;
+      exit(1);
+    }
+  string line;
+  while (getline(f, line))
+    {
+      size_t hash = line.find('#');
+      if (hash != string::npos)
+	line.erase(hash);
+      stringstream ss(line);
+      string key, value;
+      if (ss >> key >> value)
+	spec[key] = value;
+    }
+  return spec;
+}
+
+string required(map<string,string> & spec, const char * key)
+{
+  if (spec.count(key) == 0)
+    {
+      cerr << "Grid spec is missing " << key << endl;
+      exit(1);
+    }
+  return spec[key];
+}
+
+// Keys of the points already recorded in the result file:
+set<string> readCompleted(const string & fname)
+{
+  set<string> done;
+  ifstream f(fname.c_str());
+  string line;
+  while (getline(f, line))
+    {
+      stringstream ss(line);
+      vector<string> fields;
+      string field;
+      while (ss >> field)
+	fields.push_back(field);
+      if (fields.size() < 13)
+	continue;
+      done.insert(fields[3] + " " + fields[8] + " " + fields[9] + " "
+		  + fields[10] + " " + fields[11] + " " + fields[12]);
+    }
+  return done;
+}
+
+// Append a finished point's record to the result file in a single
+// write. O_APPEND makes the write land whole at the end of the file.
+bool appendRecord(const string & resultFile, const string & tempName)
+{
+  ifstream f((tempName + ".dat").c_str());
+  stringstream record;
+  record << f.rdbuf();
+  string text = record.str();
+  if (text.empty())
+    return false;
+  int fd = open(resultFile.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (fd < 0)
+    return false;
+  bool ok = (write(fd, text.data(), text.size()) == (ssize_t) text.size());
+  fsync(fd);
+  close(fd);
+  return ok;
+}
+
+pid_t launch(const vector<string> & args, const string & logName)
+{
+  pid_t pid = fork();
+  if (pid == 0)
+    {
+      int fd = open(logName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd >= 0)
+	{
+	  dup2(fd, 1);
+	  dup2(fd, 2);
+	  close(fd);
+	}
+      vector<char *> argv;
+      for (size_t k=0; k<args.size(); k++)
+	argv.push_back((char *) args[k].c_str());
+      argv.push_back(NULL);
+      execv(argv[0], &argv[0]);
+      perror("execv");
+      _exit(127);
+    }
+  return pid;
 }
 
+
+int main(int argc, char * argv[])
+{
+  int jobs = thread::hardware_concurrency();
+  if ((argc == 4) && (strcmp(argv[1], "--jobs") == 0))
+    {
+      jobs = atoi(argv[2]);
+      argv += 2;
+      argc -= 2;
+    }
+  if ((argc != 2) || (jobs < 1))
+    {
+      cout << "Usage: " << argv[0] << " [--jobs N] gridfile" << endl;
+      return 0;
+    }
+
+  map<string,string> spec = readSpec(argv[1]);
+  string command_name   = spec.count("command") ? spec["command"] : string("./ldpcsim.x");
+  string simID          = required(spec, "simID");
+  string alist_filename = required(spec, "alist");
+  string data_filename  = required(spec, "data");
+  string Rate           = required(spec, "rate");
+  string maxIterations  = required(spec, "iterations");
+  string maxClocks      = required(spec, "clocks");
+  string result_filename = simID + ".dat";
+
+  vector<double> precisions = parseValues("precision", required(spec, "precision"));
+  vector<double> SNRs       = parseValues("SNR",       required(spec, "SNR"));
+  vector<double> Ymaxs      = parseValues("Ymax",      required(spec, "Ymax"));
+  vector<double> thetas     = parseValues("theta",     required(spec, "theta"));
+  vector<double> lambdas    = parseValues("lambda",    required(spec, "lambda"));
+  vector<double> alphas     = parseValues("alpha",     required(spec, "alpha"));
+
+  // Enumerate the grid in the order of the original nested loops,
+  // leaving out the points that are already recorded:
+  set<string> completed = readCompleted(result_filename);
+  vector<grid_point> points;
+  long skipped = 0;
+  for (size_t a=0; a<precisions.size(); a++)
+    for (size_t b=0; b<SNRs.size(); b++)
+      for (size_t c=0; c<Ymaxs.size(); c++)
+	for (size_t d=0; d<thetas.size(); d++)
+	  for (size_t e=0; e<lambdas.size(); e++)
+	    for (size_t f=0; f<alphas.size(); f++)
+	      {
+		grid_point g;
+		g.precision = (int) lround(precisions[a]);
+		g.SNR    = SNRs[b];
+		g.Ymax   = Ymaxs[c];
+		g.theta  = thetas[d];
+		g.lambda = lambdas[e];
+		g.alpha  = alphas[f];
+		if (completed.count(pointKey(g)))
+		  skipped++;
+		else
+		  points.push_back(g);
+	      }
+  cout << "Running " << points.size() << " points on " << jobs << " jobs ("
+       << skipped << " already in " << result_filename << ")" << endl;
+
+  // Keep up to jobs processes running, starting the next point as
+  // each one exits:
+  map<pid_t,size_t> running;
+  size_t next = 0;
+  int failures = 0;
+  while ((next < points.size()) || !running.empty())
+    {
+      while ((next < points.size()) && ((int) running.size() < jobs))
+	{
+	  const grid_point & g = points[next];
+	  string tempName = simID + ".point" + fmt(next);
+	  remove((tempName + ".dat").c_str());
+
+	  vector<string> args;
+	  args.push_back(command_name);
+	  args.push_back(alist_filename);
+	  args.push_back(data_filename);
+	  args.push_back(Rate);
+	  args.push_back(fmt(g.SNR));
+	  args.push_back(maxIterations);
+	  args.push_back(maxClocks);
+	  args.push_back(fmt(g.lambda));
+	  args.push_back(fmt(g.theta));
+	  args.push_back(fmt(g.precision));
+	  args.push_back(fmt(g.Ymax));
+	  args.push_back(fmt(g.alpha));
+	  args.push_back(tempName);
+
+	  cout << "Executing";
+	  for (size_t k=0; k<args.size(); k++)
+	    cout << " " << args[k];
+	  cout << endl;
+
+	  pid_t pid = launch(args, tempName + ".log");
+	  if (pid < 0)
+	    {
+	      perror("fork");
+	      return 1;
+	    }
+	  running[pid] = next++;
+	}
+
+      int status;
+      pid_t pid = wait(&status);
+      if (pid < 0)
+	break;
+      if (running.count(pid) == 0)
+	continue;
+      size_t k = running[pid];
+      running.erase(pid);
+
+      string tempName = simID + ".point" + fmt(k);
+      if (WIFEXITED(status) && (WEXITSTATUS(status) == 0) && appendRecord(result_filename, tempName))
+	{
+	  remove((tempName + ".dat").c_str());
+	  remove((tempName + ".log").c_str());
+	  cout << "Finished point " << pointKey(points[k]) << endl;
+	}
+      else
+	{
+	  failures++;
+	  cout << "Point " << pointKey(points[k]) << " failed, see " << tempName << ".log" << endl;
+	}
+    }
+
+  cout << "Done: " << points.size() - failures << " points recorded, " << failures << " failed." << endl;
+  return (failures > 0);
+}
@@ -0,0 +1,221 @@
+/*==========================================================================================
+** rand_normal.cpp
+
+** Description:
+   Batch Gaussian generator. See rand_normal.h.
+==============================================================================================*/
+
+
+#include "rand_normal.h"
+#include "rand_xoshiro.h"
+#include <math.h>
+
+#define ZIG_LAYERS  128
+#define ZIG_R       3.442619855899
+#define ZIG_V       9.91256303526217e-3
+#define CHUNK       256         // Deviates produced per pass, a multiple of RAN_NORMAL_LANES
+#define POOL        64          // Deviates kept for rannb()
+
+typedef struct {
+  uint64_t      s[4][RAN_NORMAL_LANES];  // Interleaved xoshiro256** states, one column per lane
+  xoshiro_state slow;                    // Scalar generator for the rare rejections
+  double        pool[POOL];
+  int           pooled;                  // Unused deviates left in pool
+  bool          seeded;
+} normal_state;
+
+static thread_local normal_state ns;
+
+
+// Ziggurat tables: zigX[i] is the right edge of layer i (zigX[0] is
+// the base strip's equivalent width) and zigR[i] = zigX[i+1]/zigX[i]
+// is the fraction of layer i that lies wholly under the density.
+static struct zig_tables
+{
+  double X[ZIG_LAYERS+1];
+  double R[ZIG_LAYERS];
+
+  zig_tables()
+  {
+    double f = exp(-0.5*ZIG_R*ZIG_R);
+    X[0] = ZIG_V/f;
+    X[1] = ZIG_R;
+    X[ZIG_LAYERS] = 0.0;
+    for (int i=2; i<ZIG_LAYERS; i++)
+      {
+	X[i] = sqrt(-2.0*log(ZIG_V/X[i-1] + f));
+	f = exp(-0.5*X[i]*X[i]);
+      }
+    for (int i=0; i<ZIG_LAYERS; i++)
+      R[i] = X[i+1]/X[i];
+  }
+} zig;
+
+
+void ran_normal_seed(uint64_t seed, int stream)
+{
+  // Offset the seed so that the same s in ran_stream() and here
+  // give unrelated sequences:
+  xoshiro_state base;
+  xoshiro_seed(base, seed ^ 0x6a09e667f3bcc909ULL, 0);
+  for (long k=0; k<(long)stream*(RAN_NORMAL_LANES+1); k++)
+    xoshiro_jump(base);
+
+  for (int l=0; l<RAN_NORMAL_LANES; l++)
+    {
+      for (int j=0; j<4; j++)
+	ns.s[j][l] = base.s[j];
+      xoshiro_jump(base);
+    }
+  ns.slow = base;
+  ns.slow.have_spare = 0;
+  ns.pooled = 0;
+  ns.seeded = true;
+}
+
+
+// Fill w[0..n-1] with raw 64-bit draws, n a multiple of the lane
+// count. The lanes are advanced as groups of four, a width both the
+// SSE2 and AVX2 builds handle well; the multiplies by 5 and 9 are
+// written as shifts and adds since there is no packed 64-bit multiply
+// before AVX-512.
+typedef uint64_t lanes_u64 __attribute__((vector_size(32)));
+#define GROUPS (RAN_NORMAL_LANES/4)
+
+__attribute__((target_clones("avx2","default")))
+static void fillWords(uint64_t * w, int n)
+{
+  lanes_u64 s0[GROUPS], s1[GROUPS], s2[GROUPS], s3[GROUPS];
+  __builtin_memcpy(s0, ns.s[0], sizeof(s0));
+  __builtin_memcpy(s1, ns.s[1], sizeof(s1));
+  __builtin_memcpy(s2, ns.s[2], sizeof(s2));
+  __builtin_memcpy(s3, ns.s[3], sizeof(s3));
+  for (int k=0; k<n; k+=RAN_NORMAL_LANES)
+    for (int g=0; g<GROUPS; g++)
+      {
+	lanes_u64 m = (s1[g] << 2) + s1[g];
+	m = (m << 7) | (m >> 57);
+	m = (m << 3) + m;
+	__builtin_memcpy(w+k+4*g, &m, sizeof(m));
+	lanes_u64 t = s1[g] << 17;
+	s2[g] ^= s0[g];
+	s3[g] ^= s1[g];
+	s1[g] ^= s2[g];
+	s0[g] ^= s3[g];
+	s2[g] ^= t;
+	s3[g] = (s3[g] << 45) | (s3[g] >> 19);
+      }
+  __builtin_memcpy(ns.s[0], s0, sizeof(s0));
+  __builtin_memcpy(ns.s[1], s1, sizeof(s1));
+  __builtin_memcpy(ns.s[2], s2, sizeof(s2));
+  __builtin_memcpy(ns.s[3], s3, sizeof(s3));
+}
+
+
+// The low 7 bits of a draw pick the layer and the top 53 bits give
+// a uniform on [-1,1); the two fields do not overlap. The shifted
+// value fits a signed integer, which converts to double in one
+// instruction.
+static inline double zigUniform(uint64_t b)
+{
+  return (int64_t)(b >> 11)*(1.0/4503599627370496.0) - 1.0;
+}
+
+
+// Sample from the tail beyond ZIG_R by Marsaglia's method:
+static double zigTail(bool negative)
+{
+  double x, y;
+  do
+    {
+      x = log(xoshiro_uniform_pos(ns.slow))/ZIG_R;
+      y = log(xoshiro_uniform_pos(ns.slow));
+    }
+  while (-2.0*y < x*x);
+  return negative ? x - ZIG_R : ZIG_R - x;
+}
+
+
+// Complete a draw that fell outside the rectangle of layer i,
+// retrying with the scalar generator until one is accepted:
+static double zigSlow(double u, int i)
+{
+  for (;;)
+    {
+      if (i == 0)
+	return zigTail(u < 0);
+      double x = u*zig.X[i];
+      double f0 = exp(-0.5*(zig.X[i]*zig.X[i] - x*x));
+      double f1 = exp(-0.5*(zig.X[i+1]*zig.X[i+1] - x*x));
+      if (f1 + xoshiro_uniform_pos(ns.slow)*(f0 - f1) < 1.0)
+	return x;
+
+      uint64_t b = xoshiro_next(ns.slow);
+      i = b & (ZIG_LAYERS-1);
+      u = zigUniform(b);
+      if (fabs(u) < zig.R[i])
+	return u*zig.X[i];
+    }
+}
+
+
+// Produce n <= CHUNK deviates: a branch-free pass that accepts
+// everything inside the layer rectangles, then a pass that redraws
+// the few that were not.
+__attribute__((target_clones("avx2","default")))
+static void zigChunk(double * out, int n)
+{
+  uint64_t w[CHUNK];
+  fillWords(w, (n + RAN_NORMAL_LANES-1) & ~(RAN_NORMAL_LANES-1));
+
+  int rejected = 0;
+  for (int k=0; k<n; k++)
+    {
+      int i = w[k] & (ZIG_LAYERS-1);
+      double u = zigUniform(w[k]);
+      out[k] = u*zig.X[i];
+      rejected += (fabs(u) >= zig.R[i]);
+    }
+  if (rejected == 0)
+    return;
+  for (int k=0; k<n; k++)
+    {
+      int i = w[k] & (ZIG_LAYERS-1);
+      double u = zigUniform(w[k]);
+      if (fabs(u) >= zig.R[i])
+	out[k] = zigSlow(u, i);
+    }
+}
+
+
+void ran_normals(double * out, long n)
+{
+  if (!ns.seeded)
+    ran_normal_seed(0, 0);
+  for (long k=0; k<n; k+=CHUNK)
+    zigChunk(out+k, (n-k < CHUNK) ? n-k : CHUNK);
+}
+
+
+void ran_normals_f(float * out, long n)
+{
+  double buf[CHUNK];
+  for (long k=0; k<n; k+=CHUNK)
+    {
+      int m = (n-k < CHUNK) ? n-k : CHUNK;
+      ran_normals(buf, m);
+      for (int j=0; j<m; j++)
+	out[k+j] = (float) buf[j];
+    }
+}
+
+
+double ran_normal_pooled()
+{
+  if (ns.pooled == 0)
+    {
+      ran_normals(ns.pool, POOL);
+      ns.pooled = POOL;
+    }
+  return ns.pool[--ns.pooled];
+}